@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_BENCH_H
+#define CSV_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+
+// Number of heap allocations made by the process so far.
+uint64_t get_allocation_count();
+
+// Measures time and heap allocations from construction until stop() or,
+// without it, until they are read.
+class timer
+{
+public:
+    timer()
+        : m_start(clock::now()),
+          m_start_allocations(get_allocation_count()),
+          m_stopped(false)
+    {
+    }
+
+    void stop()
+    {
+        m_stop = clock::now();
+        m_stop_allocations = get_allocation_count();
+        m_stopped = true;
+    }
+
+    double elapsed() const
+    {
+        const clock::time_point end = m_stopped ? m_stop : clock::now();
+        return std::chrono::duration<double>(end - m_start).count();
+    }
+
+    uint64_t allocations() const
+    {
+        return (m_stopped ? m_stop_allocations : get_allocation_count()) - m_start_allocations;
+    }
+
+private:
+    typedef std::chrono::steady_clock clock;
+    clock::time_point m_start;
+    clock::time_point m_stop;
+    uint64_t m_start_allocations;
+    uint64_t m_stop_allocations;
+    bool m_stopped;
+};
+
+struct options
+{
+    // approximate size of every generated dataset
+    size_t dataset_size = size_t(16) << 20;
+    // only benchmarks whose name contains this are run
+    std::string filter;
+    // where datasets are generated, they are reused between runs
+    std::string data_dir = ".";
+};
+
+const options& get_options();
+
+inline bool selected(const std::string& name)
+{
+    return get_options().filter.empty() || (name.find(get_options().filter) != std::string::npos);
+}
+
+// Prints one result line. The checksum is printed so the compiler can't
+// throw away the work being measured.
+inline void report(const std::string& name, const timer& t, size_t items, size_t bytes, uint64_t checksum)
+{
+    const double seconds = t.elapsed();
+    const double items_per_sec = (seconds > 0) ? items / seconds : 0;
+    const double mb_per_sec = (seconds > 0) ? bytes / seconds / (1024 * 1024) : 0;
+    const double allocs_per_item = (items > 0) ? static_cast<double>(t.allocations()) / items : 0;
+
+    std::printf("%-56s %10.3f ms %14.0f items/s %10.1f MB/s %8.3f allocs/item  [%llx]\n",
+                name.c_str(), seconds * 1000, items_per_sec, mb_per_sec, allocs_per_item,
+                static_cast<unsigned long long>(checksum));
+    std::fflush(stdout);
+}
+
+inline uint64_t checksum_of(int value)
+{
+    return static_cast<uint64_t>(value);
+}
+
+inline uint64_t checksum_of(long long value)
+{
+    return static_cast<uint64_t>(value);
+}
+
+inline uint64_t checksum_of(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline uint64_t checksum_of(const std::string& value)
+{
+    return value.size() + (value.empty() ? 0 : static_cast<unsigned char>(value[0]));
+}
+
+enum class column_type
+{
+    integer,
+    real,
+    text,
+    // one of a few dozen short words
+    category
+};
+
+// Description of a synthetic CSV file. Files are generated from a fixed
+// seed, so the same options always give the same bytes.
+struct dataset
+{
+    std::string name;
+    std::vector<column_type> columns;
+    bool quoted;
+
+    std::string path;
+    size_t rows;
+    size_t bytes;
+};
+
+const std::vector<dataset>& get_datasets();
+const dataset& get_dataset(const std::string& name);
+
+void run_convert_benchmarks();
+void run_scanner_benchmarks();
+void run_reader_benchmarks();
+void run_writer_benchmarks();
+
+} // namespace bench
+
+#endif // CSV_BENCH_H
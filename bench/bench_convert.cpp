@@ -0,0 +1,240 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "csv_convert.h"
+#include "csv_format.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace bench
+{
+
+namespace
+{
+
+const size_t num_fields = 1000000;
+
+// One line with all the fields separated by '\n', which is how the stream
+// based reader used to see a row.
+struct field_data
+{
+    std::string line;
+    std::vector<std::streamoff> offsets;
+    std::vector<csv::field_view> fields;
+};
+
+template <typename Generator>
+field_data make_fields(Generator generate)
+{
+    field_data data;
+    data.offsets.reserve(num_fields);
+    for (size_t i = 0; i < num_fields; ++i)
+    {
+        data.offsets.push_back(static_cast<std::streamoff>(data.line.size()));
+        data.line += generate();
+        data.line += '\n';
+    }
+
+    data.fields.reserve(num_fields);
+    for (size_t i = 0; i < num_fields; ++i)
+    {
+        const std::streamoff end = (i + 1 < num_fields)
+            ? data.offsets[i + 1] - 1
+            : static_cast<std::streamoff>(data.line.size() - 1);
+        data.fields.emplace_back(data.line.data() + data.offsets[i],
+                                 static_cast<size_t>(end - data.offsets[i]));
+    }
+
+    return data;
+}
+
+template <typename T>
+void bench_stream(const std::string& name, const field_data& data)
+{
+    std::istringstream stream;
+    stream.imbue(std::locale{ "en_US.UTF8" });
+    stream.str(data.line);
+
+    uint64_t checksum = 0;
+    timer t;
+    for (size_t i = 0; i < num_fields; ++i)
+    {
+        T value = T();
+        stream.seekg(data.offsets[i]);
+        stream >> value;
+        stream.clear();
+        checksum += static_cast<uint64_t>(value);
+    }
+
+    report(name + " (istringstream)", t, num_fields, data.line.size(), checksum);
+}
+
+template <typename T>
+void bench_convert(const std::string& name, const field_data& data)
+{
+    uint64_t checksum = 0;
+    timer t;
+    for (size_t i = 0; i < num_fields; ++i)
+    {
+        T value = T();
+        csv::convert<T>::parse(data.fields[i], value);
+        checksum += static_cast<uint64_t>(value);
+    }
+
+    report(name + " (csv::convert)", t, num_fields, data.line.size(), checksum);
+}
+
+template <typename T>
+void bench_both(const std::string& name, const field_data& data)
+{
+    if (selected(name))
+    {
+        bench_stream<T>(name, data);
+        bench_convert<T>(name, data);
+    }
+}
+
+// Doubles written the ways a writer can: through a stream at full
+// precision, with printf at 17 digits (not the shortest), with printf at
+// 15, 16 then 17 digits until the text reads back to the value, and with
+// csv::format.
+void bench_format(const std::string& name, const std::vector<double>& values)
+{
+    if (!selected(name))
+    {
+        return;
+    }
+
+    {
+        std::ostringstream stream;
+        stream.imbue(std::locale::classic());
+        stream.precision(17);
+
+        size_t bytes = 0;
+        timer t;
+        for (double value : values)
+        {
+            stream.seekp(0);
+            stream << value;
+            bytes += static_cast<size_t>(stream.tellp());
+        }
+
+        report(name + " (ostringstream)", t, values.size(), bytes, bytes);
+    }
+
+    {
+        char buffer[64];
+        size_t bytes = 0;
+        timer t;
+        for (double value : values)
+        {
+            bytes += static_cast<size_t>(std::snprintf(buffer, sizeof(buffer), "%.17g", value));
+        }
+
+        report(name + " (snprintf %.17g)", t, values.size(), bytes, bytes);
+    }
+
+    {
+        char buffer[64];
+        size_t bytes = 0;
+        timer t;
+        for (double value : values)
+        {
+            for (int digits = 15; ; ++digits)
+            {
+                const int length = std::snprintf(buffer, sizeof(buffer), "%.*g", digits, value);
+                if ((digits == 17) || (std::strtod(buffer, nullptr) == value))
+                {
+                    bytes += static_cast<size_t>(length);
+                    break;
+                }
+            }
+        }
+
+        report(name + " (snprintf shortest search)", t, values.size(), bytes, bytes);
+    }
+
+    {
+        std::string out;
+        size_t bytes = 0;
+        timer t;
+        for (double value : values)
+        {
+            out.clear();
+            csv::format<double>::write(out, value);
+            bytes += out.size();
+        }
+
+        report(name + " (csv::format)", t, values.size(), bytes, bytes);
+    }
+}
+
+} // namespace
+
+void run_convert_benchmarks()
+{
+    std::mt19937_64 rng(42);
+
+    std::uniform_int_distribution<int> int_dist(-1000000, 1000000);
+    const field_data ints = make_fields([&]() { return std::to_string(int_dist(rng)); });
+    bench_both<int>("convert int", ints);
+
+    std::uniform_int_distribution<long long> int64_dist(0, 1LL << 62);
+    const field_data int64s = make_fields([&]() { return std::to_string(int64_dist(rng)); });
+    bench_both<long long>("convert int64", int64s);
+
+    std::uniform_real_distribution<double> double_dist(-1e6, 1e6);
+    const field_data doubles = make_fields([&]()
+    {
+        std::ostringstream os;
+        os.precision(10);
+        os << double_dist(rng);
+        return os.str();
+    });
+    bench_both<double>("convert double", doubles);
+
+    // amounts with a few decimals, and doubles of any magnitude using all
+    // their digits
+    std::vector<double> amounts(num_fields);
+    std::vector<double> full_doubles(num_fields);
+    for (size_t i = 0; i < num_fields; ++i)
+    {
+        amounts[i] = static_cast<double>(rng() % 100000000) / 1000.0 - 50000.0;
+
+        // any exponent short of the one of infinities and NaNs
+        const uint64_t exponent_mask = uint64_t(0x7FF) << 52;
+        const uint64_t bits = (rng() & ~exponent_mask) | ((rng() % 0x7FF) << 52);
+        std::memcpy(&full_doubles[i], &bits, sizeof(bits));
+    }
+
+    bench_format("format double amounts", amounts);
+    bench_format("format double full", full_doubles);
+}
+
+} // namespace bench
@@ -0,0 +1,192 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace bench
+{
+
+namespace
+{
+
+std::vector<dataset> make_specs()
+{
+    const column_type I = column_type::integer;
+    const column_type R = column_type::real;
+    const column_type T = column_type::text;
+    const column_type C = column_type::category;
+
+    std::vector<dataset> specs;
+    specs.push_back({ "narrow_numeric", { I, I, R, R, I, R }, false, "", 0, 0 });
+    specs.push_back({ "narrow_text", { I, T, T, R, T, T }, false, "", 0, 0 });
+    specs.push_back({ "narrow_quoted", { I, T, T, R, T, T }, true, "", 0, 0 });
+    specs.push_back({ "narrow_category", { I, C, C, R, C, I }, false, "", 0, 0 });
+
+    dataset wide = { "wide_numeric", {}, false, "", 0, 0 };
+    for (size_t i = 0; i < 100; ++i)
+    {
+        wide.columns.push_back((i % 3 == 0) ? I : R);
+    }
+    specs.push_back(wide);
+
+    return specs;
+}
+
+void append_value(std::string& line, column_type type, bool quoted, std::mt19937_64& rng)
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+
+    char buffer[32];
+    switch (type)
+    {
+    case column_type::integer:
+        line += std::to_string(static_cast<long long>(rng() % 2000000) - 1000000);
+        break;
+    case column_type::real:
+        std::snprintf(buffer, sizeof(buffer), "%.6f", static_cast<double>(rng() % 100000000) / 1000.0 - 50000.0);
+        line += buffer;
+        break;
+    case column_type::text:
+        if (quoted)
+        {
+            line += '"';
+        }
+
+        for (size_t i = 0, length = 4 + rng() % 16; i < length; ++i)
+        {
+            line += letters[rng() % (sizeof(letters) - 1)];
+        }
+
+        if (quoted)
+        {
+            line += '"';
+        }
+        break;
+    case column_type::category:
+        line += "cat";
+        line += letters[rng() % 8];
+        line += letters[rng() % 6];
+        break;
+    }
+}
+
+// Writes the dataset unless a file of the expected size is already there.
+void generate(dataset& data, size_t target_size)
+{
+    data.path = get_options().data_dir + "/libcsv_bench_" + data.name + "_" +
+                std::to_string(target_size >> 20) + "mb.csv";
+
+    std::mt19937_64 rng(0x6c6962637376ULL);
+    std::string header;
+    for (size_t i = 0; i < data.columns.size(); ++i)
+    {
+        header += (i > 0) ? ",c" : "c";
+        header += std::to_string(i);
+    }
+    header += '\n';
+
+    // generating is deterministic, so rows and bytes can be recomputed
+    // cheaply without writing when the file already exists
+    std::ifstream existing(data.path, std::ios::binary | std::ios::ate);
+    const bool reuse = existing.is_open();
+    const std::streamoff existing_size = reuse ? static_cast<std::streamoff>(existing.tellg()) : 0;
+
+    std::ofstream out;
+    if (!reuse)
+    {
+        out.open(data.path, std::ios::binary);
+        out << header;
+    }
+
+    data.rows = 0;
+    data.bytes = header.size();
+
+    std::string line;
+    while (data.bytes < target_size)
+    {
+        line.clear();
+        for (size_t i = 0; i < data.columns.size(); ++i)
+        {
+            if (i > 0)
+            {
+                line += ',';
+            }
+
+            append_value(line, data.columns[i], data.quoted, rng);
+        }
+        line += '\n';
+
+        if (!reuse)
+        {
+            out.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
+
+        data.bytes += line.size();
+        ++data.rows;
+    }
+
+    if (reuse && (static_cast<size_t>(existing_size) != data.bytes))
+    {
+        // stale file from an older generator, start over
+        existing.close();
+        std::remove(data.path.c_str());
+        generate(data, target_size);
+    }
+}
+
+} // namespace
+
+const std::vector<dataset>& get_datasets()
+{
+    static std::vector<dataset> datasets;
+    if (datasets.empty())
+    {
+        datasets = make_specs();
+        for (dataset& data : datasets)
+        {
+            generate(data, get_options().dataset_size);
+        }
+    }
+
+    return datasets;
+}
+
+const dataset& get_dataset(const std::string& name)
+{
+    const std::vector<dataset>& datasets = get_datasets();
+    for (const dataset& data : datasets)
+    {
+        if (data.name == name)
+        {
+            return data;
+        }
+    }
+
+    return datasets.front();
+}
+
+} // namespace bench
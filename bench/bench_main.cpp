@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace bench
+{
+
+namespace
+{
+
+options g_options;
+std::atomic<uint64_t> g_allocations(0);
+
+void print_usage(const char* program)
+{
+    std::cout << "usage: " << program << " [--size MB] [--filter TEXT] [--data-dir DIR]\n"
+              << "  --size MB        approximate size of each dataset, 1 to 10240 (default 16)\n"
+              << "  --filter TEXT    only run benchmarks whose name contains TEXT\n"
+              << "  --data-dir DIR   existing directory for the generated datasets (default .)\n";
+}
+
+} // namespace
+
+const options& get_options()
+{
+    return g_options;
+}
+
+uint64_t get_allocation_count()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace bench
+
+// count every heap allocation, so benchmarks can show allocations per row
+void* operator new(size_t size)
+{
+    bench::g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size > 0 ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    bench::g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = (i + 1 < argc);
+
+        if ((arg == "--size") && has_value)
+        {
+            bench::g_options.dataset_size = size_t(std::strtoull(argv[++i], nullptr, 10)) << 20;
+        }
+        else if ((arg == "--filter") && has_value)
+        {
+            bench::g_options.filter = argv[++i];
+        }
+        else if ((arg == "--data-dir") && has_value)
+        {
+            bench::g_options.data_dir = argv[++i];
+        }
+        else
+        {
+            bench::print_usage(argv[0]);
+            return (arg == "--help") ? 0 : 1;
+        }
+    }
+
+    if (bench::g_options.dataset_size == 0)
+    {
+        bench::print_usage(argv[0]);
+        return 1;
+    }
+
+    bench::run_convert_benchmarks();
+    bench::run_scanner_benchmarks();
+    bench::run_reader_benchmarks();
+    bench::run_writer_benchmarks();
+    return 0;
+}
@@ -0,0 +1,808 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "csv_aggregator.h"
+#include "csv_cache.h"
+#include "csv_dictionary.h"
+#include "csv_parallel_reader.h"
+#include "csv_pipeline.h"
+#include "csv_reader.h"
+#include "csv_row_index.h"
+#include "csv_row_table.h"
+#include "csv_schema.h"
+#include "csv_typed.h"
+
+#include <atomic>
+#include <map>
+#include <random>
+
+namespace bench
+{
+
+namespace
+{
+
+const size_t batch_size = 4096;
+
+const char* get_mode_name(csv::read_mode mode)
+{
+    switch (mode)
+    {
+    case csv::read_mode::mapped:
+        return "mapped";
+    case csv::read_mode::async:
+        return "async";
+    case csv::read_mode::follow:
+        return "follow";
+    default:
+        return "stream";
+    }
+}
+
+std::string make_name(const char* what, const dataset& data, csv::read_mode mode)
+{
+    return std::string(what) + " " + data.name + " " + get_mode_name(mode);
+}
+
+bool open_reader(csv::reader& reader, const dataset& data, csv::read_mode mode)
+{
+    if (!reader.open(data.path, ',', mode))
+    {
+        std::printf("cannot open %s\n", data.path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// the narrow datasets have six columns
+template <typename A, typename B, typename C, typename D, typename E, typename F>
+void bench_read_row(const dataset& data, csv::read_mode mode)
+{
+    const std::string name = make_name("reader::read_row", data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    A a; B b; C c; D d; E e; F f;
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    while (reader.read_row(a, b, c, d, e, f))
+    {
+        checksum += checksum_of(a) + checksum_of(b) + checksum_of(c) +
+                    checksum_of(d) + checksum_of(e) + checksum_of(f);
+        ++rows;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+
+#if defined(CSV_HAVE_STATS)
+    const csv::reader_stats stats = reader.get_stats();
+    std::printf("%-56s io %.1f ms, tokenize %.1f ms, convert %.1f ms, %llu conversion failures\n", "",
+                stats.io_time / 1e6, stats.tokenize_time / 1e6, stats.convert_time / 1e6,
+                static_cast<unsigned long long>(stats.conversion_failures));
+#endif
+}
+
+void bench_row_get(const dataset& data, csv::read_mode mode)
+{
+    const std::string name = make_name("row::get", data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    uint64_t checksum = 0;
+    size_t rows = 0;
+    std::string text;
+
+    timer t;
+    while (reader.next_row())
+    {
+        const csv::reader::row& row = reader.get_row();
+        for (size_t i = 0; i < data.columns.size(); ++i)
+        {
+            switch (data.columns[i])
+            {
+            case column_type::integer:
+                checksum += checksum_of(row.get<long long>(i));
+                break;
+            case column_type::real:
+                checksum += checksum_of(row.get<double>(i));
+                break;
+            case column_type::text:
+            case column_type::category:
+                row.get(i, text);
+                checksum += checksum_of(text);
+                break;
+            }
+        }
+        ++rows;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+// four columns out of the hundred of the wide dataset, either spread over
+// the whole row or all at its start
+void bench_projection(const dataset& data, csv::read_mode mode, bool leading)
+{
+    const std::string name = make_name(leading ? "select_cols read_row 4/100 leading" : "select_cols read_row 4/100",
+                                       data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    if (leading)
+    {
+        reader.select_cols("c0", "c1", "c2", "c3");
+    }
+    else
+    {
+        reader.select_cols("c0", "c10", "c50", "c99");
+    }
+
+    long long a = 0;
+    double b = 0;
+    double c = 0;
+    double d = 0;
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    while (reader.read_row(a, b, c, d))
+    {
+        checksum += checksum_of(a) + checksum_of(b) + checksum_of(c) + checksum_of(d);
+        ++rows;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+// every field converted on the pipeline's workers, as in bench_row_get
+void bench_pipeline(const dataset& data, size_t num_workers)
+{
+    const std::string name = "pipeline process_rows row::get " + data.name + " x" + std::to_string(num_workers);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, csv::read_mode::mapped))
+    {
+        return;
+    }
+
+    csv::pipeline rows;
+    rows.set_num_workers(num_workers);
+
+    std::atomic<uint64_t> checksum(0);
+    std::atomic<size_t> num_rows(0);
+
+    timer t;
+    rows.process_batches(reader, [&](const csv::pipeline::batch& batch)
+    {
+        uint64_t batch_checksum = 0;
+        std::string text;
+        for (size_t r = 0; r < batch.size(); ++r)
+        {
+            const csv::row_table::row_view row = batch[r];
+            for (size_t i = 0; i < data.columns.size(); ++i)
+            {
+                switch (data.columns[i])
+                {
+                case column_type::integer:
+                    batch_checksum += checksum_of(row.get<long long>(i));
+                    break;
+                case column_type::real:
+                    batch_checksum += checksum_of(row.get<double>(i));
+                    break;
+                case column_type::text:
+                case column_type::category:
+                    row.get(i, text);
+                    batch_checksum += checksum_of(text);
+                    break;
+                }
+            }
+        }
+
+        checksum += batch_checksum;
+        num_rows += batch.size();
+    });
+
+    report(name, t, num_rows, data.bytes, checksum);
+}
+
+// grep-like scan keeping the rows whose first field ends in "7", about one
+// in ten, and reading every field of those
+void bench_filter_first(const dataset& data, csv::read_mode mode, bool lazy)
+{
+    const std::string name = make_name(lazy ? "filter col0 next_row lazy" : "filter col0 next_row", data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    reader.set_lazy(lazy);
+
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    while (reader.next_row())
+    {
+        const csv::reader::row& row = reader.get_row();
+        const csv::field_view key = row.get_field(0);
+        if (!key.empty() && (key[key.size() - 1] == '7'))
+        {
+            for (size_t i = 0; i < row.size(); ++i)
+            {
+                checksum += row.get_field(i).size();
+            }
+        }
+        ++rows;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+// about 5% of the rows of the wide dataset, with c50 between -2500 and
+// 2500, tested before conversion by the reader or after it by the caller
+void bench_filter_range(const dataset& data, csv::read_mode mode, bool pushdown)
+{
+    const std::string name = make_name(pushdown ? "filter c50 range read_row 3/100 set_filter"
+                                                : "filter c50 range read_row 3/100 converted",
+                                       data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    int c0 = 0;
+    double c10 = 0;
+    double c50 = 0;
+    int c99 = 0;
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    if (pushdown)
+    {
+        reader.set_filter(csv::predicate::between("c50", -2500.0, 2500.0));
+        reader.select_cols("c0", "c10", "c99");
+        while (reader.read_row(c0, c10, c99))
+        {
+            checksum += checksum_of(c0) + checksum_of(c10) + checksum_of(c99);
+            ++rows;
+        }
+    }
+    else
+    {
+        reader.select_cols("c0", "c10", "c50", "c99");
+        while (reader.read_row(c0, c10, c50, c99))
+        {
+            if ((c50 >= -2500.0) && (c50 <= 2500.0))
+            {
+                checksum += checksum_of(c0) + checksum_of(c10) + checksum_of(c99);
+                ++rows;
+            }
+        }
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+// four fields of the wide dataset per row, looked up by name in every row
+// or through handles looked up once
+void bench_get_by_name(const dataset& data, csv::read_mode mode, bool handles)
+{
+    const std::string name = make_name(handles ? "row::get column_handle 4/100" : "row::get get_column_index 4/100",
+                                       data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    const char* names[] = { "c0", "c10", "c50", "c99" };
+    csv::column_handle columns[4];
+    for (size_t i = 0; i < 4; ++i)
+    {
+        columns[i] = reader.get_column(names[i]);
+    }
+
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    while (reader.next_row())
+    {
+        const csv::reader::row& row = reader.get_row();
+        for (size_t i = 0; i < 4; ++i)
+        {
+            const size_t index = handles ? columns[i].get_index() : reader.get_column_index(names[i]);
+            checksum += row.get_field(index).size();
+        }
+        ++rows;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+// the columns of bench_projection bound by a typed_reader, which has to be
+// as fast as select_cols and read_row
+void bench_typed_projection(const dataset& data, csv::read_mode mode, bool leading)
+{
+    const std::string name = make_name(leading ? "typed_reader read_row 4/100 leading" : "typed_reader read_row 4/100",
+                                       data, mode);
+    csv::typed_reader<long long, double, double, double> reader;
+    if (!selected(name))
+    {
+        return;
+    }
+
+    const std::vector<std::string> columns = leading ? std::vector<std::string>{ "c0", "c1", "c2", "c3" }
+                                                     : std::vector<std::string>{ "c0", "c10", "c50", "c99" };
+    if (!reader.open(data.path, columns, ',', mode))
+    {
+        std::printf("cannot open %s\n", data.path.c_str());
+        return;
+    }
+
+    long long a = 0;
+    double b = 0;
+    double c = 0;
+    double d = 0;
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    while (reader.read_row(a, b, c, d))
+    {
+        checksum += checksum_of(a) + checksum_of(b) + checksum_of(c) + checksum_of(d);
+        ++rows;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+void bench_read_batch(const dataset& data, csv::read_mode mode)
+{
+    const std::string name = make_name("select_cols read_batch 4/100", data, mode);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, mode))
+    {
+        return;
+    }
+
+    reader.select_cols("c0", "c10", "c50", "c99");
+
+    std::vector<long long> a;
+    std::vector<double> b;
+    std::vector<double> c;
+    std::vector<long long> d;
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    timer t;
+    for (size_t n = reader.read_batch(batch_size, a, b, c, d); n > 0; n = reader.read_batch(batch_size, a, b, c, d))
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            checksum += checksum_of(a[i]) + checksum_of(b[i]) + checksum_of(c[i]) + checksum_of(d[i]);
+        }
+        rows += n;
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+// keeping every row of a dataset in memory, as a join would
+void bench_retain_rows(const dataset& data, bool use_table)
+{
+    const std::string name = make_name(use_table ? "retain row_table" : "retain vector<row>", data, csv::read_mode::mapped);
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, csv::read_mode::mapped))
+    {
+        return;
+    }
+
+    csv::row_table table;
+    std::vector<csv::reader::row> rows;
+    uint64_t checksum = 0;
+
+    timer t;
+    while (reader.next_row())
+    {
+        if (use_table)
+        {
+            table.push_back(reader.get_row());
+        }
+        else
+        {
+            rows.push_back(reader.get_row());
+        }
+    }
+
+    const size_t num_rows = use_table ? table.size() : rows.size();
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        checksum += use_table ? table[i].get_field(0).size() : rows[i].get_field(0).size();
+    }
+    t.stop();
+
+    report(name, t, num_rows, data.bytes, checksum);
+    if (use_table && (num_rows > 0))
+    {
+        std::printf("%-56s %10.1f bytes/row (%.1f for the text)\n", "", static_cast<double>(table.memory_usage()) / num_rows,
+                    static_cast<double>(data.bytes) / num_rows);
+    }
+}
+
+void bench_row_index(const dataset& data)
+{
+    const std::string build_name = "row_index::build " + data.name;
+    const std::string seek_name = "reader::seek " + data.name + " mapped";
+    if (!selected(build_name) && !selected(seek_name))
+    {
+        return;
+    }
+
+    csv::row_index index;
+    timer t;
+    index.build(data.path.c_str());
+    t.stop();
+
+    if (selected(build_name))
+    {
+        report(build_name, t, index.get_num_rows(), data.bytes, index.get_num_rows());
+    }
+
+    csv::reader reader;
+    if (!selected(seek_name) || !open_reader(reader, data, csv::read_mode::mapped) || index.empty())
+    {
+        return;
+    }
+
+    const size_t num_seeks = 10000;
+    std::mt19937_64 rng(42);
+    uint64_t checksum = 0;
+
+    timer seek_timer;
+    for (size_t i = 0; i < num_seeks; ++i)
+    {
+        if (reader.seek(index, static_cast<size_t>(rng() % index.get_num_rows())) && reader.next_row())
+        {
+            checksum += reader.get_row().get_field(0).size();
+        }
+    }
+    seek_timer.stop();
+
+    report(seek_name, seek_timer, num_seeks, 0, checksum);
+}
+
+// sum of c3 per value of c0, which is nearly unique, or of all rows; by
+// hand with read_row() and a std::map, or with an aggregator over a
+// reader or a parallel_reader with num_threads threads
+void bench_aggregate(const dataset& data, bool grouped, const char* how, size_t num_threads)
+{
+    std::string name = std::string(grouped ? "sum c3 group_by c0 " : "sum c3 ") + data.name + " " + how;
+    if (num_threads > 0)
+    {
+        name += " x" + std::to_string(num_threads);
+    }
+
+    if (!selected(name))
+    {
+        return;
+    }
+
+    csv::aggregator sums;
+    if (grouped)
+    {
+        sums.group_by({ "c0" });
+    }
+    sums.add(csv::aggregate::sum, "c3");
+
+    uint64_t checksum = 0;
+    size_t rows = 0;
+    timer t;
+    if (num_threads > 0)
+    {
+        csv::parallel_reader reader;
+        reader.set_num_threads(num_threads);
+        if (!reader.open(data.path) || !sums.run(reader))
+        {
+            return;
+        }
+    }
+    else
+    {
+        csv::reader reader;
+        if (!open_reader(reader, data, csv::read_mode::mapped))
+        {
+            return;
+        }
+
+        if (std::string(how) == "aggregator")
+        {
+            sums.run(reader);
+        }
+        else
+        {
+            std::map<std::string, double> totals;
+            std::string key;
+            double value = 0;
+            reader.select_cols("c0", "c3");
+            while (reader.read_row(key, value))
+            {
+                totals[grouped ? key : std::string()] += value;
+                ++rows;
+            }
+
+            for (const auto& total : totals)
+            {
+                checksum += checksum_of(total.second);
+            }
+        }
+    }
+
+    for (const csv::aggregator::group& group : sums.get_groups())
+    {
+        rows += group.rows;
+        checksum += checksum_of(group.values[0]);
+    }
+
+    t.stop();
+    report(name, t, rows, data.bytes, checksum);
+}
+
+void bench_sniff(const dataset& data)
+{
+    const std::string prefix_name = "sniff " + data.name;
+    const std::string index_name = "sniff " + data.name + " [row_index]";
+    if (!selected(prefix_name) && !selected(index_name))
+    {
+        return;
+    }
+
+    const size_t iterations = 20;
+    csv::schema layout;
+    if (selected(prefix_name))
+    {
+        uint64_t checksum = 0;
+        timer t;
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            csv::sniff(data.path.c_str(), layout);
+            checksum += layout.num_rows_sampled;
+        }
+        t.stop();
+        report(prefix_name, t, checksum, 0, checksum);
+    }
+
+    csv::row_index index;
+    if (selected(index_name) && index.build(data.path.c_str()))
+    {
+        uint64_t checksum = 0;
+        timer t;
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            csv::sniff(data.path.c_str(), index, layout);
+            checksum += layout.num_rows_sampled;
+        }
+        t.stop();
+        report(index_name, t, checksum, 0, checksum);
+    }
+}
+
+// building the cache of a file, loading it back and summing one of its
+// columns, against reading that column from the text
+void bench_cache(const dataset& data)
+{
+    const std::string build_name = "cache::build " + data.name;
+    const std::string load_name = "cache::load " + data.name;
+    const std::string read_name = "sum c3 " + data.name + " read_row c3";
+    const std::string sum_name = "sum c3 " + data.name + " cache::get_reals";
+    if (!selected(build_name) && !selected(load_name) && !selected(read_name) && !selected(sum_name))
+    {
+        return;
+    }
+
+    if (selected(read_name))
+    {
+        csv::reader reader;
+        if (!open_reader(reader, data, csv::read_mode::mapped))
+        {
+            return;
+        }
+
+        double total = 0;
+        double value = 0;
+        size_t rows = 0;
+        timer t;
+        reader.select_cols("c3");
+        while (reader.read_row(value))
+        {
+            total += value;
+            ++rows;
+        }
+        t.stop();
+        report(read_name, t, rows, data.bytes, checksum_of(total));
+    }
+
+    const std::string path = csv::cache::get_sidecar_path(data.path.c_str());
+    csv::cache built;
+    timer build_timer;
+    if (!built.build(data.path.c_str()) || !built.save(path.c_str()))
+    {
+        std::printf("cannot build the cache of %s\n", data.path.c_str());
+        return;
+    }
+    build_timer.stop();
+
+    if (selected(build_name))
+    {
+        report(build_name, build_timer, built.get_num_rows(), data.bytes, built.get_num_rows());
+    }
+
+    csv::cache loaded;
+    timer load_timer;
+    const bool is_loaded = loaded.load(path.c_str());
+    load_timer.stop();
+    if (!is_loaded)
+    {
+        return;
+    }
+
+    if (selected(load_name))
+    {
+        report(load_name, load_timer, loaded.get_num_rows(), 0, loaded.get_num_rows());
+    }
+
+    const size_t column = loaded.get_column_index("c3");
+    const double* values = (column != size_t(-1)) ? loaded.get_reals(column) : nullptr;
+    if (selected(sum_name) && (values != nullptr))
+    {
+        double total = 0;
+        timer t;
+        for (size_t row = 0; row < loaded.get_num_rows(); ++row)
+        {
+            total += values[row];
+        }
+        t.stop();
+        report(sum_name, t, loaded.get_num_rows(), data.bytes, checksum_of(total));
+    }
+}
+
+// the three category columns into std::strings, or through a dictionary
+void bench_interned(const dataset& data, bool interned)
+{
+    const std::string name = std::string("read_row c1,c2,c4 ") + data.name + (interned ? " interned" : " std::string");
+    csv::reader reader;
+    if (!selected(name) || !open_reader(reader, data, csv::read_mode::mapped))
+    {
+        return;
+    }
+
+    reader.select_cols("c1", "c2", "c4");
+
+    uint64_t checksum = 0;
+    size_t rows = 0;
+    timer t;
+    if (interned)
+    {
+        csv::dictionary values;
+        csv::interned a(values), b(values), c(values);
+        while (reader.read_row(a, b, c))
+        {
+            checksum += a.get_code() + b.get_code() + c.get_code();
+            ++rows;
+        }
+    }
+    else
+    {
+        // codes given by hand, as a std::string key has to be looked up too
+        std::map<std::string, uint64_t> codes;
+        std::string a, b, c;
+        while (reader.read_row(a, b, c))
+        {
+            for (const std::string* value : { &a, &b, &c })
+            {
+                auto code = codes.find(*value);
+                if (code == codes.end())
+                {
+                    code = codes.emplace(*value, codes.size()).first;
+                }
+                checksum += code->second;
+            }
+            ++rows;
+        }
+    }
+
+    report(name, t, rows, data.bytes, checksum);
+}
+
+} // namespace
+
+void run_reader_benchmarks()
+{
+    bench_row_index(get_dataset("narrow_quoted"));
+    bench_cache(get_dataset("narrow_numeric"));
+    bench_interned(get_dataset("narrow_category"), false);
+    bench_interned(get_dataset("narrow_category"), true);
+    bench_sniff(get_dataset("wide_numeric"));
+    for (bool grouped : { false, true })
+    {
+        bench_aggregate(get_dataset("narrow_text"), grouped, "read_row std::map", 0);
+        bench_aggregate(get_dataset("narrow_text"), grouped, "aggregator", 0);
+        bench_aggregate(get_dataset("narrow_text"), grouped, "aggregator parallel_reader", 1);
+        bench_aggregate(get_dataset("narrow_text"), grouped, "aggregator parallel_reader", 4);
+    }
+    bench_sniff(get_dataset("narrow_quoted"));
+    bench_read_row<int, long long, double, double, int, double>(get_dataset("narrow_numeric"), csv::read_mode::follow);
+    bench_pipeline(get_dataset("narrow_numeric"), 1);
+    bench_pipeline(get_dataset("narrow_numeric"), 4);
+
+    const csv::read_mode modes[] = { csv::read_mode::stream, csv::read_mode::mapped, csv::read_mode::async };
+    for (csv::read_mode mode : modes)
+    {
+        bench_read_row<int, long long, double, double, int, double>(get_dataset("narrow_numeric"), mode);
+        bench_read_row<int, std::string, std::string, double, std::string, std::string>(get_dataset("narrow_text"), mode);
+        bench_read_row<int, std::string, std::string, double, std::string, std::string>(get_dataset("narrow_quoted"), mode);
+
+        for (const dataset& data : get_datasets())
+        {
+            bench_row_get(data, mode);
+        }
+
+        if (mode == csv::read_mode::mapped)
+        {
+            bench_retain_rows(get_dataset("narrow_text"), false);
+            bench_retain_rows(get_dataset("narrow_text"), true);
+        }
+
+        bench_projection(get_dataset("wide_numeric"), mode, false);
+        bench_projection(get_dataset("wide_numeric"), mode, true);
+        bench_typed_projection(get_dataset("wide_numeric"), mode, false);
+        bench_typed_projection(get_dataset("wide_numeric"), mode, true);
+        bench_read_batch(get_dataset("wide_numeric"), mode);
+        bench_get_by_name(get_dataset("wide_numeric"), mode, false);
+        bench_get_by_name(get_dataset("wide_numeric"), mode, true);
+
+        bench_filter_first(get_dataset("narrow_text"), mode, false);
+        bench_filter_first(get_dataset("narrow_text"), mode, true);
+        bench_filter_first(get_dataset("wide_numeric"), mode, false);
+        bench_filter_first(get_dataset("wide_numeric"), mode, true);
+        bench_filter_range(get_dataset("wide_numeric"), mode, false);
+        bench_filter_range(get_dataset("wide_numeric"), mode, true);
+    }
+}
+
+} // namespace bench
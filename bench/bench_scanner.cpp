@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "csv_scanner.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace bench
+{
+
+namespace
+{
+
+void bench_scan_lines(const dataset& data, const std::string& content, csv::detail::simd_level level)
+{
+    const std::string name = std::string("detail::scan_line ") + data.name + " " +
+                             csv::detail::get_simd_level_name(level);
+    if (!selected(name) || !csv::detail::set_simd_level(level))
+    {
+        return;
+    }
+
+    std::vector<std::streamoff> offsets;
+    uint64_t checksum = 0;
+    size_t rows = 0;
+
+    const char* pos = content.data();
+    const char* end = pos + content.size();
+
+    timer t;
+    while (pos < end)
+    {
+        pos = csv::detail::scan_line(pos, end, ',', offsets) + 1;
+        checksum += offsets.size();
+        ++rows;
+    }
+
+    report(name, t, rows, content.size(), checksum);
+}
+
+} // namespace
+
+void run_scanner_benchmarks()
+{
+    const csv::detail::simd_level default_level = csv::detail::get_simd_level();
+    const csv::detail::simd_level levels[] =
+    {
+        csv::detail::simd_level::scalar,
+        csv::detail::simd_level::sse2,
+        csv::detail::simd_level::avx2,
+        csv::detail::simd_level::neon
+    };
+
+    for (const dataset& data : get_datasets())
+    {
+        std::ifstream file(data.path, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+
+        for (csv::detail::simd_level level : levels)
+        {
+            bench_scan_lines(data, content.str(), level);
+        }
+    }
+
+    csv::detail::set_simd_level(default_level);
+}
+
+} // namespace bench
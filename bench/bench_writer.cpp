@@ -0,0 +1,267 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "bench.h"
+#include "csv_writer.h"
+
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace bench
+{
+
+namespace
+{
+
+size_t get_file_size(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+}
+
+std::string get_output_path()
+{
+    return get_options().data_dir + "/libcsv_bench_output.csv";
+}
+
+// Counts the bytes going through to another sink.
+class counting_sink : public csv::byte_sink
+{
+public:
+    counting_sink(std::unique_ptr<csv::byte_sink> sink, size_t& count)
+        : m_sink(std::move(sink)),
+          m_count(count)
+    {
+    }
+
+    bool write(const char* data, size_t size) override
+    {
+        m_count += size;
+        return m_sink->write(data, size);
+    }
+
+    bool flush() override
+    {
+        return m_sink->flush();
+    }
+
+    bool close() override
+    {
+        return m_sink->close();
+    }
+
+private:
+    std::unique_ptr<csv::byte_sink> m_sink;
+    size_t& m_count;
+};
+
+const char* get_compression_name(csv::compression format)
+{
+    switch (format)
+    {
+    case csv::compression::gzip:
+        return "gzip";
+    case csv::compression::zstd:
+        return "zstd";
+    case csv::compression::lz4:
+        return "lz4";
+    default:
+        return "none";
+    }
+}
+
+// same shape as the narrow_numeric dataset; the reported bytes are the
+// uncompressed ones
+void bench_write_row(size_t num_rows, csv::compression format, size_t num_threads)
+{
+    std::string name = "writer::write_row narrow_numeric";
+    if (format != csv::compression::none)
+    {
+        name += std::string(" ") + get_compression_name(format) + " x" + std::to_string(num_threads);
+    }
+
+    if (!selected(name) || !csv::can_compress(format))
+    {
+        return;
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<int> ints(num_rows);
+    std::vector<double> reals(num_rows);
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        ints[i] = static_cast<int>(rng() % 2000000) - 1000000;
+        reals[i] = static_cast<double>(rng() % 100000000) / 1000.0 - 50000.0;
+    }
+
+    const std::string path = get_output_path();
+    csv::compression_options options;
+    options.num_threads = num_threads;
+
+    size_t bytes = 0;
+    timer t;
+    {
+        csv::writer writer;
+        writer.open(std::unique_ptr<csv::byte_sink>(new counting_sink(csv::open_file_sink(path.c_str(), format, options), bytes)));
+        writer.set_column_names("c0", "c1", "c2", "c3", "c4", "c5");
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            writer.write_row(ints[i], static_cast<long long>(ints[i]) * 1000, reals[i],
+                             reals[i] * 2, ints[i] / 2, reals[i] / 3);
+        }
+    }
+    t.stop();
+
+    report(name, t, num_rows, bytes, get_file_size(path));
+    std::remove(path.c_str());
+}
+
+// same shape as the wide_numeric dataset, one write_column per cell
+void bench_new_row(size_t num_rows)
+{
+    const std::string name = "writer::new_row wide_numeric";
+    if (!selected(name))
+    {
+        return;
+    }
+
+    const size_t num_columns = 100;
+
+    std::mt19937_64 rng(42);
+    std::vector<double> reals(num_rows);
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        reals[i] = static_cast<double>(rng() % 100000000) / 1000.0 - 50000.0;
+    }
+
+    std::vector<std::string> column_names;
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        column_names.push_back("c" + std::to_string(i));
+    }
+
+    const std::string path = get_output_path();
+
+    timer t;
+    {
+        csv::writer writer;
+        writer.open(path);
+        writer.set_column_names(column_names);
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            csv::writer::row row = writer.new_row();
+            for (size_t j = 0; j < num_columns; ++j)
+            {
+                if (j % 3 == 0)
+                {
+                    row.write_column(static_cast<long long>(reals[i]) + static_cast<long long>(j));
+                }
+                else
+                {
+                    row.write_column(reals[i] + j);
+                }
+            }
+        }
+    }
+    t.stop();
+
+    const size_t bytes = get_file_size(path);
+    report(name, t, num_rows, bytes, bytes);
+    std::remove(path.c_str());
+}
+
+// the rows of bench_write_row split in contiguous ranges, each formatted
+// into its own shard on its own thread and merged in order
+void bench_write_shards(size_t num_rows, size_t num_threads)
+{
+    const std::string name = "writer::shard write_row narrow_numeric x" + std::to_string(num_threads);
+    if (!selected(name))
+    {
+        return;
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<int> ints(num_rows);
+    std::vector<double> reals(num_rows);
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        ints[i] = static_cast<int>(rng() % 2000000) - 1000000;
+        reals[i] = static_cast<double>(rng() % 100000000) / 1000.0 - 50000.0;
+    }
+
+    const std::string path = get_output_path();
+
+    size_t bytes = 0;
+    timer t;
+    {
+        csv::writer writer;
+        writer.open(std::unique_ptr<csv::byte_sink>(new counting_sink(csv::open_file_sink(path.c_str()), bytes)));
+        writer.set_column_names("c0", "c1", "c2", "c3", "c4", "c5");
+
+        std::vector<std::thread> threads;
+        for (size_t shard_index = 0; shard_index < num_threads; ++shard_index)
+        {
+            const size_t begin = num_rows * shard_index / num_threads;
+            const size_t end = num_rows * (shard_index + 1) / num_threads;
+            csv::writer::shard shard = writer.new_shard();
+
+            threads.emplace_back([&ints, &reals, begin, end](csv::writer::shard rows)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    rows.write_row(ints[i], static_cast<long long>(ints[i]) * 1000, reals[i],
+                                   reals[i] * 2, ints[i] / 2, reals[i] / 3);
+                }
+                rows.close();
+            }, std::move(shard));
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+    t.stop();
+
+    report(name, t, num_rows, bytes, get_file_size(path));
+    std::remove(path.c_str());
+}
+
+} // namespace
+
+void run_writer_benchmarks()
+{
+    // rows of about the same total size as the read datasets
+    const size_t narrow_rows = get_dataset("narrow_numeric").rows;
+    bench_write_row(narrow_rows, csv::compression::none, 1);
+    bench_write_shards(narrow_rows, 1);
+    bench_write_shards(narrow_rows, 4);
+    bench_write_row(narrow_rows, csv::compression::gzip, 1);
+    bench_write_row(narrow_rows, csv::compression::gzip, 4);
+    bench_write_row(narrow_rows, csv::compression::zstd, 1);
+    bench_write_row(narrow_rows, csv::compression::zstd, 4);
+    bench_new_row(get_dataset("wide_numeric").rows);
+}
+
+} // namespace bench
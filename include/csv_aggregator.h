@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_AGGREGATOR_H
+#define CSV_AGGREGATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+class reader;
+class parallel_reader;
+
+// What an aggregator computes for a column, per group.
+enum class aggregate
+{
+    // rows of the group, whatever the column
+    count,
+    // of the fields that convert to a double, the others are skipped
+    sum,
+    min,
+    max,
+    mean
+};
+
+// Groups rows by the values of some columns and aggregates other columns
+// per group:
+//
+//     csv::aggregator totals;
+//     totals.group_by({ "country" });
+//     totals.add(csv::aggregate::sum, "price");
+//     totals.add(csv::aggregate::count);
+//     totals.run(file);
+//
+// Rows are gathered in batches, with the group of every row looked up in
+// a hash table and the values of each column converted into an array of
+// doubles; the aggregates are then computed over the whole batch. With a
+// parallel_reader every thread aggregates its chunks on its own and the
+// partial results are merged at the end. Sums are added up in a different
+// order than row after row, so they can differ in the last bits.
+class aggregator
+{
+public:
+    struct group
+    {
+        // values of the columns grouped by, as in the file
+        std::vector<std::string> keys;
+        uint64_t rows = 0;
+        // one per add(), in order; min, max and mean are NaN for groups
+        // where no field converted
+        std::vector<double> values;
+    };
+
+    aggregator() = default;
+
+    // Groups by the values of the columns, rows that don't have one of
+    // them count as an empty field. Without columns all the rows are one
+    // group.
+    void group_by(std::vector<std::string> columns)
+    {
+        m_key_names = std::move(columns);
+    }
+
+    void add(aggregate function, std::string column = std::string());
+
+    // Aggregates the remaining rows of file on the calling thread, with
+    // its filter. Returns false if a column isn't in the file.
+    bool run(reader& file);
+    // Aggregates the whole file on the reader's threads.
+    bool run(parallel_reader& file);
+
+    // The groups of the last run(), sorted by their keys as text.
+    const std::vector<group>& get_groups() const
+    {
+        return m_groups;
+    }
+
+private:
+    std::vector<std::string> m_key_names;
+    // what add() asked for, in order
+    std::vector<aggregate> m_functions;
+    std::vector<std::string> m_columns;
+    std::vector<group> m_groups;
+};
+
+} // namespace csv
+
+#endif // CSV_AGGREGATOR_H
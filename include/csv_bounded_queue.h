@@ -0,0 +1,204 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CSV_BOUNDED_QUEUE_H
+#define CSV_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+namespace csv
+{
+
+namespace detail
+{
+    // Waits for another thread to make progress: yields at first, then
+    // sleeps so that idle threads don't keep a core busy.
+    class backoff
+    {
+    public:
+        backoff()
+            : m_count(0)
+        {
+        }
+
+        void wait()
+        {
+            if (++m_count < 64)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+    private:
+        unsigned m_count;
+    };
+
+    // Bounded multi-producer multi-consumer queue without locks (Vyukov's
+    // ring of sequenced cells). Each cell's sequence number tells whether it
+    // is ready for the push or the pop of that round, so pushes and pops
+    // only contend on their own position counter.
+    template <typename T>
+    class bounded_queue
+    {
+    public:
+        // The capacity is rounded up to a power of two.
+        explicit bounded_queue(size_t capacity);
+        bounded_queue(const bounded_queue&) = delete;
+        bounded_queue& operator=(const bounded_queue&) = delete;
+
+        // Fail right away when the queue is full or empty.
+        bool try_push(const T& value);
+        bool try_pop(T& value);
+
+        // Wait until there is room or an item.
+        void push(const T& value)
+        {
+            backoff waiter;
+            while (!try_push(value))
+            {
+                waiter.wait();
+            }
+        }
+
+        T pop()
+        {
+            T value;
+            backoff waiter;
+            while (!try_pop(value))
+            {
+                waiter.wait();
+            }
+
+            return value;
+        }
+
+    private:
+        struct cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<cell[]> m_cells;
+        size_t m_mask;
+
+        // on their own cache lines, producers and consumers don't share
+        char m_padding0[64];
+        std::atomic<size_t> m_push_pos;
+        char m_padding1[64];
+        std::atomic<size_t> m_pop_pos;
+        char m_padding2[64];
+    };
+
+    template <typename T>
+    bounded_queue<T>::bounded_queue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+
+        m_cells.reset(new cell[size]);
+        m_mask = size - 1;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        m_push_pos.store(0, std::memory_order_relaxed);
+        m_pop_pos.store(0, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    bool bounded_queue<T>::try_push(const T& value)
+    {
+        size_t pos = m_push_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell& slot = m_cells[pos & m_mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == pos)
+            {
+                if (m_push_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos)
+            {
+                // the cell still holds the item of the previous round
+                return false;
+            }
+            else
+            {
+                pos = m_push_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    template <typename T>
+    bool bounded_queue<T>::try_pop(T& value)
+    {
+        size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell& slot = m_cells[pos & m_mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == pos + 1)
+            {
+                if (m_pop_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = slot.value;
+                    slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < pos + 1)
+            {
+                // nothing pushed in the cell yet
+                return false;
+            }
+            else
+            {
+                pos = m_pop_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_BOUNDED_QUEUE_H
@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_BYTE_SINK_H
+#define CSV_BYTE_SINK_H
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+
+namespace csv
+{
+
+// Where a writer puts its bytes. write() is called with whole buffers of
+// formatted rows (see writer::set_buffer_size), never once per row.
+class byte_sink
+{
+public:
+    virtual ~byte_sink() = default;
+
+    // All return false on errors.
+    virtual bool write(const char* data, size_t size) = 0;
+    // Pushes everything written so far to its destination.
+    virtual bool flush()
+    {
+        return true;
+    }
+    // Finishes the output, e.g. writes the trailer of a compressed stream.
+    // Nothing can be written afterwards.
+    virtual bool close()
+    {
+        return flush();
+    }
+};
+
+class file_sink : public byte_sink
+{
+public:
+    bool open(const char* filename, std::ios_base::openmode mode = std::ios_base::out | std::ios_base::binary);
+
+    bool is_open() const
+    {
+        return m_file.is_open();
+    }
+
+    bool write(const char* data, size_t size) override;
+    bool flush() override;
+    bool close() override;
+
+private:
+    std::ofstream m_file;
+};
+
+// Appends everything to a string, which must outlive the sink.
+class string_sink : public byte_sink
+{
+public:
+    explicit string_sink(std::string& output)
+        : m_output(output)
+    {
+    }
+
+    bool write(const char* data, size_t size) override
+    {
+        m_output.append(data, size);
+        return true;
+    }
+
+private:
+    std::string& m_output;
+};
+
+// Any std::ostream, e.g. std::cout for a pipe. The stream must outlive
+// the sink and isn't closed by it.
+class stream_sink : public byte_sink
+{
+public:
+    explicit stream_sink(std::ostream& stream)
+        : m_stream(stream)
+    {
+    }
+
+    bool write(const char* data, size_t size) override;
+    bool flush() override;
+
+private:
+    std::ostream& m_stream;
+};
+
+// Calls a function for every buffer written, e.g. to send it over a
+// socket. It returns false on errors.
+class callback_sink : public byte_sink
+{
+public:
+    typedef std::function<bool(const char* data, size_t size)> callback;
+
+    explicit callback_sink(callback fn)
+        : m_fn(std::move(fn))
+    {
+    }
+
+    bool write(const char* data, size_t size) override
+    {
+        return m_fn(data, size);
+    }
+
+private:
+    callback m_fn;
+};
+
+} // namespace csv
+
+#endif // CSV_BYTE_SINK_H
@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_BYTE_SOURCE_H
+#define CSV_BYTE_SOURCE_H
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <utility>
+
+namespace csv
+{
+
+// Where a reader gets its bytes from. read() is called a whole block at a
+// time (see reader::set_block_size) from the reader's prefetch thread,
+// never once per row, so a virtual call is fine there.
+class byte_source
+{
+public:
+    virtual ~byte_source() = default;
+
+    // Reads up to size bytes into buffer and returns how many were read,
+    // which can be fewer. Returns 0 only at the end of the data or after
+    // an error.
+    virtual size_t read(char* buffer, size_t size) = 0;
+
+    // Whether read() returned 0 because of an error, e.g. a compressed
+    // stream that is corrupt or cut short, rather than at the end.
+    virtual bool failed() const
+    {
+        return false;
+    }
+};
+
+class file_source : public byte_source
+{
+public:
+    bool open(const char* filename);
+
+    bool is_open() const
+    {
+        return m_file.is_open();
+    }
+
+    size_t read(char* buffer, size_t size) override;
+
+    bool failed() const override
+    {
+        return m_file.bad();
+    }
+
+private:
+    std::ifstream m_file;
+};
+
+// Bytes already in memory, which must outlive the source. Readers can
+// also parse such a buffer in place, see reader::open_buffer.
+class memory_source : public byte_source
+{
+public:
+    memory_source(const char* data, size_t size)
+        : m_data(data),
+          m_size(size),
+          m_pos(0)
+    {
+    }
+
+    size_t read(char* buffer, size_t size) override;
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos;
+};
+
+// Any std::istream, e.g. std::cin for a pipe. The stream must outlive the
+// source.
+class stream_source : public byte_source
+{
+public:
+    explicit stream_source(std::istream& stream)
+        : m_stream(stream)
+    {
+    }
+
+    size_t read(char* buffer, size_t size) override;
+
+    bool failed() const override
+    {
+        return m_stream.bad();
+    }
+
+private:
+    std::istream& m_stream;
+};
+
+// Calls a function for every block, e.g. to read from a socket. It has
+// the same contract as byte_source::read.
+class callback_source : public byte_source
+{
+public:
+    typedef std::function<size_t(char* buffer, size_t size)> callback;
+
+    explicit callback_source(callback fn)
+        : m_fn(std::move(fn))
+    {
+    }
+
+    size_t read(char* buffer, size_t size) override
+    {
+        return m_fn(buffer, size);
+    }
+
+private:
+    callback m_fn;
+};
+
+} // namespace csv
+
+#endif // CSV_BYTE_SOURCE_H
@@ -0,0 +1,203 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_CACHE_H
+#define CSV_CACHE_H
+
+#include "csv_column_index.h"
+#include "csv_field_view.h"
+#include "csv_mapped_file.h"
+#include "csv_schema.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+// The whole of a CSV file converted once into typed columns, to be saved
+// next to it and loaded back by mapping it instead of reading the text
+// again. Columns are either integer (int64_t), real (double) or text,
+// stored as one code per row into a dictionary of the column's distinct
+// values. Empty and missing fields are null, with 0, NaN or the code of
+// the empty text in the column. The offset of every record in the file is
+// kept too.
+//
+// Like row_index, a cache is only loaded back while its file keeps the
+// same size and modification time, and also the same checksum of its
+// first and last 64 KB. It is built in memory from an uncompressed file,
+// in native byte order.
+class cache
+{
+public:
+    cache();
+    cache(const cache&) = delete;
+    cache(cache&&) = default;
+    cache& operator=(const cache&) = delete;
+    cache& operator=(cache&&) = default;
+    ~cache() = default;
+
+    // Converts the file with the layout sniff() guesses, or with the given
+    // one. Booleans and dates are kept as text, and columns whose fields
+    // don't all have the type of the layout go to real or text.
+    bool build(const char* filename);
+    bool build(const char* filename, const schema& layout);
+
+    bool save(const char* path) const;
+    // Maps the cache, fails when it doesn't match its file anymore.
+    bool load(const char* path);
+
+    // Loads the cache saved in the sidecar of filename, or builds and
+    // saves it when there is none or it is out of date.
+    bool load_or_build(const char* filename);
+
+    static std::string get_sidecar_path(const char* filename)
+    {
+        return std::string(filename) + ".csvcache";
+    }
+
+    bool empty() const
+    {
+        return m_columns.empty();
+    }
+
+    const std::string& get_filename() const
+    {
+        return m_filename;
+    }
+
+    char get_delimiter() const
+    {
+        return m_delimiter;
+    }
+
+    // Rows of the file, without the header.
+    size_t get_num_rows() const
+    {
+        return m_num_rows;
+    }
+
+    const std::vector<std::string>& get_column_names() const
+    {
+        return m_column_names;
+    }
+
+    // size_t(-1) when there is no such column
+    size_t get_column_index(const std::string& name) const
+    {
+        return m_column_index.find(m_column_names, name.data(), name.size());
+    }
+
+    // column_type::integer, real or text
+    column_type get_type(size_t column) const
+    {
+        return m_columns[column].type;
+    }
+
+    bool is_null(size_t column, size_t row) const
+    {
+        return (m_columns[column].nulls[row / 64] >> (row % 64)) & 1;
+    }
+
+    // The values of a column, one per row, or nullptr when the column has
+    // another type.
+    const int64_t* get_integers(size_t column) const
+    {
+        return (m_columns[column].type == column_type::integer)
+            ? static_cast<const int64_t*>(m_columns[column].values) : nullptr;
+    }
+
+    const double* get_reals(size_t column) const
+    {
+        return (m_columns[column].type == column_type::real)
+            ? static_cast<const double*>(m_columns[column].values) : nullptr;
+    }
+
+    const uint32_t* get_codes(size_t column) const
+    {
+        return (m_columns[column].type == column_type::text)
+            ? static_cast<const uint32_t*>(m_columns[column].values) : nullptr;
+    }
+
+    // Distinct values of a text column, 0 for other columns.
+    size_t get_dictionary_size(size_t column) const
+    {
+        return m_columns[column].dictionary_size;
+    }
+
+    field_view get_dictionary_value(size_t column, uint32_t code) const
+    {
+        const column_data& data = m_columns[column];
+        const uint64_t begin = data.value_ends[code];
+        return field_view(data.text + begin, static_cast<size_t>(data.value_ends[code + 1] - begin));
+    }
+
+    // The value of a field of a text column, as convert<std::string> reads it.
+    field_view get_text(size_t column, size_t row) const
+    {
+        return get_dictionary_value(column, get_codes(column)[row]);
+    }
+
+    // Offset of the start of row in the file.
+    uint64_t get_record_offset(size_t row) const
+    {
+        return m_record_offsets[row];
+    }
+
+private:
+    // where a column is, in the image
+    struct column_data
+    {
+        column_type type = column_type::text;
+        // one bit per row
+        const uint64_t* nulls = nullptr;
+        const void* values = nullptr;
+        size_t dictionary_size = 0;
+        // dictionary_size + 1 offsets into text, the values are in between
+        const uint64_t* value_ends = nullptr;
+        const char* text = nullptr;
+    };
+
+    bool build_image(const char* filename, const schema& layout);
+    // points the columns into the image
+    bool parse_image(const char* data, size_t size);
+    void clear();
+
+    std::string m_filename;
+    char m_delimiter;
+    size_t m_num_rows;
+    std::vector<std::string> m_column_names;
+    detail::column_name_index m_column_index;
+    std::vector<column_data> m_columns;
+    const uint64_t* m_record_offsets;
+
+    // the bytes of the cache, built in memory or mapped from its file
+    std::vector<char> m_image;
+    detail::mapped_file m_mapping;
+};
+
+} // namespace csv
+
+#endif // CSV_CACHE_H
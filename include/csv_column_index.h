@@ -0,0 +1,225 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CSV_COLUMN_INDEX_H
+#define CSV_COLUMN_INDEX_H
+
+#include "csv_scanner.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+// Index of a column, looked up by name once and reused for every row, see
+// reader::get_column(). Accessing a field through it costs the same as
+// through its index.
+class column_handle
+{
+public:
+    column_handle()
+        : m_index(size_t(-1))
+    {
+    }
+
+    explicit column_handle(size_t index)
+        : m_index(index)
+    {
+    }
+
+    // False when the name it was looked up with isn't a column.
+    bool is_valid() const
+    {
+        return m_index != size_t(-1);
+    }
+
+    size_t get_index() const
+    {
+        return m_index;
+    }
+
+private:
+    size_t m_index;
+};
+
+// Set of columns stored one bit per column, 64 to a word, for projecting
+// rows without testing every column (see reader::select_cols and
+// reader::row::read_columns).
+class column_set
+{
+public:
+    column_set()
+        : m_size(0)
+    {
+    }
+
+    explicit column_set(size_t num_columns, bool selected = false)
+        : m_size(0)
+    {
+        resize(num_columns);
+        if (selected)
+        {
+            set_all();
+        }
+    }
+
+    // Number of columns, set or not.
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    // New columns aren't set.
+    void resize(size_t num_columns)
+    {
+        m_words.resize((num_columns + 63) / 64, 0);
+        m_size = num_columns;
+        clear_tail();
+    }
+
+    void set(size_t column)
+    {
+        m_words[column / 64] |= uint64_t(1) << (column % 64);
+    }
+
+    void reset(size_t column)
+    {
+        m_words[column / 64] &= ~(uint64_t(1) << (column % 64));
+    }
+
+    bool test(size_t column) const
+    {
+        return ((m_words[column / 64] >> (column % 64)) & 1) != 0;
+    }
+
+    void set_all()
+    {
+        std::fill(m_words.begin(), m_words.end(), ~uint64_t(0));
+        clear_tail();
+    }
+
+    void reset_all()
+    {
+        std::fill(m_words.begin(), m_words.end(), uint64_t(0));
+    }
+
+    // Number of set columns.
+    size_t count() const
+    {
+        size_t num_set = 0;
+        for (uint64_t word : m_words)
+        {
+            num_set += detail::popcount(word);
+        }
+
+        return num_set;
+    }
+
+    // First set column at or after column, size() when there is none.
+    size_t find_next(size_t column) const
+    {
+        if (column >= m_size)
+        {
+            return m_size;
+        }
+
+        size_t word = column / 64;
+        uint64_t bits = m_words[word] & (~uint64_t(0) << (column % 64));
+        while (bits == 0)
+        {
+            if (++word == m_words.size())
+            {
+                return m_size;
+            }
+
+            bits = m_words[word];
+        }
+
+        return word * 64 + detail::trailing_zeros(bits);
+    }
+
+    // Calls fn(column) for every set column, in increasing order.
+    template <typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (size_t word = 0; word < m_words.size(); ++word)
+        {
+            for (uint64_t bits = m_words[word]; bits != 0; bits &= bits - 1)
+            {
+                fn(word * 64 + detail::trailing_zeros(bits));
+            }
+        }
+    }
+
+    // The bits themselves, column i is bit i % 64 of word i / 64; bits
+    // past size() are always 0.
+    const std::vector<uint64_t>& get_words() const
+    {
+        return m_words;
+    }
+
+private:
+    void clear_tail()
+    {
+        if (m_size % 64 != 0)
+        {
+            m_words.back() &= (uint64_t(1) << (m_size % 64)) - 1;
+        }
+    }
+
+    std::vector<uint64_t> m_words;
+    size_t m_size;
+};
+
+namespace detail
+{
+    // Hash table from column names to their index, built once from the
+    // header. The first of several columns with the same name wins, as
+    // with a linear search. The names aren't copied, they have to be
+    // passed again to find().
+    class column_name_index
+    {
+    public:
+        void build(const std::vector<std::string>& names);
+        void clear();
+
+        // size_t(-1) when there is no such column
+        size_t find(const std::vector<std::string>& names, const char* name, size_t length) const;
+
+    private:
+        static uint32_t hash(const char* name, size_t length);
+
+        // column index + 1 per slot, 0 for empty ones; the size is a
+        // power of two at least twice the number of columns
+        std::vector<uint32_t> m_slots;
+    };
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_COLUMN_INDEX_H
@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_COMPRESSION_H
+#define CSV_COMPRESSION_H
+
+#include "csv_byte_sink.h"
+#include "csv_byte_source.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace csv
+{
+
+enum class compression
+{
+    none,
+    gzip,
+    zstd,
+    lz4
+};
+
+// Tells the compression format from the first bytes of the data, none
+// when they don't start with a known magic number.
+compression detect_compression(const char* data, size_t size);
+compression detect_file_compression(const char* filename);
+
+struct compression_options
+{
+    // format specific, 0 is the format's default
+    int level = 0;
+    // With more than one thread the output is cut into frames of
+    // frame_size bytes that are compressed independently and in parallel,
+    // then written in order. Every decoder reads such files as one stream.
+    size_t num_threads = 1;
+    size_t frame_size = size_t(4) << 20;
+};
+
+// Whether this build can decompress format. Each decoder is only compiled
+// in when its library was found, see LIBCSV_WITH_ZLIB and friends.
+bool is_supported(compression format);
+// Whether this build can compress to format: gzip and zstd, when their
+// library was found.
+bool can_compress(compression format);
+
+// Wraps source in a streaming decoder for format. Returns source itself
+// for compression::none and null when format isn't supported.
+std::unique_ptr<byte_source> make_decompressor(std::unique_ptr<byte_source> source, compression format);
+
+// Wraps sink in a streaming encoder for format. Returns sink itself for
+// compression::none and null when format can't be compressed to.
+std::unique_ptr<byte_sink> make_compressor(std::unique_ptr<byte_sink> sink, compression format,
+                                           const compression_options& options = compression_options());
+
+// Opens a file for writing, compressed with format. Returns null when the
+// file can't be created or format can't be compressed to.
+std::unique_ptr<byte_sink> open_file_sink(const char* filename, compression format = compression::none,
+                                          const compression_options& options = compression_options());
+
+// Opens a file for reading, decompressing it on the fly when its first
+// bytes say it is compressed. Returns null when the file can't be opened
+// or its format isn't supported.
+std::unique_ptr<byte_source> open_file_source(const char* filename);
+
+} // namespace csv
+
+#endif // CSV_COMPRESSION_H
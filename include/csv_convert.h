@@ -0,0 +1,284 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_CONVERT_H
+#define CSV_CONVERT_H
+
+#include "csv_field_view.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <istream>
+#include <limits>
+#include <locale>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+namespace csv
+{
+
+namespace detail
+{
+    // Read-only stream buffer over an external range of bytes, used to run
+    // stream extraction on a single field without copying it first.
+    class span_streambuf : public std::streambuf
+    {
+    public:
+        void set(const char* begin, const char* end)
+        {
+            char* first = const_cast<char*>(begin);
+            setg(first, first, const_cast<char*>(end));
+        }
+    };
+
+    // Per thread stream used by the generic conversion, so rows don't have
+    // to carry one around.
+    class field_stream
+    {
+    public:
+        field_stream()
+            : m_stream(&m_buf)
+        {
+            m_stream.imbue(std::locale{ "en_US.UTF8" });
+        }
+
+        std::istream& reset(const field_view& field)
+        {
+            m_buf.set(field.begin(), field.end());
+            m_stream.clear();
+            return m_stream;
+        }
+
+        static field_stream& get()
+        {
+            static thread_local field_stream stream;
+            return stream;
+        }
+
+    private:
+        span_streambuf m_buf;
+        std::istream m_stream;
+    };
+
+    inline const char* skip_spaces(const char* first, const char* last)
+    {
+        while ((first != last) && ((*first == ' ') || (*first == '\t')))
+        {
+            ++first;
+        }
+
+        return first;
+    }
+
+    // Parses the unsigned decimal number at the start of [first, last).
+    // Fails if there are no digits or the value doesn't fit in max_value.
+    inline bool parse_digits(const char*& first, const char* last,
+                             unsigned long long max_value, unsigned long long& value)
+    {
+        const char* begin = first;
+        unsigned long long result = 0;
+        for (; first != last; ++first)
+        {
+            const unsigned digit = static_cast<unsigned>(*first) - '0';
+            if (digit > 9)
+            {
+                break;
+            }
+
+            if (result > (max_value - digit) / 10)
+            {
+                return false;
+            }
+
+            result = result * 10 + digit;
+        }
+
+        value = result;
+        return first != begin;
+    }
+
+    template <typename T>
+    bool parse_integer(const field_view& field, T& value, std::true_type /* is_signed */)
+    {
+        const char* first = skip_spaces(field.begin(), field.end());
+        const char* last = field.end();
+
+        const bool negative = (first != last) && (*first == '-');
+        if ((first != last) && ((*first == '-') || (*first == '+')))
+        {
+            ++first;
+        }
+
+        typedef typename std::make_unsigned<T>::type unsigned_type;
+        const unsigned long long max_value = negative
+            ? static_cast<unsigned long long>(std::numeric_limits<T>::max()) + 1
+            : static_cast<unsigned long long>(std::numeric_limits<T>::max());
+
+        unsigned long long result = 0;
+        if (!parse_digits(first, last, max_value, result))
+        {
+            return false;
+        }
+
+        // negate in the unsigned domain, so that the minimum value doesn't overflow
+        const unsigned_type bits = static_cast<unsigned_type>(result);
+        value = negative
+            ? static_cast<T>(unsigned_type(0) - bits)
+            : static_cast<T>(bits);
+        return true;
+    }
+
+    template <typename T>
+    bool parse_integer(const field_view& field, T& value, std::false_type /* is_signed */)
+    {
+        const char* first = skip_spaces(field.begin(), field.end());
+        const char* last = field.end();
+
+        if ((first != last) && (*first == '+'))
+        {
+            ++first;
+        }
+
+        unsigned long long result = 0;
+        if (!parse_digits(first, last, std::numeric_limits<T>::max(), result))
+        {
+            return false;
+        }
+
+        value = static_cast<T>(result);
+        return true;
+    }
+
+    // Parses the decimal number at the start of [first, last) with an
+    // optional sign, or inf or nan, the same whatever the locale of the
+    // program is. Most values are exact in a couple of multiplications,
+    // the others are rounded by the C library in the "C" locale.
+    bool parse_floating(const char* first, const char* last, float& value);
+    bool parse_floating(const char* first, const char* last, double& value);
+    bool parse_floating(const char* first, const char* last, long double& value);
+} // namespace detail
+
+// Converts the bytes of a field to a value of type T. Specialize it to
+// teach the library about new types; the primary template falls back to
+// stream extraction.
+template <typename T, typename Enable = void>
+struct convert
+{
+    static bool parse(const field_view& field, T& value)
+    {
+        return static_cast<bool>(detail::field_stream::get().reset(field) >> value);
+    }
+};
+
+template <typename T>
+struct convert<T, typename std::enable_if<std::is_integral<T>::value &&
+                                          !std::is_same<T, bool>::value &&
+                                          !std::is_same<T, char>::value>::type>
+{
+    static bool parse(const field_view& field, T& value)
+    {
+        return detail::parse_integer(field, value, std::is_signed<T>());
+    }
+};
+
+template <typename T>
+struct convert<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static bool parse(const field_view& field, T& value)
+    {
+        const char* first = detail::skip_spaces(field.begin(), field.end());
+        return detail::parse_floating(first, field.end(), value);
+    }
+};
+
+template <>
+struct convert<bool>
+{
+    static bool parse(const field_view& field, bool& value)
+    {
+        const char* first = detail::skip_spaces(field.begin(), field.end());
+        const field_view text(first, static_cast<size_t>(field.end() - first));
+
+        if ((text == field_view("1", 1)) || (text == field_view("true", 4)))
+        {
+            value = true;
+            return true;
+        }
+
+        if ((text == field_view("0", 1)) || (text == field_view("false", 5)))
+        {
+            value = false;
+            return true;
+        }
+
+        return false;
+    }
+};
+
+template <>
+struct convert<char>
+{
+    static bool parse(const field_view& field, char& value)
+    {
+        const char* first = detail::skip_spaces(field.begin(), field.end());
+        if (first == field.end())
+        {
+            return false;
+        }
+
+        value = *first;
+        return true;
+    }
+};
+
+template <>
+struct convert<std::string>
+{
+    static bool parse(const field_view& field, std::string& value)
+    {
+        if (!field.quoted())
+        {
+            value.assign(field.data(), field.size());
+            return true;
+        }
+
+        value.clear();
+        detail::append_field(value, field);
+        return true;
+    }
+};
+
+template <>
+struct convert<field_view>
+{
+    static bool parse(const field_view& field, field_view& value)
+    {
+        value = field;
+        return true;
+    }
+};
+
+} // namespace csv
+
+#endif // CSV_CONVERT_H
@@ -0,0 +1,184 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_DICTIONARY_H
+#define CSV_DICTIONARY_H
+
+#include "csv_convert.h"
+#include "csv_field_view.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+// Distinct values of one or more text columns, each given a code: 0 for
+// the first value interned, 1 for the next new one and so on. Values are
+// stored once, unescaped, and their views stay valid until the dictionary
+// is cleared or destroyed, however many values are added after them.
+// Several readers can share a dictionary (but not from several threads at
+// once), so that equal values of different files get equal codes.
+class dictionary
+{
+public:
+    static const uint32_t npos = uint32_t(-1);
+
+    dictionary();
+    dictionary(const dictionary&) = delete;
+    dictionary(dictionary&&) = default;
+    dictionary& operator=(const dictionary&) = delete;
+    dictionary& operator=(dictionary&&) = default;
+    ~dictionary() = default;
+
+    // The code of the value of field, adding it when it is new. Quoted
+    // fields are unescaped first, so "a""b" and a"b are the same value.
+    uint32_t intern(const field_view& field);
+
+    // npos when the value isn't in the dictionary
+    uint32_t find(const field_view& field) const;
+
+    size_t size() const
+    {
+        return m_values.size();
+    }
+
+    bool empty() const
+    {
+        return m_values.empty();
+    }
+
+    // The value of a code returned by intern(), never quoted.
+    const field_view& get_value(uint32_t code) const
+    {
+        return m_values[code];
+    }
+
+    void clear();
+
+private:
+    // the value of field, unescaped in the scratch buffer if needed
+    field_view unescape(const field_view& field, std::string& scratch) const;
+    uint32_t find(const field_view& value, uint64_t hash, size_t& slot) const;
+    const char* store(const field_view& value);
+    void grow();
+
+    std::vector<field_view> m_values;
+    std::vector<uint64_t> m_hashes;
+    // code + 1 per slot, 0 for empty ones; the size is a power of two at
+    // least twice the number of values
+    std::vector<uint32_t> m_slots;
+
+    // values are copied into blocks that are never moved
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_block_pos;
+    size_t m_block_left;
+
+    std::string m_scratch;
+};
+
+// A field read through a dictionary, instead of a std::string: converting
+// a field to it interns the value, which costs a lookup but no allocation
+// once the value is known, and keeps its code and a view of the
+// dictionary's copy, e.g.
+//
+//     csv::dictionary countries;
+//     csv::interned country(countries);
+//     while (reader.read_row(id, country))
+//         ++counts[country.get_code()];
+//
+// Without a dictionary the conversion fails and the value is left alone,
+// which is what read_batch() gets as it makes its values itself.
+class interned
+{
+public:
+    interned()
+        : m_dictionary(nullptr),
+          m_code(dictionary::npos)
+    {
+    }
+
+    explicit interned(dictionary& values)
+        : m_dictionary(&values),
+          m_code(dictionary::npos)
+    {
+    }
+
+    dictionary* get_dictionary() const
+    {
+        return m_dictionary;
+    }
+
+    // dictionary::npos until a field is converted
+    uint32_t get_code() const
+    {
+        return m_code;
+    }
+
+    field_view get_value() const
+    {
+        return (m_code == dictionary::npos) ? field_view() : m_dictionary->get_value(m_code);
+    }
+
+    bool assign(const field_view& field)
+    {
+        if (m_dictionary == nullptr)
+        {
+            return false;
+        }
+
+        m_code = m_dictionary->intern(field);
+        return true;
+    }
+
+private:
+    dictionary* m_dictionary;
+    uint32_t m_code;
+};
+
+// Values of the same dictionary are equal when their codes are.
+inline bool operator==(const interned& lhs, const interned& rhs)
+{
+    return (lhs.get_dictionary() == rhs.get_dictionary()) && (lhs.get_code() == rhs.get_code());
+}
+
+inline bool operator!=(const interned& lhs, const interned& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <>
+struct convert<interned>
+{
+    static bool parse(const field_view& field, interned& value)
+    {
+        return value.assign(field);
+    }
+};
+
+} // namespace csv
+
+#endif // CSV_DICTIONARY_H
@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_FIELD_VIEW_H
+#define CSV_FIELD_VIEW_H
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace csv
+{
+
+// Non-owning view over the bytes of a single field. The bytes belong to
+// whoever produced the view (a row's line buffer or a file mapping) and
+// the view is only valid for as long as they are.
+//
+// For a quoted field the view covers the bytes between the quotes, where
+// quotes are still escaped as "". They are only unescaped when the field
+// is copied out with str() or converted to a std::string.
+class field_view
+{
+public:
+    field_view()
+        : m_data(nullptr),
+          m_size(0),
+          m_quoted(false)
+    {
+    }
+
+    field_view(const char* data, size_t size, bool quoted = false)
+        : m_data(data),
+          m_size(size),
+          m_quoted(quoted)
+    {
+    }
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    const char* begin() const
+    {
+        return m_data;
+    }
+
+    const char* end() const
+    {
+        return m_data + m_size;
+    }
+
+    char operator[](size_t index) const
+    {
+        return m_data[index];
+    }
+
+    // Whether the field was enclosed in quotes in the file.
+    bool quoted() const
+    {
+        return m_quoted;
+    }
+
+    std::string str() const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+    bool m_quoted;
+};
+
+namespace detail
+{
+    // Makes the view of the field stored as [begin, end) in the file,
+    // without the quotes around it. Fields that only start with a quote
+    // are malformed and kept as they are.
+    inline field_view make_field(const char* begin, const char* end)
+    {
+        const size_t size = static_cast<size_t>(end - begin);
+        if ((size >= 2) && (begin[0] == '"') && (end[-1] == '"'))
+        {
+            return field_view(begin + 1, size - 2, true);
+        }
+
+        return field_view(begin, size);
+    }
+
+    // Appends the value of field to out, turning "" back into ".
+    inline void append_field(std::string& out, const field_view& field)
+    {
+        const char* pos = field.begin();
+        const char* end = field.end();
+        if (field.quoted())
+        {
+            while (pos < end)
+            {
+                const char* quote = static_cast<const char*>(std::memchr(pos, '"', end - pos));
+                if (quote == nullptr)
+                {
+                    break;
+                }
+
+                // keep the first quote of the pair
+                out.append(pos, static_cast<size_t>(quote + 1 - pos));
+                pos = ((quote + 1 < end) && (quote[1] == '"')) ? quote + 2 : quote + 1;
+            }
+        }
+
+        out.append(pos, static_cast<size_t>(end - pos));
+    }
+} // namespace detail
+
+inline std::string field_view::str() const
+{
+    std::string value;
+    detail::append_field(value, *this);
+    return value;
+}
+
+// Compares the bytes of the fields, as they are in the file.
+
+inline bool operator==(const field_view& lhs, const field_view& rhs)
+{
+    return (lhs.size() == rhs.size()) &&
+           ((lhs.size() == 0) || (std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0));
+}
+
+inline bool operator!=(const field_view& lhs, const field_view& rhs)
+{
+    return !(lhs == rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& os, const field_view& field)
+{
+    if (field.quoted())
+    {
+        return os << field.str();
+    }
+
+    return os.write(field.data(), static_cast<std::streamsize>(field.size()));
+}
+
+} // namespace csv
+
+#endif // CSV_FIELD_VIEW_H
@@ -0,0 +1,364 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_FORMAT_H
+#define CSV_FORMAT_H
+
+#include "csv_field_view.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+namespace csv
+{
+
+namespace detail
+{
+    // Stream buffer appending everything to a std::string.
+    class string_streambuf : public std::streambuf
+    {
+    public:
+        void set(std::string& buffer)
+        {
+            m_buffer = &buffer;
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                m_buffer->push_back(traits_type::to_char_type(ch));
+            }
+
+            return traits_type::not_eof(ch);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) override
+        {
+            m_buffer->append(s, static_cast<size_t>(n));
+            return n;
+        }
+
+    private:
+        std::string* m_buffer = nullptr;
+    };
+
+    // Per thread stream used by the generic formatting.
+    class format_stream
+    {
+    public:
+        format_stream()
+            : m_stream(&m_buf)
+        {
+            m_stream.imbue(std::locale{ "en_US.UTF8" });
+        }
+
+        std::ostream& reset(std::string& buffer)
+        {
+            m_buf.set(buffer);
+            m_stream.clear();
+            return m_stream;
+        }
+
+        static format_stream& get()
+        {
+            static thread_local format_stream stream;
+            return stream;
+        }
+
+    private:
+        string_streambuf m_buf;
+        std::ostream m_stream;
+    };
+
+    template <typename T>
+    void format_integer(std::string& out, T value)
+    {
+        static const char digit_pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        typedef typename std::make_unsigned<T>::type unsigned_type;
+        const bool negative = (value < T(0));
+        unsigned_type bits = negative
+            ? unsigned_type(unsigned_type(0) - static_cast<unsigned_type>(value))
+            : static_cast<unsigned_type>(value);
+
+        char buffer[std::numeric_limits<unsigned_type>::digits10 + 2];
+        char* last = buffer + sizeof(buffer);
+        char* first = last;
+        while (bits >= 100)
+        {
+            const unsigned pair = static_cast<unsigned>(bits % 100) * 2;
+            bits /= 100;
+            *--first = digit_pairs[pair + 1];
+            *--first = digit_pairs[pair];
+        }
+
+        if (bits >= 10)
+        {
+            const unsigned pair = static_cast<unsigned>(bits) * 2;
+            *--first = digit_pairs[pair + 1];
+            *--first = digit_pairs[pair];
+        }
+        else
+        {
+            *--first = static_cast<char>('0' + bits);
+        }
+
+        if (negative)
+        {
+            *--first = '-';
+        }
+
+        out.append(first, last);
+    }
+
+    // Writes the fewest digits that read back to value, laid out as %g
+    // would at std::numeric_limits<T>::digits10 (more when there are more
+    // digits). They come from Grisu2, which sometimes gives one digit more
+    // than the shortest. value has to be finite; at most 32 bytes are
+    // written and the end of them is returned.
+    char* format_shortest(char* out, double value);
+    char* format_shortest(char* out, float value);
+
+    inline bool append_shortest(std::string& out, double value)
+    {
+        if (!std::isfinite(value))
+        {
+            return false;
+        }
+
+        char buffer[32];
+        out.append(buffer, format_shortest(buffer, value));
+        return true;
+    }
+
+    inline bool append_shortest(std::string& out, float value)
+    {
+        if (!std::isfinite(value))
+        {
+            return false;
+        }
+
+        char buffer[32];
+        out.append(buffer, format_shortest(buffer, value));
+        return true;
+    }
+
+    // no shortest digits for long double, they are searched with printf
+    inline bool append_shortest(std::string&, long double)
+    {
+        return false;
+    }
+
+    // The printf side of format_floating(): fixed decimals, and %g digits
+    // searched for the values format_shortest() can't write. The C library
+    // prints them with the calling thread in the "C" locale, so the decimal
+    // point is a '.' whatever the program's locale is.
+    void format_fixed(std::string& out, double value, int precision);
+    void format_fixed(std::string& out, long double value, int precision);
+    void format_general(std::string& out, float value);
+    void format_general(std::string& out, double value);
+    void format_general(std::string& out, long double value);
+
+    // Appends value with the given number of decimals, or with the fewest
+    // digits that read back to the same value when precision is negative.
+    template <typename T>
+    void format_floating(std::string& out, T value, int precision)
+    {
+        typedef typename std::conditional<std::is_same<T, float>::value, double, T>::type print_type;
+
+        if (precision >= 0)
+        {
+            format_fixed(out, static_cast<print_type>(value), precision);
+        }
+        else if (!append_shortest(out, value))
+        {
+            format_general(out, value);
+        }
+    }
+
+    // Appends text as a field, quoted as RFC 4180 has it when it contains
+    // the delimiter, a quote or a line break, or when quoted is set.
+    inline void format_text(std::string& out, const char* data, size_t size, char delimiter, bool quoted = false)
+    {
+        const char* end = data + size;
+        if (!quoted)
+        {
+            quoted = std::find_if(data, end, [delimiter](char c)
+            {
+                return (c == delimiter) || (c == '"') || (c == '\r') || (c == '\n');
+            }) != end;
+        }
+
+        if (!quoted)
+        {
+            out.append(data, size);
+            return;
+        }
+
+        out.push_back('"');
+        for (const char* pos = data; pos != end; ++pos)
+        {
+            if (*pos == '"')
+            {
+                out.push_back('"');
+            }
+            out.push_back(*pos);
+        }
+        out.push_back('"');
+    }
+} // namespace detail
+
+// Appends the text of a value of type T to a writer's buffer. Specialize
+// it to teach the library about new types; the primary template falls back
+// to stream insertion.
+template <typename T, typename Enable = void>
+struct format
+{
+    static void write(std::string& out, const T& value)
+    {
+        detail::format_stream::get().reset(out) << value;
+    }
+};
+
+template <typename T>
+struct format<T, typename std::enable_if<std::is_integral<T>::value &&
+                                         !std::is_same<T, bool>::value &&
+                                         !std::is_same<T, char>::value>::type>
+{
+    static void write(std::string& out, T value)
+    {
+        detail::format_integer(out, value);
+    }
+};
+
+template <typename T>
+struct format<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static void write(std::string& out, T value)
+    {
+        detail::format_floating(out, value, -1);
+    }
+
+    static void write_fixed(std::string& out, T value, int precision)
+    {
+        detail::format_floating(out, value, precision);
+    }
+};
+
+template <>
+struct format<bool>
+{
+    static void write(std::string& out, bool value)
+    {
+        out.push_back(value ? '1' : '0');
+    }
+};
+
+// Text is quoted when it would otherwise be split differently by a reader
+// using the same delimiter, see detail::format_text(). The writer passes
+// its delimiter; without one, ',' is assumed.
+template <>
+struct format<char>
+{
+    static void write(std::string& out, char value, char delimiter = ',')
+    {
+        detail::format_text(out, &value, 1, delimiter);
+    }
+};
+
+template <>
+struct format<std::string>
+{
+    static void write(std::string& out, const std::string& value, char delimiter = ',')
+    {
+        detail::format_text(out, value.data(), value.size(), delimiter);
+    }
+};
+
+template <>
+struct format<const char*>
+{
+    static void write(std::string& out, const char* value, char delimiter = ',')
+    {
+        detail::format_text(out, value, std::strlen(value), delimiter);
+    }
+};
+
+template <>
+struct format<char*>
+{
+    static void write(std::string& out, const char* value, char delimiter = ',')
+    {
+        detail::format_text(out, value, std::strlen(value), delimiter);
+    }
+};
+
+// A field read from a file is written back the way it was: quoted fields
+// are still escaped, so their bytes go between quotes as they are.
+template <>
+struct format<field_view>
+{
+    static void write(std::string& out, const field_view& value, char delimiter = ',')
+    {
+        if (value.quoted())
+        {
+            out.push_back('"');
+            out.append(value.data(), value.size());
+            out.push_back('"');
+            return;
+        }
+
+        detail::format_text(out, value.data(), value.size(), delimiter);
+    }
+};
+
+namespace detail
+{
+    // the types whose format takes the delimiter
+    template <typename T>
+    struct is_text : std::false_type
+    {
+    };
+
+    template <> struct is_text<char> : std::true_type {};
+    template <> struct is_text<std::string> : std::true_type {};
+    template <> struct is_text<const char*> : std::true_type {};
+    template <> struct is_text<char*> : std::true_type {};
+    template <> struct is_text<field_view> : std::true_type {};
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_FORMAT_H
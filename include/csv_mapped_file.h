@@ -0,0 +1,92 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_MAPPED_FILE_H
+#define CSV_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace csv
+{
+
+namespace detail
+{
+
+// Read-only memory mapping of a whole file, or a view over a buffer that
+// is already in memory.
+class mapped_file
+{
+public:
+    mapped_file();
+    mapped_file(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other);
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file& operator=(mapped_file&& other);
+    ~mapped_file();
+
+    bool open(const char* filename);
+    // Views a buffer that belongs to the caller instead of a file. It has
+    // to outlive the mapping, which leaves it alone when closed.
+    void open(const char* data, size_t size);
+    void close();
+
+    bool is_open() const
+    {
+        return m_is_open;
+    }
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    void swap(mapped_file& other);
+
+    const char* m_data;
+    size_t m_size;
+    bool m_is_open;
+    bool m_borrowed;
+
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#endif
+};
+
+// Size and last modification time (in nanoseconds, as precise as the file
+// system keeps it) of a file, used to tell whether files derived from it
+// are still up to date.
+bool get_file_info(const char* filename, uint64_t& size, int64_t& mtime);
+
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_MAPPED_FILE_H
@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_PARALLEL_READER_H
+#define CSV_PARALLEL_READER_H
+
+#include "csv_mapped_file.h"
+#include "csv_reader.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+// Reads a single file on several threads. The file is memory mapped and
+// split into chunks of roughly equal size, each one starting at the first
+// record boundary after its nominal offset (newlines inside quoted fields
+// are not boundaries). Chunks are tokenized in parallel into rows that
+// point into the mapping.
+class parallel_reader
+{
+public:
+    // In which order chunks are handed to the caller.
+    enum class order
+    {
+        // file order, on the calling thread, while the next chunks are parsed
+        in_order,
+        // as soon as they are ready, concurrently on the worker threads
+        unordered
+    };
+
+    class chunk
+    {
+    public:
+        chunk() = default;
+        chunk(const chunk&) = delete;
+        chunk(chunk&&) = default;
+        chunk& operator=(const chunk&) = delete;
+        chunk& operator=(chunk&&) = default;
+        ~chunk() = default;
+
+        // position of the chunk in the file
+        size_t get_index() const
+        {
+            return m_index;
+        }
+
+        size_t size() const
+        {
+            return m_rows.size();
+        }
+
+        const reader::row& operator[](size_t index) const
+        {
+            return m_rows[index];
+        }
+
+        std::vector<reader::row>::const_iterator begin() const
+        {
+            return m_rows.begin();
+        }
+
+        std::vector<reader::row>::const_iterator end() const
+        {
+            return m_rows.end();
+        }
+
+    private:
+        size_t m_index = 0;
+        std::vector<reader::row> m_rows;
+
+        friend class parallel_reader;
+    };
+
+    parallel_reader();
+    parallel_reader(const parallel_reader&) = delete;
+    parallel_reader(parallel_reader&&) = default;
+    parallel_reader& operator=(const parallel_reader&) = delete;
+    parallel_reader& operator=(parallel_reader&&) = default;
+    ~parallel_reader() = default;
+
+    bool open(const char* filename, char delimiter = ',');
+    bool open(const std::string& filename, char delimiter = ',')
+    {
+        return open(filename.c_str(), delimiter);
+    }
+    // Reads a buffer in memory in place. It has to outlive the reader.
+    bool open_buffer(const char* data, size_t size, char delimiter = ',');
+
+    bool is_open() const
+    {
+        return m_mapping.is_open();
+    }
+
+    char get_delimiter() const
+    {
+        return m_delimiter;
+    }
+
+    const std::vector<std::string>& get_column_names() const
+    {
+        return m_column_names;
+    }
+
+    // size_t(-1) when there is no such column
+    size_t get_column_index(const std::string& name) const
+    {
+        return m_column_index.find(m_column_names, name.data(), name.size());
+    }
+
+    size_t get_column_index(const char* name) const;
+
+    column_handle get_column(const std::string& name) const
+    {
+        return column_handle(get_column_index(name));
+    }
+
+    column_handle get_column(const char* name) const
+    {
+        return column_handle(get_column_index(name));
+    }
+
+    // 0 uses one thread per hardware thread
+    void set_num_threads(size_t num_threads)
+    {
+        m_num_threads = num_threads;
+    }
+
+    void set_chunk_size(size_t chunk_size)
+    {
+        m_chunk_size = (chunk_size > 0) ? chunk_size : 1;
+    }
+
+    // Calls fn(const chunk&) for every non empty chunk of the file. If fn
+    // throws, no more chunks are handed out and the exception is rethrown
+    // here once every thread has stopped.
+    template <typename Fn>
+    bool read_chunks(Fn fn, order chunk_order = order::in_order)
+    {
+        return run(std::function<void(const chunk&)>(fn), chunk_order);
+    }
+
+    // Calls fn(const reader::row&) for every row of the file. With
+    // order::unordered fn is called concurrently and must be thread safe.
+    template <typename Fn>
+    bool read_rows(Fn fn, order chunk_order = order::in_order)
+    {
+        return read_chunks([&fn](const chunk& rows)
+        {
+            for (const reader::row& row : rows)
+            {
+                fn(row);
+            }
+        }, chunk_order);
+    }
+
+private:
+    bool run(const std::function<void(const chunk&)>& fn, order chunk_order);
+    std::vector<const char*> find_chunk_starts(size_t num_threads) const;
+    bool read_header();
+    void parse_chunk(const char* begin, const char* end, chunk& rows) const;
+    size_t get_num_threads() const;
+
+    detail::mapped_file m_mapping;
+    char m_delimiter;
+    size_t m_data_offset;
+
+    size_t m_num_threads;
+    size_t m_chunk_size;
+
+    std::vector<std::string> m_column_names;
+    detail::column_name_index m_column_index;
+};
+
+} // namespace csv
+
+#endif // CSV_PARALLEL_READER_H
@@ -0,0 +1,148 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CSV_PIPELINE_H
+#define CSV_PIPELINE_H
+
+#include "csv_reader.h"
+#include "csv_row_table.h"
+
+#include <functional>
+#include <vector>
+
+namespace csv
+{
+
+// Reads the rows of a reader on the calling thread and hands them to
+// worker threads in batches, for when what is done with the rows costs
+// more than tokenizing them. Batches are row_tables: the bytes of a batch
+// are copied once into its table, which is reused once its worker is done.
+// They go through a bounded queue without locks, and the reader waits
+// when the workers fall behind.
+class pipeline
+{
+public:
+    class batch
+    {
+    public:
+        batch() = default;
+        batch(const batch&) = delete;
+        batch& operator=(const batch&) = delete;
+
+        // position of the batch in the file
+        size_t get_index() const
+        {
+            return m_index;
+        }
+
+        // row number of the batch's first row, counted from the first one
+        // after the header
+        size_t get_first_row() const
+        {
+            return m_first_row;
+        }
+
+        size_t size() const
+        {
+            return m_rows.size();
+        }
+
+        row_table::row_view operator[](size_t index) const
+        {
+            return m_rows[index];
+        }
+
+        const row_table& get_rows() const
+        {
+            return m_rows;
+        }
+
+    private:
+        size_t m_index = 0;
+        size_t m_first_row = 0;
+        row_table m_rows;
+
+        friend class pipeline;
+    };
+
+    pipeline();
+    pipeline(const pipeline&) = delete;
+    pipeline& operator=(const pipeline&) = delete;
+
+    // 0 uses one worker per hardware thread
+    void set_num_workers(size_t num_workers)
+    {
+        m_num_workers = num_workers;
+    }
+
+    // Rows per batch, 4096 by default.
+    void set_batch_size(size_t batch_size)
+    {
+        m_batch_size = (batch_size > 0) ? batch_size : 1;
+    }
+
+    // Batches waiting for a worker before the reader has to wait, 0 (the
+    // default) for two per worker.
+    void set_queue_size(size_t queue_size)
+    {
+        m_queue_size = queue_size;
+    }
+
+    // Calls fn(const batch&) for every batch of the remaining rows of
+    // file, concurrently on the workers and in no particular order, so fn
+    // must be thread safe. Returns once every batch has been processed.
+    // If fn throws, no more batches are read and the exception is rethrown
+    // here once every worker has stopped.
+    template <typename Fn>
+    bool process_batches(reader& file, Fn fn)
+    {
+        return run(file, std::function<void(const batch&)>(fn));
+    }
+
+    // Calls fn(const row_table::row_view&) for every remaining row of
+    // file, the same way.
+    template <typename Fn>
+    bool process_rows(reader& file, Fn fn)
+    {
+        return process_batches(file, [&fn](const batch& rows)
+        {
+            for (size_t i = 0; i < rows.size(); ++i)
+            {
+                fn(rows[i]);
+            }
+        });
+    }
+
+private:
+    bool run(reader& file, const std::function<void(const batch&)>& fn);
+    size_t get_num_workers() const;
+
+    size_t m_num_workers;
+    size_t m_batch_size;
+    size_t m_queue_size;
+};
+
+} // namespace csv
+
+#endif // CSV_PIPELINE_H
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_PREDICATE_H
+#define CSV_PREDICATE_H
+
+#include "csv_field_view.h"
+
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+// A condition on the fields of a row, tested on the bytes of the fields
+// before anything is converted; see reader::set_filter(). Conditions on
+// named columns are combined with && and ||, which like the built in
+// operators only test the right hand side when the left one doesn't
+// decide:
+//
+//     reader.set_filter(csv::predicate::equals("country", "RO") &&
+//                       csv::predicate::between("price", 10.0, 100.0));
+//
+// Text is compared byte by byte with the field's value, without the
+// quotes around it. A row without the column doesn't match. A default
+// constructed predicate matches every row.
+class predicate
+{
+public:
+    predicate() = default;
+
+    static predicate equals(std::string column, std::string value);
+    static predicate starts_with(std::string column, std::string prefix);
+    // low <= value <= high, for fields that convert to a double
+    static predicate between(std::string column, double low, double high);
+    // low <= value <= high, comparing the text as std::string does
+    static predicate between(std::string column, std::string low, std::string high);
+
+    friend predicate operator&&(predicate lhs, predicate rhs);
+    friend predicate operator||(predicate lhs, predicate rhs);
+
+    bool empty() const
+    {
+        return m_nodes.empty();
+    }
+
+private:
+    enum class op
+    {
+        equals,
+        starts_with,
+        number_range,
+        text_range,
+        all_of,
+        any_of
+    };
+
+    struct node
+    {
+        op kind;
+        std::string column_name;
+        // bound by reader::set_filter()
+        size_t column = size_t(-1);
+        // the value, prefix or low end of a range
+        std::string low;
+        std::string high;
+        double low_number = 0;
+        double high_number = 0;
+        // operands of all_of and any_of
+        size_t lhs = 0;
+        size_t rhs = 0;
+
+        // scratch holds the field's value if it has escaped quotes
+        bool test(const field_view& field, std::string& scratch) const;
+    };
+
+    static predicate leaf(node value);
+    static predicate combine(op kind, predicate lhs, predicate rhs);
+
+    // the operands of a node come before it, the root is the last one
+    std::vector<node> m_nodes;
+
+    friend class reader;
+};
+
+} // namespace csv
+
+#endif // CSV_PREDICATE_H
@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_PREFETCH_READER_H
+#define CSV_PREFETCH_READER_H
+
+#include "csv_byte_source.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace csv
+{
+
+namespace detail
+{
+
+// Reads a byte source in large blocks on a background thread, one block
+// ahead of the consumer: while a block is being parsed the next one is
+// already being read (and decompressed, if the source does that) into the
+// second buffer.
+class prefetch_reader
+{
+public:
+    prefetch_reader();
+    prefetch_reader(const prefetch_reader&) = delete;
+    prefetch_reader(prefetch_reader&&) = delete;
+    prefetch_reader& operator=(const prefetch_reader&) = delete;
+    prefetch_reader& operator=(prefetch_reader&&) = delete;
+    ~prefetch_reader();
+
+    bool open(std::unique_ptr<byte_source> source, size_t block_size);
+    void close();
+
+    bool is_open() const
+    {
+        return m_is_open;
+    }
+
+    // Gives the current block back and waits for the next one. Returns
+    // false once the whole source has been read. An exception thrown by
+    // the source on the prefetch thread is rethrown here, once.
+    bool next_block(const char*& data, size_t& size);
+
+    // Whether the source stopped on an error, see byte_source::failed().
+    // Known once next_block() returned false.
+    bool failed() const;
+
+private:
+    static const size_t num_buffers = 2;
+
+    void run();
+
+    std::unique_ptr<byte_source> m_source;
+    bool m_is_open;
+
+    std::vector<char> m_buffers[num_buffers];
+    size_t m_sizes[num_buffers];
+    bool m_filled[num_buffers];
+
+    size_t m_current;
+    bool m_holding;
+    bool m_stop;
+    bool m_failed;
+    // thrown by the source, along with the empty block ending it
+    std::exception_ptr m_error;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+};
+
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_PREFETCH_READER_H
@@ -24,20 +24,58 @@
 #ifndef CSV_READER_H
 #define CSV_READER_H
 
+#include "csv_byte_source.h"
+#include "csv_column_index.h"
+#include "csv_convert.h"
+#include "csv_field_view.h"
+#include "csv_mapped_file.h"
+#include "csv_predicate.h"
+#include "csv_prefetch_reader.h"
+#include "csv_scanner.h"
+#include "csv_schema.h"
+#include "csv_stats.h"
+
 #include <algorithm>
+#include <chrono>
 #include <numeric>
 #include <fstream>
+#include <memory>
 #include <vector>
 #include <cassert>
-#include <sstream>
+#include <string>
 
 namespace csv
 {
 
-namespace detail
+class row_index;
+template <typename... Types>
+class typed_reader;
+
+// How the reader gets the bytes of the file.
+enum class read_mode
 {
-    std::vector<std::streamoff> get_offsets(const std::string& line, char delimiter);
-} // namespace detail
+    // lines are read through a std::ifstream into the row's own buffer
+    stream,
+    // the whole file is memory mapped and rows point directly into the mapping
+    mapped,
+    // the file is read in large blocks by a background thread, one block
+    // ahead of the parser
+    async,
+    // the file is read as it grows, e.g. a log being appended to: only
+    // records ended by a newline are read, and at the end of the file the
+    // reader waits for more (see reader::set_follow_timeout) instead of
+    // stopping. Files that are truncated or replaced aren't noticed.
+    follow
+};
+
+// Compressed files (gzip, zstd or lz4, told from their first bytes) are
+// always read as in read_mode::async, decompressing on the background
+// thread.
+//
+// Rows can be tokenized only partly, by reader::read_row (up to the last
+// selected column) or in lazy mode (see reader::set_lazy). The rest of
+// their fields are then tokenized the first time they are accessed, so
+// such rows mustn't be accessed from several threads at once.
 
 class reader
 {
@@ -46,38 +84,98 @@ public:
     {
     public:
         row();
-        row(const row&) = default;
-        row(row&&) = default;
-        row& operator=(const row&) = default;
-        row& operator=(row&&) = default;
+        row(const row& other);
+        row(row&& other) noexcept;
+        row& operator=(const row& other);
+        row& operator=(row&& other) noexcept;
         ~row() = default;
 
         void parse_line(std::string line, char delimiter = ',');
+        // Reads the next record, which can span several lines when quoted
+        // fields contain newlines.
         bool parse_line(std::ifstream& filestream, char delimiter = ',');
+        // Parses the bytes in [begin, end) without copying them. The row
+        // refers to them until the next parse, so they must outlive it.
+        void parse_line(const char* begin, const char* end, char delimiter = ',');
 
         template <typename... Args>
         bool read(Args&... args) const;
 
         template <typename... Args>
         bool read_columns(const std::vector<bool>& cols, Args&... args) const;
+        template <typename... Args>
+        bool read_columns(const column_set& cols, Args&... args) const;
 
         template <typename Arg>
         Arg get(size_t index) const;
         template <typename Arg>
         bool get(size_t index, Arg& arg) const;
 
+        template <typename Arg>
+        Arg get(column_handle column) const
+        {
+            return get<Arg>(column.get_index());
+        }
+
+        template <typename Arg>
+        bool get(column_handle column, Arg& arg) const
+        {
+            return get(column.get_index(), arg);
+        }
+
+        // The field without the quotes around it, if any, see field_view.
+        field_view get_field(size_t index) const;
+        // The bytes of the field as they are in the file.
+        field_view get_raw_field(size_t index) const;
+
+        field_view get_field(column_handle column) const
+        {
+            return get_field(column.get_index());
+        }
+
+        field_view get_raw_field(column_handle column) const
+        {
+            return get_raw_field(column.get_index());
+        }
+
         size_t size() const
         {
+            tokenize(size_t(-1));
             return m_column_offsets.size();
         }
 
         const std::string& get_line()
         {
+            if (m_data != m_line.data())
+            {
+                m_line.assign(m_data, m_size);
+                m_data = m_line.data();
+            }
+            else
+            {
+                m_line.resize(m_size);
+            }
+
             return m_line;
         }
 
     private:
-        void parse_line_impl(char delimiter);
+        // only the first max_fields fields are tokenized, see reader::read_row;
+        // both return false when the line ended inside a quoted field
+        bool parse_line_impl(char delimiter, size_t max_fields);
+        bool parse_owned_line(char delimiter, size_t max_fields);
+        bool read_record(std::ifstream& filestream, char delimiter, size_t max_fields);
+        bool read_line(std::ifstream& filestream, std::string& line);
+        const char* parse_record(const char* begin, const char* end, char delimiter, size_t max_fields);
+        void finish_parse();
+        // makes sure the first num_fields fields (or all there are) are
+        // tokenized
+        void tokenize(size_t num_fields) const;
+        void assign(const row& other);
+        void assign(row&& other) noexcept;
+
+        template <typename Arg>
+        bool extract(size_t index, Arg& arg) const;
 
         template <typename Arg>
         bool read_impl(const std::vector<bool>& cols, size_t idx, Arg& arg) const;
@@ -86,13 +184,43 @@ public:
         template <typename Arg>
         bool read_next_col(const std::vector<bool>& cols, size_t& idx, Arg& arg) const;
 
+        template <typename Arg>
+        bool read_set_impl(const column_set& cols, size_t idx, Arg& arg) const;
+        template <typename Arg, typename... Args>
+        bool read_set_impl(const column_set& cols, size_t idx, Arg& arg, Args&... args) const;
+
+        // the fields at indexes[0], indexes[1], ..., which have to exist
+        template <typename Arg>
+        bool read_indexed(const size_t* indexes, Arg& arg) const;
+        template <typename Arg, typename... Args>
+        bool read_indexed(const size_t* indexes, Arg& arg, Args&... args) const;
+
+        template <typename Arg>
+        bool read_all_impl(size_t idx, Arg& arg) const;
+        template <typename Arg, typename... Args>
+        bool read_all_impl(size_t idx, Arg& arg, Args&... args) const;
+
         std::string m_line;
-        mutable std::istringstream m_line_stream;
+        // bytes of the current line, either m_line's or borrowed ones
+        const char* m_data;
+        size_t m_size;
+
+        char m_delimiter;
+
+        mutable std::vector<std::streamoff> m_column_offsets;
+        // end of the last tokenized field, m_size unless fields were skipped
+        mutable std::streamoff m_fields_end;
 
-        std::vector<std::streamoff> m_column_offsets;
-        std::vector<bool> m_default_selected_cols;
+#if defined(CSV_HAVE_STATS)
+        // counters of the reader reading into the row, kept here so that
+        // conversions through the const row count too
+        mutable reader_stats m_stats;
+#endif
 
         friend class reader;
+        friend class parallel_reader;
+        template <typename... Types>
+        friend class typed_reader;
     };
 
     reader();
@@ -102,15 +230,36 @@ public:
     reader& operator=(reader&&) = default;
     ~reader() = default;
 
-    bool open(const char* filename, char delimiter = ',');
-    bool open(const std::string& filename, char delimiter = ',')
+    bool open(const char* filename, char delimiter = ',', read_mode mode = read_mode::stream);
+    bool open(const std::string& filename, char delimiter = ',', read_mode mode = read_mode::stream)
     {
-        return open(filename.c_str(), delimiter);
+        return open(filename.c_str(), delimiter, mode);
     }
-
-    bool is_open() const
+    // Opens with the delimiter of a schema, see sniff(). Without a header
+    // the first row is data and the columns are named after the schema.
+    bool open(const char* filename, const schema& layout, read_mode mode = read_mode::stream);
+    bool open(const std::string& filename, const schema& layout, read_mode mode = read_mode::stream)
+    {
+        return open(filename.c_str(), layout, mode);
+    }
+    // Reads from any source, as in read_mode::async. Exceptions thrown by
+    // the source are rethrown by the call reading the block that failed.
+    bool open(std::unique_ptr<byte_source> source, char delimiter = ',');
+    // Reads a buffer in memory in place, as in read_mode::mapped, so it
+    // has to outlive the reader. Compressed buffers are decompressed as in
+    // read_mode::async instead.
+    bool open_buffer(const char* data, size_t size, char delimiter = ',');
+
+    bool is_open() const;
+
+    // Whether reading stopped on an error rather than at the end of the
+    // file, e.g. in a compressed file that is corrupt or cut short;
+    // next_row() and read_row() return false in both cases.
+    bool failed() const;
+
+    read_mode get_mode() const
     {
-        return m_filestream.is_open();
+        return m_mode;
     }
 
     char get_delimiter() const
@@ -123,9 +272,28 @@ public:
         return m_column_names;
     }
 
+    // size_t(-1) when there is no such column
     size_t get_column_index(const std::string& name) const
     {
-        return get_column_index(name.c_str());
+        return m_column_index.find(m_column_names, name.data(), name.size());
+    }
+
+    size_t get_column_index(const char* name) const;
+
+    // Looks up a column once, for accessing the field by name in every
+    // row at the cost of accessing it by index:
+    //
+    //     const auto price = reader.get_column("price");
+    //     while (reader.next_row())
+    //         total += reader.get_row().get<double>(price);
+    column_handle get_column(const std::string& name) const
+    {
+        return column_handle(get_column_index(name));
+    }
+
+    column_handle get_column(const char* name) const
+    {
+        return column_handle(get_column_index(name));
     }
 
     const row& get_row() const
@@ -133,18 +301,98 @@ public:
         return m_row;
     }
 
-    size_t get_column_index(const char* name) const;
+    // In lazy mode next_row() only finds where the row ends and tokenizes
+    // its first field; the others are tokenized when first accessed. Scans
+    // that look at a leading column and reject most rows skip most of the
+    // tokenizing, rows that are read whole cost a little more. Off by
+    // default.
+    void set_lazy(bool lazy)
+    {
+        m_lazy = lazy;
+    }
+
+    bool is_lazy() const
+    {
+        return m_lazy;
+    }
+
+    // Counters since open(), see reader_stats. All 0 unless the library
+    // is built with LIBCSV_WITH_STATS.
+    reader_stats get_stats() const;
+
+    // Calls callback with the stats every every_rows rows, on the thread
+    // reading them; 0 rows or an empty callback stops the calls. Only with
+    // LIBCSV_WITH_STATS.
+    void set_stats_callback(size_t every_rows, reader_stats_callback callback);
+
+    // Size of the blocks read ahead in read_mode::async, applied by the
+    // next open(). Default is 1 MB.
+    void set_block_size(size_t block_size)
+    {
+        m_block_size = block_size;
+    }
+
+    // How long next_row(), read_row() and read_batch() wait in
+    // read_mode::follow for a record to be completed at the end of the
+    // file, looking for more bytes every poll_interval. With 0, the
+    // default, they return false right away; calling them again later
+    // picks up from the last record read, without reading it again.
+    void set_follow_timeout(std::chrono::milliseconds timeout,
+                            std::chrono::milliseconds poll_interval = std::chrono::milliseconds(50))
+    {
+        m_follow_timeout = timeout;
+        m_poll_interval = poll_interval;
+    }
 
     bool next_row();
 
+    // Moves to row (counted from the first one after the header) of a file
+    // opened in read_mode::stream, mapped or follow, so that the next
+    // row read is that one. The index has to be built for the same file
+    // and delimiter; at most index.get_stride() - 1 rows are skipped to
+    // reach row.
+    bool seek(const row_index& index, size_t row);
+
     template <typename... Args>
     bool read_row(Args&... args);
 
+    // Reads up to num_rows rows and stores the selected columns in one
+    // vector per column, in column order. The vectors are resized to the
+    // number of rows read, which is returned (0 at the end of the file or
+    // when the number of vectors doesn't match the selected columns).
+    template <typename... Args>
+    size_t read_batch(size_t num_rows, std::vector<Args>&... columns);
+
     template <typename... Args>
     bool select_cols(const Args&... args);
     bool select_cols(const std::vector<std::string>& selected_cols);
     bool select_cols(const std::vector<size_t>& selected_cols);
-    bool select_cols(std::vector<bool> selected_cols);
+    bool select_cols(const std::vector<bool>& selected_cols);
+    bool select_cols(const column_set& selected_cols);
+
+    const column_set& get_selected_cols() const
+    {
+        return m_selected_cols;
+    }
+
+    // Indexes of the selected columns, in increasing order.
+    const std::vector<size_t>& get_selected_indexes() const
+    {
+        return m_selected_indexes;
+    }
+
+    // From now on next_row(), read_row() and read_batch() only return the
+    // rows matching filter. Only the fields it tests are tokenized until a
+    // row matches and nothing is converted, so with columns selected the
+    // rows filtered out cost little more than finding where they end.
+    // Returns false, keeping the filter there was, if it names a column
+    // the file doesn't have. open() clears it.
+    bool set_filter(predicate filter);
+
+    void clear_filter()
+    {
+        set_filter(predicate());
+    }
 
 private:
     template <typename Arg>
@@ -154,28 +402,110 @@ private:
     template <typename Arg>
     bool select_next_col(const Arg& arg);
 
+    template <typename Arg>
+    void convert_batch(size_t col, size_t num_rows, std::vector<Arg>& column) const;
+    template <typename Arg, typename... Args>
+    void convert_batch(size_t col, size_t num_rows, std::vector<Arg>& column, std::vector<Args>&... columns) const;
+
+    size_t fill_batch(size_t num_rows);
+    const char* get_batch_base() const;
+
+    void update_selection();
+
     bool read_header();
-    bool parse_next_line();
+    // parse_next_line() for the rows handed out, which the stats count
+    bool parse_row(size_t max_fields);
+    // parse_row() until a row matches the filter
+    bool parse_matching_row(size_t max_fields);
+    // next_row() tokenizing the first max_fields fields only, as read_row()
+    // does for the selected columns
+    bool next_row(size_t max_fields);
+    bool matches(size_t node) const;
+    bool parse_next_line(size_t max_fields = size_t(-1));
+    bool parse_mapped_line(size_t max_fields);
+    bool parse_prefetched_line(size_t max_fields);
+    bool parse_followed_line(size_t max_fields);
+    // appends what was written to the file since the last call
+    bool read_appended();
+    void reset_follow();
+    bool skip_rows(size_t num_rows);
+    bool next_block();
+    bool at_end() const;
+
+#if defined(CSV_HAVE_STATS)
+    void count_row();
+#endif
 
     std::ifstream m_filestream;
+    detail::mapped_file m_mapping;
+    size_t m_mapping_pos;
+
+    std::unique_ptr<detail::prefetch_reader> m_prefetch;
+    const char* m_block_pos;
+    const char* m_block_end;
+    bool m_blocks_done;
+    size_t m_block_size;
+
+    // read_mode::follow reads through m_filestream too, into a buffer
+    // whose records from m_follow_pos on haven't been read yet. A partial
+    // record is scanned up to m_follow_scan, where it is in m_follow_state,
+    // so that appends only scan what was appended.
+    std::string m_follow_buffer;
+    size_t m_follow_pos;
+    size_t m_follow_scan;
+    detail::field_state m_follow_state;
+    std::chrono::milliseconds m_follow_timeout;
+    std::chrono::milliseconds m_poll_interval;
+
+    read_mode m_mode;
     char m_delimiter;
+    bool m_lazy;
 
-    size_t m_selected_cols_num;
-    std::vector<bool> m_selected_cols;
+    // fields a row needs for the selected columns, the rest aren't tokenized
+    size_t m_selected_fields_end;
+    column_set m_selected_cols;
+    // the set columns of m_selected_cols, which read_row walks
+    std::vector<size_t> m_selected_indexes;
     std::vector<std::string> m_column_names;
+    detail::column_name_index m_column_index;
+    // names of the columns of a file without a header, for the next open()
+    std::vector<std::string> m_headerless_names;
+
+    predicate m_filter;
+    // fields a row needs for the filter to be tested
+    size_t m_filter_fields_end;
+    mutable std::string m_filter_scratch;
 
     row m_row;
+
+    size_t m_stats_every;
+    reader_stats_callback m_stats_callback;
+
+    // raw fields of the last batch, row after row, as (offset, size) pairs
+    // relative to get_batch_base()
+    std::vector<std::pair<size_t, size_t>> m_batch_fields;
+    std::string m_batch_bytes;
+
+    template <typename... Types>
+    friend class typed_reader;
 };
 
 template <typename... Args>
 bool reader::row::read(Args&... args) const
 {
-    return read_cols(m_default_selected_cols, args...);
+    tokenize(sizeof...(args));
+    if (sizeof...(args) > m_column_offsets.size())
+    {
+        return false;
+    }
+
+    return read_all_impl(0, args...);
 }
 
 template <typename... Args>
 bool reader::row::read_columns(const std::vector<bool>& cols, Args&... args) const
 {
+    tokenize(size_t(-1));
     if (sizeof...(args) > m_column_offsets.size())
     {
         return false;
@@ -190,6 +520,18 @@ bool reader::row::read_columns(const std::vector<bool>& cols, Args&... args) con
     return read_impl(cols, idx, args...);
 }
 
+template <typename... Args>
+bool reader::row::read_columns(const column_set& cols, Args&... args) const
+{
+    tokenize(size_t(-1));
+    if (cols.size() != m_column_offsets.size())
+    {
+        return false;
+    }
+
+    return read_set_impl(cols, cols.find_next(0), args...);
+}
+
 template <typename Arg>
 bool reader::row::read_impl(const std::vector<bool>& cols, size_t idx, Arg& arg) const
 {
@@ -207,6 +549,49 @@ bool reader::row::read_impl(const std::vector<bool>& cols, size_t idx, Arg& arg,
     return false;
 }
 
+template <typename Arg>
+bool reader::row::read_set_impl(const column_set& cols, size_t idx, Arg& arg) const
+{
+    return (idx < cols.size()) && extract(idx, arg);
+}
+
+template <typename Arg, typename... Args>
+bool reader::row::read_set_impl(const column_set& cols, size_t idx, Arg& arg, Args&... args) const
+{
+    if (read_set_impl(cols, idx, arg))
+    {
+        return read_set_impl(cols, cols.find_next(idx + 1), args...);
+    }
+
+    return false;
+}
+
+template <typename Arg>
+bool reader::row::read_indexed(const size_t* indexes, Arg& arg) const
+{
+    return extract(*indexes, arg);
+}
+
+template <typename Arg, typename... Args>
+bool reader::row::read_indexed(const size_t* indexes, Arg& arg, Args&... args) const
+{
+    extract(*indexes, arg);
+    return read_indexed(indexes + 1, args...);
+}
+
+template <typename Arg>
+bool reader::row::read_all_impl(size_t idx, Arg& arg) const
+{
+    return extract(idx, arg);
+}
+
+template <typename Arg, typename... Args>
+bool reader::row::read_all_impl(size_t idx, Arg& arg, Args&... args) const
+{
+    extract(idx, arg);
+    return read_all_impl(idx + 1, args...);
+}
+
 template <typename Arg>
 bool reader::row::read_next_col(const std::vector<bool>& cols, size_t& idx, Arg& arg) const
 {
@@ -220,8 +605,20 @@ bool reader::row::read_next_col(const std::vector<bool>& cols, size_t& idx, Arg&
         return false;
     }
 
-    m_line_stream.seekg(m_column_offsets[idx++]);
-    m_line_stream >> arg;
+    return extract(idx++, arg);
+}
+
+template <typename Arg>
+bool reader::row::extract(size_t index, Arg& arg) const
+{
+    // like the stream extraction it replaces, a field that fails to
+    // convert leaves arg as it is without failing the whole row; it only
+    // shows in the stats
+    if (!convert<Arg>::parse(get_field(index), arg))
+    {
+        CSV_STATS(++m_stats.conversion_failures);
+    }
+
     return true;
 }
 
@@ -238,12 +635,10 @@ Arg reader::row::get(size_t index) const
 template <typename Arg>
 bool reader::row::get(size_t index, Arg& arg) const
 {
+    tokenize(index + 1);
     if (index < m_column_offsets.size())
     {
-        m_line_stream.seekg(m_column_offsets[index]);
-        m_line_stream >> arg;
-        m_line_stream.clear();
-        return true;
+        return extract(index, arg);
     }
 
     return false;
@@ -252,22 +647,79 @@ bool reader::row::get(size_t index, Arg& arg) const
 template <typename... Args>
 bool reader::read_row(Args&... args)
 {
-    if (sizeof...(args) != m_selected_cols_num)
+    if (sizeof...(args) != m_selected_indexes.size())
+    {
+        return false;
+    }
+
+    if (!is_open() || at_end())
     {
         return false;
     }
 
-    if (!is_open() || m_filestream.eof())
+    if (!parse_matching_row(m_selected_fields_end))
     {
         return false;
     }
 
-    if (!parse_next_line())
+    // fields past the selected ones are only tokenized on demand
+    if (m_row.m_column_offsets.size() < m_selected_fields_end)
     {
         return false;
     }
 
-    return m_row.read_columns(m_selected_cols, args...);
+    CSV_STATS(detail::stats_timer convert_timer(m_row.m_stats.convert_time));
+    return m_row.read_indexed(m_selected_indexes.data(), args...);
+}
+
+template <typename... Args>
+size_t reader::read_batch(size_t num_rows, std::vector<Args>&... columns)
+{
+    if (sizeof...(columns) != m_selected_indexes.size())
+    {
+        return 0;
+    }
+
+    if (!is_open())
+    {
+        return 0;
+    }
+
+    const size_t rows_read = fill_batch(num_rows);
+    convert_batch(0, rows_read, columns...);
+    return rows_read;
+}
+
+template <typename Arg>
+void reader::convert_batch(size_t col, size_t num_rows, std::vector<Arg>& column) const
+{
+    CSV_STATS(detail::stats_timer convert_timer(m_row.m_stats.convert_time));
+
+    const char* base = get_batch_base();
+    const size_t stride = m_selected_indexes.size();
+
+    column.resize(num_rows);
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        const std::pair<size_t, size_t>& field = m_batch_fields[i * stride + col];
+
+        // parse into a local so that std::vector<bool> works too
+        Arg value = Arg();
+        const char* raw = base + field.first;
+        if (!convert<Arg>::parse(detail::make_field(raw, raw + field.second), value))
+        {
+            CSV_STATS(++m_row.m_stats.conversion_failures);
+        }
+
+        column[i] = std::move(value);
+    }
+}
+
+template <typename Arg, typename... Args>
+void reader::convert_batch(size_t col, size_t num_rows, std::vector<Arg>& column, std::vector<Args>&... columns) const
+{
+    convert_batch(col, num_rows, column);
+    convert_batch(col + 1, num_rows, columns...);
 }
 
 template <typename... Args>
@@ -278,10 +730,10 @@ bool reader::select_cols(const Args&... args)
         return false;
     }
 
-    std::fill(m_selected_cols.begin(), m_selected_cols.end(), false);
+    m_selected_cols.reset_all();
     const bool cols_selected = select_cols_impl(args...);
 
-    m_selected_cols_num = std::accumulate(m_selected_cols.begin(), m_selected_cols.end(), size_t(0));
+    update_selection();
 
     return cols_selected;
 }
@@ -306,13 +758,13 @@ bool reader::select_cols_impl(const Arg& arg, const Args&... args)
 template <typename Arg>
 bool reader::select_next_col(const Arg& arg)
 {
-    const auto it = std::find(m_column_names.begin(), m_column_names.end(), arg);
-    if (it == m_column_names.end())
+    const size_t index = get_column_index(arg);
+    if (index >= m_selected_cols.size())
     {
         return false;
     }
 
-    m_selected_cols[std::distance(m_column_names.begin(), it)] = true;
+    m_selected_cols.set(index);
     return true;
 }
 
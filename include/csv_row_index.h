@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_ROW_INDEX_H
+#define CSV_ROW_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+// Byte offsets of every Nth record of a CSV file, so that a reader can
+// seek to any row (see reader::seek) or work can be split by row ranges
+// without reading everything before. Rows are counted from the first one
+// after the header, quoted fields spanning several lines are one row.
+//
+// Indexes can be saved next to the file they describe and are only
+// loaded back while the file keeps the same size and modification time.
+class row_index
+{
+public:
+    row_index();
+
+    // Scans the file for record boundaries, every stride-th record
+    // start is kept. The delimiter tells where quoted fields can start.
+    bool build(const char* filename, size_t stride = 1024, char delimiter = ',');
+
+    bool save(const char* path) const;
+    // Fails when the index doesn't match its file anymore.
+    bool load(const char* path);
+
+    // Loads the index saved in the sidecar of filename, or builds and
+    // saves it when there is none or it is out of date.
+    bool load_or_build(const char* filename, size_t stride = 1024, char delimiter = ',');
+
+    static std::string get_sidecar_path(const char* filename)
+    {
+        return std::string(filename) + ".csvidx";
+    }
+
+    bool empty() const
+    {
+        return m_offsets.empty();
+    }
+
+    size_t get_stride() const
+    {
+        return m_stride;
+    }
+
+    char get_delimiter() const
+    {
+        return m_delimiter;
+    }
+
+    // Number of rows of the file, without the header.
+    size_t get_num_rows() const
+    {
+        return m_num_rows;
+    }
+
+    // Offset of the start of row (row / stride) * stride; the remaining
+    // row % stride rows have to be skipped from there.
+    uint64_t get_offset(size_t row) const
+    {
+        return m_offsets[row / m_stride];
+    }
+
+    const std::string& get_filename() const
+    {
+        return m_filename;
+    }
+
+private:
+    void clear();
+
+    std::string m_filename;
+    uint64_t m_file_size;
+    int64_t m_file_mtime;
+
+    size_t m_stride;
+    char m_delimiter;
+    size_t m_num_rows;
+    std::vector<uint64_t> m_offsets;
+};
+
+} // namespace csv
+
+#endif // CSV_ROW_INDEX_H
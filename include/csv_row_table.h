@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_ROW_TABLE_H
+#define CSV_ROW_TABLE_H
+
+#include "csv_convert.h"
+#include "csv_field_view.h"
+#include "csv_reader.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace csv
+{
+
+// Compact storage for many parsed rows. The bytes of all rows live in one
+// arena and their fields are described by one flat array of 32 bit
+// offsets, so a stored row costs its bytes plus 4 bytes per field and 16
+// bytes of bookkeeping. Clearing or destroying the table frees everything
+// at once.
+class row_table
+{
+public:
+    // Read-only access to one row of the table, with the same accessors as
+    // reader::row. Valid until the table is modified.
+    class row_view
+    {
+    public:
+        row_view(const row_table& table, size_t index)
+            : m_table(&table),
+              m_index(index)
+        {
+        }
+
+        size_t size() const
+        {
+            return m_table->get_num_fields(m_index);
+        }
+
+        field_view get_field(size_t index) const
+        {
+            const field_view raw = get_raw_field(index);
+            return detail::make_field(raw.begin(), raw.end());
+        }
+
+        field_view get_raw_field(size_t index) const
+        {
+            return m_table->get_raw_field(m_index, index);
+        }
+
+        field_view get_field(column_handle column) const
+        {
+            return get_field(column.get_index());
+        }
+
+        template <typename Arg>
+        Arg get(size_t index) const;
+        template <typename Arg>
+        bool get(size_t index, Arg& arg) const;
+
+        template <typename Arg>
+        Arg get(column_handle column) const
+        {
+            return get<Arg>(column.get_index());
+        }
+
+        template <typename Arg>
+        bool get(column_handle column, Arg& arg) const
+        {
+            return get(column.get_index(), arg);
+        }
+
+        template <typename... Args>
+        bool read(Args&... args) const;
+
+    private:
+        template <typename Arg>
+        void read_impl(size_t index, Arg& arg) const;
+        template <typename Arg, typename... Args>
+        void read_impl(size_t index, Arg& arg, Args&... args) const;
+
+        const row_table* m_table;
+        size_t m_index;
+    };
+
+    row_table();
+    row_table(const row_table&) = default;
+    row_table(row_table&&) = default;
+    row_table& operator=(const row_table&) = default;
+    row_table& operator=(row_table&&) = default;
+    ~row_table() = default;
+
+    void reserve(size_t num_rows, size_t num_fields, size_t num_bytes);
+
+    // Copies the fields of a row into the table. Rows longer than 4 GB
+    // are not supported.
+    void push_back(const reader::row& row);
+    void push_back(const row_view& row);
+
+    size_t size() const
+    {
+        return m_row_bytes.size() - 1;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    row_view operator[](size_t index) const
+    {
+        assert(index < size());
+        return row_view(*this, index);
+    }
+
+    void clear();
+
+    // Bytes used by the table, without unused capacity.
+    size_t memory_usage() const;
+
+private:
+    template <typename Row>
+    void push_back_impl(const Row& row);
+
+    size_t get_num_fields(size_t row) const
+    {
+        // every row also stores the end of its last field
+        return m_row_fields[row + 1] - m_row_fields[row] - 1;
+    }
+
+    field_view get_raw_field(size_t row, size_t index) const
+    {
+        assert(index < get_num_fields(row));
+
+        const uint32_t* offsets = m_field_offsets.data() + m_row_fields[row];
+        const char* bytes = m_bytes.data() + m_row_bytes[row];
+        return field_view(bytes + offsets[index], offsets[index + 1] - 1 - offsets[index]);
+    }
+
+    std::vector<char> m_bytes;
+    // start of every field relative to the start of its row, followed by
+    // the end of the row's last field plus one
+    std::vector<uint32_t> m_field_offsets;
+    // where each row starts in m_bytes and m_field_offsets, with a sentinel
+    std::vector<size_t> m_row_bytes;
+    std::vector<size_t> m_row_fields;
+};
+
+template <typename Arg>
+Arg row_table::row_view::get(size_t index) const
+{
+    Arg val;
+    const bool ret = get(index, val);
+    assert(ret);
+
+    return val;
+}
+
+template <typename Arg>
+bool row_table::row_view::get(size_t index, Arg& arg) const
+{
+    if (index < size())
+    {
+        convert<Arg>::parse(get_field(index), arg);
+        return true;
+    }
+
+    return false;
+}
+
+template <typename... Args>
+bool row_table::row_view::read(Args&... args) const
+{
+    if (sizeof...(args) > size())
+    {
+        return false;
+    }
+
+    read_impl(0, args...);
+    return true;
+}
+
+template <typename Arg>
+void row_table::row_view::read_impl(size_t index, Arg& arg) const
+{
+    convert<Arg>::parse(get_field(index), arg);
+}
+
+template <typename Arg, typename... Args>
+void row_table::row_view::read_impl(size_t index, Arg& arg, Args&... args) const
+{
+    convert<Arg>::parse(get_field(index), arg);
+    read_impl(index + 1, args...);
+}
+
+template <typename Row>
+void row_table::push_back_impl(const Row& row)
+{
+    const size_t num_fields = row.size();
+    if (num_fields > 0)
+    {
+        // the fields of a row are contiguous, copy them in one go
+        const char* first = row.get_raw_field(0).begin();
+        const char* last = row.get_raw_field(num_fields - 1).end();
+        m_bytes.insert(m_bytes.end(), first, last);
+
+        for (size_t i = 0; i < num_fields; ++i)
+        {
+            m_field_offsets.push_back(static_cast<uint32_t>(row.get_raw_field(i).begin() - first));
+        }
+        m_field_offsets.push_back(static_cast<uint32_t>(last - first + 1));
+    }
+    else
+    {
+        m_field_offsets.push_back(1);
+    }
+
+    m_row_bytes.push_back(m_bytes.size());
+    m_row_fields.push_back(m_field_offsets.size());
+}
+
+} // namespace csv
+
+#endif // CSV_ROW_TABLE_H
@@ -0,0 +1,221 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_SCANNER_H
+#define CSV_SCANNER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace csv
+{
+
+namespace detail
+{
+    // Instruction sets the structural scanner can run on. The best one the
+    // CPU supports is picked the first time the scanner is used.
+    enum class simd_level
+    {
+        scalar,
+        sse2,
+        avx2,
+        neon
+    };
+
+    // Number of bytes classified by a single scanner step.
+    const size_t scan_block_size = 64;
+
+    // Bit i of each mask is set when byte i of the block is that character.
+    struct block_masks
+    {
+        uint64_t delimiters;
+        uint64_t newlines;
+        uint64_t quotes;
+    };
+
+    typedef void (*scan_block_fn)(const char* block, char delimiter, block_masks& masks);
+
+    simd_level get_simd_level();
+    // Forces a given implementation, mostly for benchmarks. Returns false
+    // when the CPU (or the build) doesn't support it.
+    bool set_simd_level(simd_level level);
+    const char* get_simd_level_name(simd_level level);
+
+    scan_block_fn get_scan_block();
+
+    // Classifies the bytes in [begin, end), which may be shorter than a block.
+    inline void scan_block(scan_block_fn scan, const char* begin, const char* end,
+                           char delimiter, block_masks& masks)
+    {
+        const size_t length = static_cast<size_t>(end - begin);
+        if (length >= scan_block_size)
+        {
+            scan(begin, delimiter, masks);
+            return;
+        }
+
+        char block[scan_block_size] = {};
+        std::copy(begin, end, block);
+        scan(block, delimiter, masks);
+
+        const uint64_t valid = (uint64_t(1) << length) - 1;
+        masks.delimiters &= valid;
+        masks.newlines &= valid;
+        masks.quotes &= valid;
+    }
+
+    inline unsigned trailing_zeros(uint64_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+    }
+
+    inline unsigned leading_zeros(uint64_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, mask);
+        return 63 - static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_clzll(mask));
+#endif
+    }
+
+    inline unsigned popcount(uint64_t mask)
+    {
+#if defined(_MSC_VER)
+        return static_cast<unsigned>(__popcnt64(mask));
+#else
+        return static_cast<unsigned>(__builtin_popcountll(mask));
+#endif
+    }
+
+    // Bit i of the result is the parity of the bits [0, i] of mask. For a
+    // mask of the quotes that open and close quoted fields, that sets the
+    // bits of the bytes inside quotes, counting the opening quotes but not
+    // the closing ones.
+    inline uint64_t prefix_xor(uint64_t mask)
+    {
+        mask ^= mask << 1;
+        mask ^= mask << 2;
+        mask ^= mask << 4;
+        mask ^= mask << 8;
+        mask ^= mask << 16;
+        mask ^= mask << 32;
+        return mask;
+    }
+
+    struct scan_result
+    {
+        // the '\n' ending the record, or the end of the input
+        const char* record_end;
+        // end of the last field written to the offsets
+        const char* fields_end;
+        // the input ended inside a quoted field, so the record goes on
+        // past it
+        bool in_quotes;
+    };
+
+    // Scans one record starting at begin, stopping at the first '\n' that
+    // isn't inside a quoted field or at end. Delimiters inside quoted
+    // fields don't split them.
+    // The offset of the start of each of the first max_fields fields (relative
+    // to begin) is written to offsets and the rest of the record is skipped.
+    // It is still scanned for its end when find_record_end is set; when it
+    // isn't, record_end is end and in_quotes false for records with more
+    // fields than max_fields.
+    scan_result scan_fields(const char* begin, const char* end, char delimiter,
+                            size_t max_fields, bool find_record_end,
+                            std::vector<std::streamoff>& offsets);
+
+    // Same as scan_fields for all the fields of the record, returns the end of the record.
+    inline const char* scan_line(const char* begin, const char* end, char delimiter,
+                                 std::vector<std::streamoff>& offsets)
+    {
+        return scan_fields(begin, end, delimiter, size_t(-1), true, offsets).record_end;
+    }
+
+    // Where a byte is in its field, as far as quotes go. As in RFC 4180 a
+    // quote only opens a quoted field as the field's first byte; anywhere
+    // else in an unquoted field (5"10) it is part of the field.
+    enum class field_state : unsigned char
+    {
+        field_start,
+        unquoted,
+        quoted,
+        // after a quote in a quoted field, which ends it unless another
+        // quote follows
+        quote_closed
+    };
+
+    const size_t num_field_states = 4;
+
+    // The state at the end of a range for each state at its start.
+    struct field_state_map
+    {
+        field_state states[num_field_states];
+    };
+
+    // Finds the '\n' that ends the record, skipping the ones inside quoted
+    // fields. state is the state at begin; it is updated to field_start past
+    // the returned newline, or to the state at end when there is no such
+    // newline, in which case end is returned.
+    const char* find_record_end(const char* begin, const char* end, char delimiter, field_state& state);
+
+    // Same, for a begin that starts a record (in_quotes false) or goes on
+    // with a quoted field after a newline (in_quotes true).
+    inline const char* find_record_end(const char* begin, const char* end, char delimiter, bool& in_quotes)
+    {
+        field_state state = in_quotes ? field_state::quoted : field_state::field_start;
+        const char* record_end = find_record_end(begin, end, delimiter, state);
+        in_quotes = (state == field_state::quoted);
+        return record_end;
+    }
+
+    // Tells the state at end for each state at begin, so that ranges of a
+    // file can be scanned independently and chained afterwards.
+    field_state_map map_field_states(const char* begin, const char* end, char delimiter);
+
+    // Skips num_records records from begin, which has to be the start of
+    // one, and returns the start of the next record (or end). skipped is
+    // set to the number of records actually skipped, which is smaller at
+    // the end of the input; an unterminated last record counts.
+    const char* skip_records(const char* begin, const char* end, char delimiter,
+                             size_t num_records, size_t& skipped);
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_SCANNER_H
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CSV_SCHEMA_H
+#define CSV_SCHEMA_H
+
+#include "csv_field_view.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace csv
+{
+
+class row_index;
+
+// What the fields of a column convert to without loss, from the most to
+// the least specific; text always works.
+enum class column_type
+{
+    // true or false, as convert<bool> reads them
+    boolean,
+    // fits in a long long
+    integer,
+    // decimal or scientific notation, read as double
+    real,
+    // ISO 8601 dates (2024-01-31), optionally with a time
+    date,
+    text
+};
+
+const char* get_type_name(column_type type);
+
+// The most specific type of the value of a field, ignoring spaces around
+// it. False for fields with nothing but spaces, which fit every type.
+bool classify(const field_view& field, column_type& type);
+
+// Layout of a CSV file as guessed by sniff(), which reader::open() can use
+// instead of a delimiter.
+struct schema
+{
+    char delimiter = ',';
+    // When there is none, column_names are made up as c0, c1...
+    bool has_header = true;
+    std::vector<std::string> column_names;
+    std::vector<column_type> column_types;
+    // rows the guess is based upon, without the header
+    size_t num_rows_sampled = 0;
+};
+
+struct sniff_options
+{
+    // bytes of the file to look at
+    size_t sample_size = size_t(64) << 10;
+    // the delimiter is one of these, ',' when none of them splits the rows
+    std::string delimiters = ",;\t|";
+    // With a row index the sample is taken in this many blocks, evenly
+    // spaced over the file, instead of from its start only.
+    size_t num_blocks = 8;
+};
+
+// Guesses the delimiter, whether the first row is a header and the type of
+// every column from a sample of the file; compressed files are sampled
+// from their start. The delimiter is the candidate splitting the sampled
+// rows into the same number of fields most consistently. A column's type
+// is the most specific one all its non empty fields have, and the first
+// row is a header unless its fields have the types of their columns.
+// Fails when the file can't be read or is empty.
+bool sniff(const char* filename, schema& result, const sniff_options& options = sniff_options());
+bool sniff(const char* filename, const row_index& index, schema& result,
+           const sniff_options& options = sniff_options());
+bool sniff_buffer(const char* data, size_t size, schema& result, const sniff_options& options = sniff_options());
+
+} // namespace csv
+
+#endif // CSV_SCHEMA_H
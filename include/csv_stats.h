@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_STATS_H
+#define CSV_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Readers and writers only count what they do when the library is built
+// with LIBCSV_WITH_STATS, which defines CSV_HAVE_STATS for the library and
+// everything using it. Otherwise the counters stay at 0 and the code that
+// updates them isn't compiled at all. Compiled in, the times cost a few
+// clock reads per row.
+#if defined(CSV_HAVE_STATS)
+#define CSV_STATS(...) __VA_ARGS__
+#else
+#define CSV_STATS(...)
+#endif
+
+namespace csv
+{
+
+// What a reader did since it was opened, see reader::get_stats(). Times
+// are in nanoseconds.
+struct reader_stats
+{
+    // bytes of text gone through, after decompression, header included
+    uint64_t bytes_read = 0;
+    // rows read, without the header and the rows skipped by seek()
+    uint64_t rows = 0;
+    // fields tokenized, which in lazy mode or with columns selected can be
+    // fewer than the rows have
+    uint64_t fields = 0;
+    // fields that didn't convert to the type asked for, the values are
+    // left as they were
+    uint64_t conversion_failures = 0;
+    // waiting for lines in read_mode::stream and for blocks in
+    // read_mode::async; mapped files are paged in while tokenizing
+    uint64_t io_time = 0;
+    uint64_t tokenize_time = 0;
+    // converting fields in read_row() and read_batch(), the conversions of
+    // row::get() are counted as failures only
+    uint64_t convert_time = 0;
+    // longest row, in bytes
+    size_t max_row_size = 0;
+};
+
+// What a writer or a shard did since it was opened, see
+// writer::get_stats(). Times are in nanoseconds.
+struct writer_stats
+{
+    // bytes handed to the output, or to the flusher thread with shards
+    uint64_t bytes_written = 0;
+    // rows written, without the header
+    uint64_t rows = 0;
+    uint64_t fields = 0;
+    // formatting the values of write_row()
+    uint64_t format_time = 0;
+    // writing to the output, which with shards the flusher thread does
+    uint64_t io_time = 0;
+    // longest row, in bytes
+    size_t max_row_size = 0;
+};
+
+// Called with the stats every so many rows, see reader::set_stats_callback().
+using reader_stats_callback = std::function<void(const reader_stats&)>;
+using writer_stats_callback = std::function<void(const writer_stats&)>;
+
+namespace detail
+{
+    // Adds the time it lives to a counter.
+    class stats_timer
+    {
+    public:
+        explicit stats_timer(uint64_t& counter)
+            : m_counter(counter),
+              m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        stats_timer(const stats_timer&) = delete;
+        stats_timer& operator=(const stats_timer&) = delete;
+
+        ~stats_timer()
+        {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+            m_counter += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        uint64_t& m_counter;
+        std::chrono::steady_clock::time_point m_start;
+    };
+} // namespace detail
+
+} // namespace csv
+
+#endif // CSV_STATS_H
@@ -0,0 +1,286 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_TYPED_H
+#define CSV_TYPED_H
+
+#include "csv_convert.h"
+#include "csv_reader.h"
+#include "csv_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace csv
+{
+
+namespace detail
+{
+    template <size_t... Is>
+    struct index_sequence
+    {
+    };
+
+    template <size_t N, size_t... Is>
+    struct make_index_sequence : make_index_sequence<N - 1, N - 1, Is...>
+    {
+    };
+
+    template <size_t... Is>
+    struct make_index_sequence<0, Is...> : index_sequence<Is...>
+    {
+    };
+} // namespace detail
+
+// Reader with a fixed schema: one column per type, bound by name (or by
+// position) once in open(). Reading a row converts every bound field with
+// the converter of its type, with no per field checks.
+template <typename... Types>
+class typed_reader
+{
+public:
+    typedef std::tuple<Types...> row_type;
+    static const size_t num_columns = sizeof...(Types);
+
+    typed_reader() = default;
+    typed_reader(const typed_reader&) = delete;
+    typed_reader(typed_reader&&) = default;
+    typed_reader& operator=(const typed_reader&) = delete;
+    typed_reader& operator=(typed_reader&&) = default;
+    ~typed_reader() = default;
+
+    // Binds the types to the first columns of the file, in order.
+    bool open(const std::string& filename, char delimiter = ',', read_mode mode = read_mode::stream);
+    // Binds the types to the named columns, in the given order. Like the
+    // other open(), leaves the reader closed if the columns can't be bound.
+    bool open(const std::string& filename, const std::vector<std::string>& column_names,
+              char delimiter = ',', read_mode mode = read_mode::stream);
+
+    bool is_open() const
+    {
+        return m_reader.is_open();
+    }
+
+    const std::vector<std::string>& get_column_names() const
+    {
+        return m_reader.get_column_names();
+    }
+
+    bool read_row(Types&... values)
+    {
+        std::tuple<Types&...> refs(values...);
+        return read_row_impl(refs, detail::make_index_sequence<num_columns>());
+    }
+
+    bool read_row(row_type& values)
+    {
+        return read_row_impl(values, detail::make_index_sequence<num_columns>());
+    }
+
+    const reader::row& get_row() const
+    {
+        return m_reader.get_row();
+    }
+
+    // Counters since open(), see reader::get_stats().
+    reader_stats get_stats() const
+    {
+        return m_reader.get_stats();
+    }
+
+private:
+    template <typename Tuple, size_t... Is>
+    bool read_row_impl(Tuple& values, detail::index_sequence<Is...>);
+
+    reader m_reader;
+    std::array<size_t, num_columns> m_indexes;
+    size_t m_min_size = 0;
+};
+
+// Writer with a fixed schema, one column per type.
+template <typename... Types>
+class typed_writer
+{
+public:
+    typedef std::tuple<Types...> row_type;
+    static const size_t num_columns = sizeof...(Types);
+
+    typed_writer() = default;
+    typed_writer(const typed_writer&) = delete;
+    typed_writer(typed_writer&&) = default;
+    typed_writer& operator=(const typed_writer&) = delete;
+    typed_writer& operator=(typed_writer&&) = default;
+    ~typed_writer() = default;
+
+    bool open(const std::string& filename, const std::vector<std::string>& column_names, char delimiter = ',',
+              compression format = compression::none,
+              const compression_options& options = compression_options());
+
+    bool is_open() const
+    {
+        return m_writer.is_open();
+    }
+
+    bool close()
+    {
+        return m_writer.close();
+    }
+
+    void set_precision(size_t column, int precision)
+    {
+        m_writer.set_precision(column, precision);
+    }
+
+    void set_buffer_size(size_t buffer_size)
+    {
+        m_writer.set_buffer_size(buffer_size);
+    }
+
+    bool write_row(const Types&... values)
+    {
+        return m_writer.write_row(values...);
+    }
+
+    bool write_row(const row_type& values)
+    {
+        return write_row_impl(values, detail::make_index_sequence<num_columns>());
+    }
+
+    void flush()
+    {
+        m_writer.flush();
+    }
+
+private:
+    template <size_t... Is>
+    bool write_row_impl(const row_type& values, detail::index_sequence<Is...>)
+    {
+        return m_writer.write_row(std::get<Is>(values)...);
+    }
+
+    writer m_writer;
+};
+
+template <typename... Types>
+bool typed_reader<Types...>::open(const std::string& filename, char delimiter, read_mode mode)
+{
+    if (!m_reader.open(filename, delimiter, mode))
+    {
+        m_reader = reader();
+        return false;
+    }
+
+    if (m_reader.get_column_names().size() < num_columns)
+    {
+        m_reader = reader();
+        return false;
+    }
+
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        m_indexes[i] = i;
+    }
+
+    m_min_size = num_columns;
+    return true;
+}
+
+template <typename... Types>
+bool typed_reader<Types...>::open(const std::string& filename, const std::vector<std::string>& column_names,
+                                  char delimiter, read_mode mode)
+{
+    if (column_names.size() != num_columns)
+    {
+        m_reader = reader();
+        return false;
+    }
+
+    if (!m_reader.open(filename, delimiter, mode))
+    {
+        m_reader = reader();
+        return false;
+    }
+
+    m_min_size = 0;
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        m_indexes[i] = m_reader.get_column_index(column_names[i]);
+        if (m_indexes[i] == size_t(-1))
+        {
+            m_reader = reader();
+            return false;
+        }
+
+        m_min_size = std::max(m_min_size, m_indexes[i] + 1);
+    }
+
+    return true;
+}
+
+template <typename... Types>
+template <typename Tuple, size_t... Is>
+bool typed_reader<Types...>::read_row_impl(Tuple& values, detail::index_sequence<Is...>)
+{
+    // the fields past the last bound column aren't tokenized
+    if (!m_reader.next_row(m_min_size))
+    {
+        return false;
+    }
+
+    // size() would tokenize the rest of the row
+    const reader::row& row = m_reader.get_row();
+    if (row.m_column_offsets.size() < m_min_size)
+    {
+        return false;
+    }
+
+    CSV_STATS(detail::stats_timer convert_timer(row.m_stats.convert_time));
+
+    // fields that don't convert leave their values as they were, the
+    // failures only show in the stats
+    const bool converted[] = { true, convert<Types>::parse(row.get_field(m_indexes[Is]), std::get<Is>(values))... };
+    CSV_STATS(row.m_stats.conversion_failures += std::count(std::begin(converted), std::end(converted), false));
+    (void)converted;
+    return true;
+}
+
+template <typename... Types>
+bool typed_writer<Types...>::open(const std::string& filename, const std::vector<std::string>& column_names,
+                                  char delimiter, compression format, const compression_options& options)
+{
+    if (column_names.size() != num_columns)
+    {
+        return false;
+    }
+
+    m_writer.set_column_names(column_names);
+    return m_writer.open(filename, delimiter, format, options);
+}
+
+} // namespace csv
+
+#endif // CSV_TYPED_H
@@ -25,24 +25,81 @@
 #ifndef CSV_WRITER_H
 #define CSV_WRITER_H
 
-#include <fstream>
+#include "csv_byte_sink.h"
+#include "csv_compression.h"
+#include "csv_format.h"
+#include "csv_stats.h"
+
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
-#include <functional>
 
 namespace csv
 {
 
+namespace detail
+{
+    class shard_merger;
+
+    template <typename Arg>
+    void write_value(std::string& out, const std::vector<int>& precisions, size_t column, char, const Arg& arg,
+                     std::true_type /* is_floating_point */)
+    {
+        const int precision = (column < precisions.size()) ? precisions[column] : -1;
+        format<Arg>::write_fixed(out, arg, precision);
+    }
+
+    template <typename T, typename Arg>
+    void write_formatted(std::string& out, char delimiter, const Arg& arg, std::true_type /* is_text */)
+    {
+        format<T>::write(out, arg, delimiter);
+    }
+
+    template <typename T, typename Arg>
+    void write_formatted(std::string& out, char, const Arg& arg, std::false_type /* is_text */)
+    {
+        format<T>::write(out, arg);
+    }
+
+    template <typename Arg>
+    void write_value(std::string& out, const std::vector<int>&, size_t, char delimiter, const Arg& arg,
+                     std::false_type /* is_floating_point */)
+    {
+        typedef typename std::decay<Arg>::type value_type;
+        write_formatted<value_type>(out, delimiter, arg, is_text<value_type>());
+    }
+
+    // Formats the value of a column, with the column's precision for
+    // floating point values and quoted when it is text that needs it.
+    template <typename Arg>
+    void write_value(std::string& out, const std::vector<int>& precisions, size_t column, char delimiter,
+                     const Arg& arg)
+    {
+        write_value(out, precisions, column, delimiter, arg, std::is_floating_point<Arg>());
+    }
+} // namespace detail
+
 class writer
 {
 public:
+    // How the rows of shards are merged into the output, see new_shard().
+    enum class order
+    {
+        // in the order the shards were created
+        in_order,
+        // as soon as they are handed over
+        unordered
+    };
+
     class row
     {
     public:
-        explicit row(std::ofstream& filestream);
+        explicit row(writer& owner);
         row(const row&) = delete;
-        row(row&&) = default;
+        row(row&& other);
         row& operator=(const row&) = delete;
-        row& operator=(row&&) = default;
+        row& operator=(row&& other);
         ~row();
 
         size_t get_columns() const
@@ -55,14 +112,79 @@ public:
         template <typename Arg, typename... Args>
         void write_columns(const Arg& arg, const Args&... args);
 
+        // Ends the line. Writing more columns afterwards starts a new one.
         void flush();
 
     private:
         template <typename Arg>
         void write_columns(const Arg& arg);
 
-        std::reference_wrapper<std::ofstream> m_filestream;
+        writer* m_writer;
         size_t m_actual_columns = 0;
+        bool m_line_open = true;
+#if defined(CSV_HAVE_STATS)
+        // where the line starts in the writer's buffer
+        size_t m_line_begin = 0;
+#endif
+
+        friend class writer;
+    };
+
+    // Rows formatted on another thread into the shard's own buffer, without
+    // touching the writer's. Full buffers are handed to the writer's
+    // flusher thread, which is the only one writing to the output. Each
+    // shard must be used by one thread at a time.
+    class shard
+    {
+    public:
+        shard();
+        shard(const shard&) = delete;
+        shard(shard&& other);
+        shard& operator=(const shard&) = delete;
+        shard& operator=(shard&& other);
+        ~shard();
+
+        bool is_open() const
+        {
+            return static_cast<bool>(m_merger);
+        }
+
+        template <typename... Args>
+        bool write_row(const Args&... args);
+
+        // Hands the remaining rows over; nothing can be written afterwards.
+        // Also done by the destructor.
+        void close();
+
+        // Counters of the rows written through the shard, see
+        // writer::get_stats().
+        writer_stats get_stats() const;
+
+    private:
+        shard(std::shared_ptr<detail::shard_merger> merger, size_t slot, const writer& owner);
+
+        template <typename Arg>
+        void write_row_impl(size_t column, const Arg& arg);
+        template <typename Arg, typename... Args>
+        void write_row_impl(size_t column, const Arg& arg, const Args&... args);
+
+        void end_line();
+
+#if defined(CSV_HAVE_STATS)
+        void count_row(size_t num_fields, size_t row_size);
+#endif
+
+        std::shared_ptr<detail::shard_merger> m_merger;
+        size_t m_slot;
+        char m_delimiter;
+        size_t m_num_columns;
+        size_t m_buffer_size;
+        std::vector<int> m_precisions;
+        std::string m_buffer;
+
+#if defined(CSV_HAVE_STATS)
+        writer_stats m_stats;
+#endif
 
         friend class writer;
     };
@@ -71,20 +193,43 @@ public:
     writer(const writer&) = delete;
     writer(writer&&) = default;
     writer& operator=(const writer&) = delete;
-    writer& operator=(writer&&) = default;
+    // Closes the output of this writer before taking the other's.
+    writer& operator=(writer&& other);
     ~writer();
 
-    bool open(const char* filename, char delimiter = ',');
-    bool open(const std::string& filename, char delimiter = ',')
+    // Rows are formatted into a buffer of about this size, which is only
+    // written out when full or on flush(). Default is 1 MB.
+    void set_buffer_size(size_t buffer_size)
+    {
+        m_buffer_size = buffer_size;
+    }
+
+    size_t get_buffer_size() const
+    {
+        return m_buffer_size;
+    }
+
+    // Writes to a file, compressed with format if it isn't none; options
+    // can spread the compression over several threads.
+    bool open(const char* filename, char delimiter = ',', compression format = compression::none,
+              const compression_options& options = compression_options());
+    bool open(const std::string& filename, char delimiter = ',', compression format = compression::none,
+              const compression_options& options = compression_options())
     {
-        return open(filename.c_str(), delimiter);
+        return open(filename.c_str(), delimiter, format, options);
     }
+    bool open(std::unique_ptr<byte_sink> sink, char delimiter = ',');
 
     bool is_open() const
     {
-        return m_filestream.is_open();
+        return static_cast<bool>(m_sink);
     }
 
+    // Writes the buffered rows and finishes the output, which compressed
+    // streams need to be complete. Also done by open() and the destructor.
+    // Returns false if anything failed to be written.
+    bool close();
+
     char get_delimiter() const
     {
         return m_delimiter;
@@ -95,6 +240,11 @@ public:
         return m_column_names;
     }
 
+    // Writes the floating point values of a column with a fixed number of
+    // decimals. A negative precision goes back to the default, the shortest
+    // text that reads back as the same value.
+    void set_precision(size_t column, int precision);
+
     template <typename... Args>
     void set_column_names(const Args&... args);
     void set_column_names(std::vector<std::string> column_names)
@@ -106,6 +256,35 @@ public:
     bool write_row(const Args&... args);
     row new_row();
 
+    // Starts a shard at the current end of the output: with order::in_order
+    // its rows come after everything written or started before and before
+    // anything written or started after, wherever they are formatted. Rows
+    // of shards that aren't next are kept in memory until their turn. All
+    // shards have to be closed before the writer, rows of the others are
+    // lost and close() fails. The format of the columns is the one when
+    // the shard starts.
+    shard new_shard();
+
+    // Applied by the first new_shard() after open(). Default is
+    // order::in_order.
+    void set_shard_order(order shard_order)
+    {
+        m_shard_order = shard_order;
+    }
+
+    // Writes the buffered rows out. With shards, waits for the handed over
+    // rows that can be written, those of open shards aren't.
+    void flush();
+
+    // Counters since open(), see writer_stats. Rows written through shards
+    // are only counted by the shards. All 0 unless the library is built
+    // with LIBCSV_WITH_STATS.
+    writer_stats get_stats() const;
+
+    // Calls callback with the stats every every_rows rows; 0 rows or an
+    // empty callback stops the calls. Only with LIBCSV_WITH_STATS.
+    void set_stats_callback(size_t every_rows, writer_stats_callback callback);
+
 private:
     template <typename Arg>
     void set_col_name_impl(const Arg& arg);
@@ -113,17 +292,46 @@ private:
     void set_col_name_impl(const Arg& arg, const Args&... args);
 
     template <typename Arg>
-    void write_row_impl(const Arg& arg);
+    void write_row_impl(size_t column, const Arg& arg);
     template <typename Arg, typename... Args>
-    void write_row_impl(const Arg& arg, const Args&... args);
+    void write_row_impl(size_t column, const Arg& arg, const Args&... args);
+
+    template <typename Arg>
+    void write_value(size_t column, const Arg& arg)
+    {
+        detail::write_value(m_buffer, m_precisions, column, m_delimiter, arg);
+    }
 
     void write_header();
+    void end_line();
+    void write_buffer();
+
+#if defined(CSV_HAVE_STATS)
+    // row_size includes the '\n'
+    void count_row(size_t num_fields, size_t row_size);
+#endif
 
-    std::ofstream m_filestream;
+    std::unique_ptr<byte_sink> m_sink;
+    bool m_failed;
     char m_delimiter;
 
+    std::string m_buffer;
+    size_t m_buffer_size;
+
+    std::vector<int> m_precisions;
+
     bool m_header_written;
     std::vector<std::string> m_column_names;
+
+    // started by the first shard, from then on every buffer goes through it
+    std::shared_ptr<detail::shard_merger> m_merger;
+    order m_shard_order;
+
+#if defined(CSV_HAVE_STATS)
+    writer_stats m_stats;
+#endif
+    size_t m_stats_every;
+    writer_stats_callback m_stats_callback;
 };
 
 template <typename Arg>
@@ -142,7 +350,19 @@ void writer::row::write_columns(const Arg& arg, const Args&... args)
 template <typename Arg>
 void writer::row::write_columns(const Arg &arg)
 {
-    m_filestream.get() << arg << ',';
+    if (!m_line_open)
+    {
+        m_line_open = true;
+        m_actual_columns = 0;
+        CSV_STATS(m_line_begin = m_writer->m_buffer.size());
+    }
+
+    if (m_actual_columns > 0)
+    {
+        m_writer->m_buffer.push_back(m_writer->m_delimiter);
+    }
+
+    m_writer->write_value(m_actual_columns, arg);
     ++m_actual_columns;
 }
 
@@ -186,23 +406,64 @@ bool writer::write_row(const Args&... args)
         return false;
     }
 
-    write_row_impl(args...);
-    m_filestream << std::endl;
+    CSV_STATS(const size_t row_begin = m_buffer.size());
+    {
+        CSV_STATS(detail::stats_timer format_timer(m_stats.format_time));
+        write_row_impl(0, args...);
+    }
+
+    CSV_STATS(count_row(sizeof...(args), m_buffer.size() - row_begin + 1));
+    end_line();
+
+    return true;
+}
+
+template <typename Arg>
+void writer::write_row_impl(size_t column, const Arg& arg)
+{
+    write_value(column, arg);
+}
+
+template <typename Arg, typename... Args>
+void writer::write_row_impl(size_t column, const Arg& arg, const Args&... args)
+{
+    write_value(column, arg);
+    m_buffer.push_back(m_delimiter);
+    write_row_impl(column + 1, args...);
+}
+
+template <typename... Args>
+bool writer::shard::write_row(const Args&... args)
+{
+    if (!is_open() || (sizeof...(args) != m_num_columns))
+    {
+        return false;
+    }
+
+    CSV_STATS(const size_t row_begin = m_buffer.size());
+    {
+        CSV_STATS(detail::stats_timer format_timer(m_stats.format_time));
+        write_row_impl(0, args...);
+    }
+
+    CSV_STATS(count_row(sizeof...(args), m_buffer.size() - row_begin + 1));
+    end_line();
 
     return true;
 }
 
 template <typename Arg>
-void writer::write_row_impl(const Arg& arg)
+void writer::shard::write_row_impl(size_t column, const Arg& arg)
 {
-    m_filestream << arg;
+    detail::write_value(m_buffer, m_precisions, column, m_delimiter, arg);
 }
 
 template <typename Arg, typename... Args>
-void writer::write_row_impl(const Arg& arg, const Args&... args)
+void writer::shard::write_row_impl(size_t column, const Arg& arg, const Args&... args)
 {
-    m_filestream << arg << ',';
-    write_row_impl(args...);
+    detail::write_value(m_buffer, m_precisions, column, m_delimiter, arg);
+    m_buffer.push_back(m_delimiter);
+    write_row_impl(column + 1, args...);
 }
 
 } // namespace csv
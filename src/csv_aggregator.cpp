@@ -0,0 +1,526 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_aggregator.h"
+#include "csv_parallel_reader.h"
+#include "csv_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace csv
+{
+
+namespace
+{
+
+// rows gathered before the aggregates are computed over them
+const size_t batch_size = 1024;
+
+// The columns of a run, by index.
+struct layout
+{
+    std::vector<size_t> keys;
+    // the distinct columns aggregated
+    std::vector<size_t> values;
+    // for every output, its column in values, or size_t(-1) for a count
+    std::vector<size_t> slots;
+};
+
+struct value_state
+{
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    uint64_t count = 0;
+};
+
+template <typename File>
+bool bind_columns(const File& file, const std::vector<std::string>& key_names,
+                  const std::vector<aggregate>& functions, const std::vector<std::string>& columns, layout& out)
+{
+    for (const std::string& name : key_names)
+    {
+        const size_t index = file.get_column_index(name);
+        if (index == size_t(-1))
+        {
+            return false;
+        }
+
+        out.keys.push_back(index);
+    }
+
+    for (size_t i = 0; i < functions.size(); ++i)
+    {
+        if (functions[i] == aggregate::count)
+        {
+            out.slots.push_back(size_t(-1));
+            continue;
+        }
+
+        const size_t index = file.get_column_index(columns[i]);
+        if (index == size_t(-1))
+        {
+            return false;
+        }
+
+        const auto found = std::find(out.values.begin(), out.values.end(), index);
+        out.slots.push_back(static_cast<size_t>(found - out.values.begin()));
+        if (found == out.values.end())
+        {
+            out.values.push_back(index);
+        }
+    }
+
+    return true;
+}
+
+// FNV-1a
+uint64_t hash_bytes(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Open addressing table from the keys of the groups to their indexes,
+// with the keys stored one after the other.
+class group_table
+{
+public:
+    size_t size() const
+    {
+        return m_hashes.size();
+    }
+
+    // The index of the group of key, added if there is none.
+    uint32_t find_or_insert(const char* key, size_t size, bool& inserted)
+    {
+        if (2 * (m_hashes.size() + 1) > m_slots.size())
+        {
+            grow();
+        }
+
+        const uint64_t hash = hash_bytes(key, size);
+        const size_t mask = m_slots.size() - 1;
+        for (size_t pos = static_cast<size_t>(hash) & mask;; pos = (pos + 1) & mask)
+        {
+            const uint32_t entry = m_slots[pos];
+            if (entry == 0)
+            {
+                m_slots[pos] = static_cast<uint32_t>(m_hashes.size() + 1);
+                m_hashes.push_back(hash);
+                m_keys.append(key, size);
+                m_key_ends.push_back(m_keys.size());
+
+                inserted = true;
+                return entry_index(m_slots[pos]);
+            }
+
+            const uint32_t group = entry_index(entry);
+            if ((m_hashes[group] == hash) && (get_key_size(group) == size) &&
+                ((size == 0) || (std::memcmp(get_key(group), key, size) == 0)))
+            {
+                inserted = false;
+                return group;
+            }
+        }
+    }
+
+    const char* get_key(size_t group) const
+    {
+        return m_keys.data() + ((group > 0) ? m_key_ends[group - 1] : 0);
+    }
+
+    size_t get_key_size(size_t group) const
+    {
+        return m_key_ends[group] - ((group > 0) ? m_key_ends[group - 1] : 0);
+    }
+
+private:
+    static uint32_t entry_index(uint32_t entry)
+    {
+        return entry - 1;
+    }
+
+    void grow()
+    {
+        m_slots.assign(std::max<size_t>(64, 2 * m_slots.size()), 0);
+
+        const size_t mask = m_slots.size() - 1;
+        for (size_t group = 0; group < m_hashes.size(); ++group)
+        {
+            size_t pos = static_cast<size_t>(m_hashes[group]) & mask;
+            while (m_slots[pos] != 0)
+            {
+                pos = (pos + 1) & mask;
+            }
+
+            m_slots[pos] = static_cast<uint32_t>(group + 1);
+        }
+    }
+
+    // group index + 1, 0 for empty slots
+    std::vector<uint32_t> m_slots;
+    std::vector<uint64_t> m_hashes;
+    std::string m_keys;
+    std::vector<size_t> m_key_ends;
+};
+
+// Aggregates values of a single group; independent lanes let the
+// additions and comparisons run side by side, or be vectorized.
+void accumulate(const double* values, size_t count, value_state& state)
+{
+    double sums[4] = { 0, 0, 0, 0 };
+    double mins[4] = { state.min, state.min, state.min, state.min };
+    double maxs[4] = { state.max, state.max, state.max, state.max };
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            const double value = values[i + lane];
+            sums[lane] += value;
+            mins[lane] = (value < mins[lane]) ? value : mins[lane];
+            maxs[lane] = (value > maxs[lane]) ? value : maxs[lane];
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        sums[0] += values[i];
+        mins[0] = std::min(mins[0], values[i]);
+        maxs[0] = std::max(maxs[0], values[i]);
+    }
+
+    state.sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    state.min = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+    state.max = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+    state.count += count;
+}
+
+// Aggregates values of any groups, those of value i into
+// states[groups[i] * stride].
+void accumulate(const double* values, const uint32_t* groups, size_t count, value_state* states, size_t stride)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        value_state& state = states[groups[i] * stride];
+        state.sum += values[i];
+        state.min = std::min(state.min, values[i]);
+        state.max = std::max(state.max, values[i]);
+        ++state.count;
+    }
+}
+
+void combine(value_state& state, const value_state& other)
+{
+    state.sum += other.sum;
+    state.min = std::min(state.min, other.min);
+    state.max = std::max(state.max, other.max);
+    state.count += other.count;
+}
+
+// The groups of the rows seen by one thread.
+class partial
+{
+public:
+    explicit partial(const layout& columns)
+        : m_layout(columns),
+          m_values(columns.values.size()),
+          m_value_groups(columns.values.size())
+    {
+        if (m_layout.keys.empty())
+        {
+            add_group("", 0);
+        }
+    }
+
+    void add_row(const reader::row& row)
+    {
+        const size_t num_fields = row.size();
+
+        uint32_t group = 0;
+        if (!m_layout.keys.empty())
+        {
+            // every value is preceded by its length, so that the keys of
+            // several columns can't run into each other
+            m_key.clear();
+            for (size_t column : m_layout.keys)
+            {
+                const size_t begin = m_key.size() + sizeof(uint32_t);
+                m_key.resize(begin);
+                if (column < num_fields)
+                {
+                    detail::append_field(m_key, row.get_field(column));
+                }
+
+                const uint32_t size = static_cast<uint32_t>(m_key.size() - begin);
+                std::memcpy(&m_key[begin - sizeof(uint32_t)], &size, sizeof(size));
+            }
+
+            group = add_group(m_key.data(), m_key.size());
+        }
+
+        m_batch_groups.push_back(group);
+        for (size_t slot = 0; slot < m_layout.values.size(); ++slot)
+        {
+            const size_t column = m_layout.values[slot];
+            double value = 0;
+            if ((column < num_fields) && convert<double>::parse(row.get_field(column), value))
+            {
+                m_values[slot].push_back(value);
+                m_value_groups[slot].push_back(group);
+            }
+        }
+
+        if (m_batch_groups.size() >= batch_size)
+        {
+            flush();
+        }
+    }
+
+    // Aggregates the rows added since the last flush.
+    void flush()
+    {
+        for (uint32_t group : m_batch_groups)
+        {
+            ++m_rows[group];
+        }
+
+        const size_t stride = m_layout.values.size();
+        for (size_t slot = 0; slot < stride; ++slot)
+        {
+            const std::vector<double>& values = m_values[slot];
+            if (m_layout.keys.empty())
+            {
+                accumulate(values.data(), values.size(), m_states[slot]);
+            }
+            else
+            {
+                accumulate(values.data(), m_value_groups[slot].data(), values.size(), m_states.data() + slot, stride);
+            }
+
+            m_values[slot].clear();
+            m_value_groups[slot].clear();
+        }
+
+        m_batch_groups.clear();
+    }
+
+    void merge(const partial& other)
+    {
+        const size_t stride = m_layout.values.size();
+        for (size_t group = 0; group < other.m_groups.size(); ++group)
+        {
+            const uint32_t target = add_group(other.m_groups.get_key(group), other.m_groups.get_key_size(group));
+            m_rows[target] += other.m_rows[group];
+            for (size_t slot = 0; slot < stride; ++slot)
+            {
+                combine(m_states[target * stride + slot], other.m_states[group * stride + slot]);
+            }
+        }
+    }
+
+    std::vector<aggregator::group> get_groups(const std::vector<aggregate>& functions) const
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const size_t stride = m_layout.values.size();
+
+        std::vector<aggregator::group> groups(m_groups.size());
+        for (size_t index = 0; index < groups.size(); ++index)
+        {
+            aggregator::group& result = groups[index];
+
+            const char* key = m_groups.get_key(index);
+            const char* key_end = key + m_groups.get_key_size(index);
+            while (key < key_end)
+            {
+                uint32_t size = 0;
+                std::memcpy(&size, key, sizeof(size));
+                key += sizeof(size);
+                result.keys.emplace_back(key, size);
+                key += size;
+            }
+
+            result.rows = m_rows[index];
+            for (size_t i = 0; i < functions.size(); ++i)
+            {
+                if (functions[i] == aggregate::count)
+                {
+                    result.values.push_back(static_cast<double>(result.rows));
+                    continue;
+                }
+
+                const value_state& state = m_states[index * stride + m_layout.slots[i]];
+                switch (functions[i])
+                {
+                case aggregate::sum:
+                    result.values.push_back(state.sum);
+                    break;
+                case aggregate::min:
+                    result.values.push_back((state.count > 0) ? state.min : nan);
+                    break;
+                case aggregate::max:
+                    result.values.push_back((state.count > 0) ? state.max : nan);
+                    break;
+                default:
+                    result.values.push_back((state.count > 0) ? state.sum / state.count : nan);
+                    break;
+                }
+            }
+        }
+
+        std::sort(groups.begin(), groups.end(), [](const aggregator::group& lhs, const aggregator::group& rhs)
+        {
+            return lhs.keys < rhs.keys;
+        });
+
+        return groups;
+    }
+
+private:
+    uint32_t add_group(const char* key, size_t size)
+    {
+        bool inserted = false;
+        const uint32_t group = m_groups.find_or_insert(key, size, inserted);
+        if (inserted)
+        {
+            m_rows.push_back(0);
+            m_states.resize(m_states.size() + m_layout.values.size());
+        }
+
+        return group;
+    }
+
+    const layout& m_layout;
+
+    group_table m_groups;
+    std::vector<uint64_t> m_rows;
+    // group after group, one per column in m_layout.values
+    std::vector<value_state> m_states;
+
+    // the batch: the group of every row, and for each column the values
+    // that converted along with their groups
+    std::vector<uint32_t> m_batch_groups;
+    std::vector<std::vector<double>> m_values;
+    std::vector<std::vector<uint32_t>> m_value_groups;
+    std::string m_key;
+};
+
+} // namespace
+
+void aggregator::add(aggregate function, std::string column)
+{
+    m_functions.push_back(function);
+    m_columns.push_back(std::move(column));
+}
+
+bool aggregator::run(reader& file)
+{
+    m_groups.clear();
+
+    layout columns;
+    if (!file.is_open() || !bind_columns(file, m_key_names, m_functions, m_columns, columns))
+    {
+        return false;
+    }
+
+    partial state(columns);
+    while (file.next_row())
+    {
+        state.add_row(file.get_row());
+    }
+
+    state.flush();
+    m_groups = state.get_groups(m_functions);
+    return true;
+}
+
+bool aggregator::run(parallel_reader& file)
+{
+    m_groups.clear();
+
+    layout columns;
+    if (!file.is_open() || !bind_columns(file, m_key_names, m_functions, m_columns, columns))
+    {
+        return false;
+    }
+
+    // a chunk takes any partial that isn't in use, so there are at most as
+    // many as threads
+    std::mutex mutex;
+    std::vector<std::unique_ptr<partial>> partials;
+
+    const bool read = file.read_chunks([&](const parallel_reader::chunk& rows)
+    {
+        std::unique_ptr<partial> state;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!partials.empty())
+            {
+                state = std::move(partials.back());
+                partials.pop_back();
+            }
+        }
+
+        if (!state)
+        {
+            state.reset(new partial(columns));
+        }
+
+        for (const reader::row& row : rows)
+        {
+            state->add_row(row);
+        }
+
+        state->flush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        partials.push_back(std::move(state));
+    }, parallel_reader::order::unordered);
+
+    if (!read)
+    {
+        return false;
+    }
+
+    partial total(columns);
+    for (const std::unique_ptr<partial>& state : partials)
+    {
+        total.merge(*state);
+    }
+
+    m_groups = total.get_groups(m_functions);
+    return true;
+}
+
+} // namespace csv
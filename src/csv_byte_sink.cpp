@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_byte_sink.h"
+
+namespace csv
+{
+
+bool file_sink::open(const char* filename, std::ios_base::openmode mode)
+{
+    m_file.close();
+    m_file.clear();
+
+    // writers buffer whole blocks already, the file stream doesn't need to
+    m_file.rdbuf()->pubsetbuf(nullptr, 0);
+    m_file.open(filename, mode);
+    return m_file.is_open();
+}
+
+bool file_sink::write(const char* data, size_t size)
+{
+    m_file.write(data, static_cast<std::streamsize>(size));
+    return m_file.good();
+}
+
+bool file_sink::flush()
+{
+    m_file.flush();
+    return m_file.good();
+}
+
+bool file_sink::close()
+{
+    if (!m_file.is_open())
+    {
+        return true;
+    }
+
+    m_file.close();
+    return !m_file.fail();
+}
+
+bool stream_sink::write(const char* data, size_t size)
+{
+    m_stream.write(data, static_cast<std::streamsize>(size));
+    return m_stream.good();
+}
+
+bool stream_sink::flush()
+{
+    m_stream.flush();
+    return m_stream.good();
+}
+
+} // namespace csv
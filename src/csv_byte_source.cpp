@@ -0,0 +1,60 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_byte_source.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace csv
+{
+
+bool file_source::open(const char* filename)
+{
+    m_file.close();
+    m_file.clear();
+    m_file.open(filename, std::ios::binary);
+    return m_file.is_open();
+}
+
+size_t file_source::read(char* buffer, size_t size)
+{
+    m_file.read(buffer, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(m_file.gcount());
+}
+
+size_t memory_source::read(char* buffer, size_t size)
+{
+    const size_t read_size = std::min(size, m_size - m_pos);
+    std::memcpy(buffer, m_data + m_pos, read_size);
+    m_pos += read_size;
+    return read_size;
+}
+
+size_t stream_source::read(char* buffer, size_t size)
+{
+    m_stream.read(buffer, static_cast<std::streamsize>(size));
+    return static_cast<size_t>(m_stream.gcount());
+}
+
+} // namespace csv
@@ -0,0 +1,630 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_cache.h"
+#include "csv_compression.h"
+#include "csv_convert.h"
+#include "csv_dictionary.h"
+#include "csv_scanner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace csv
+{
+
+namespace
+{
+
+// the version is part of the magic, old sidecars are rebuilt
+const char cache_magic[8] = { 'C', 'S', 'V', 'C', 'C', 'H', '0', '2' };
+
+// bytes at each end of the file that go into its checksum
+const size_t checksum_block_size = size_t(64) << 10;
+
+// FNV-1a over 8 bytes at a time
+uint64_t hash_bytes(uint64_t hash, const char* data, size_t size)
+{
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+
+    for (; size > 0; ++data, --size)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*data)) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+// Checksum of the size and of the first and last blocks of a file, which
+// a rewrite at the same size and time usually changes. head and tail hold
+// min(size, checksum_block_size) bytes.
+uint64_t get_checksum(const char* head, const char* tail, uint64_t size)
+{
+    const size_t block_size = static_cast<size_t>(std::min<uint64_t>(size, checksum_block_size));
+    uint64_t hash = hash_bytes(14695981039346656037ULL, reinterpret_cast<const char*>(&size), sizeof(size));
+    hash = hash_bytes(hash, head, block_size);
+    return hash_bytes(hash, tail, block_size);
+}
+
+bool get_file_checksum(const char* filename, uint64_t size, uint64_t& checksum)
+{
+    std::ifstream file(filename, std::ios::binary);
+    const size_t block_size = static_cast<size_t>(std::min<uint64_t>(size, checksum_block_size));
+    std::vector<char> head(block_size);
+    std::vector<char> tail(block_size);
+    if (!file.read(head.data(), static_cast<std::streamsize>(block_size)) ||
+        !file.seekg(static_cast<std::streamoff>(size - block_size)) ||
+        !file.read(tail.data(), static_cast<std::streamsize>(block_size)))
+    {
+        return false;
+    }
+
+    checksum = get_checksum(head.data(), tail.data(), size);
+    return true;
+}
+
+// Sections of the image are padded to 8 bytes, so that every array in it
+// is aligned once it is mapped.
+void append_bytes(std::vector<char>& image, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    image.insert(image.end(), bytes, bytes + size);
+    image.resize((image.size() + 7) & ~size_t(7), '\0');
+}
+
+template <typename T>
+void append_value(std::vector<char>& image, const T& value)
+{
+    append_bytes(image, &value, sizeof(value));
+}
+
+template <typename T>
+void append_array(std::vector<char>& image, const std::vector<T>& values)
+{
+    append_bytes(image, values.data(), values.size() * sizeof(T));
+}
+
+// Reads the image back in the order it was appended, refusing to go past its end.
+class image_cursor
+{
+public:
+    image_cursor(const char* data, size_t size)
+        : m_pos(data),
+          m_end(data + size)
+    {
+    }
+
+    const char* get_bytes(size_t size)
+    {
+        const size_t padded = (size + 7) & ~size_t(7);
+        if ((padded < size) || (static_cast<size_t>(m_end - m_pos) < padded))
+        {
+            return nullptr;
+        }
+
+        const char* bytes = m_pos;
+        m_pos += padded;
+        return bytes;
+    }
+
+    template <typename T>
+    bool get_value(T& value)
+    {
+        const char* bytes = get_bytes(sizeof(value));
+        if (bytes == nullptr)
+        {
+            return false;
+        }
+
+        std::memcpy(&value, bytes, sizeof(value));
+        return true;
+    }
+
+    template <typename T>
+    const T* get_array(uint64_t count)
+    {
+        if (count > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            return nullptr;
+        }
+
+        return reinterpret_cast<const T*>(get_bytes(static_cast<size_t>(count) * sizeof(T)));
+    }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+};
+
+// Tokenizes the record at begin, returns where the next one starts.
+// fields_end is the end of its last field, without the CR of a CRLF.
+const char* read_record(const char* begin, const char* end, char delimiter,
+                        std::vector<std::streamoff>& offsets, std::streamoff& fields_end)
+{
+    const detail::scan_result result = detail::scan_fields(begin, end, delimiter, size_t(-1), true, offsets);
+
+    std::streamoff size = result.record_end - begin;
+    if ((size > 0) && (begin[size - 1] == '\r'))
+    {
+        --size;
+    }
+
+    fields_end = std::min(static_cast<std::streamoff>(result.fields_end - begin), size);
+    return (result.record_end == end) ? end : result.record_end + 1;
+}
+
+// false for the missing fields of short records
+bool get_field(const char* record, const std::vector<std::streamoff>& offsets, std::streamoff fields_end,
+               size_t index, field_view& field)
+{
+    if (index >= offsets.size())
+    {
+        return false;
+    }
+
+    const char* begin = record + offsets[index];
+    const char* end = (index + 1 < offsets.size()) ? record + offsets[index + 1] - 1 : record + fields_end;
+    field = detail::make_field(begin, end);
+    return true;
+}
+
+// the field without the spaces around it, which convert<> doesn't all skip
+field_view trim(const field_view& field)
+{
+    const char* first = detail::skip_spaces(field.begin(), field.end());
+    const char* last = field.end();
+    while ((last != first) && ((last[-1] == ' ') || (last[-1] == '\t')))
+    {
+        --last;
+    }
+
+    return field_view(first, static_cast<size_t>(last - first));
+}
+
+// One column while it is converted. It starts with the type of the layout
+// and is demoted as soon as a field doesn't have it: integers go to reals
+// as they are, other columns go back to the fields of the previous rows
+// to turn them into text.
+class column_builder
+{
+public:
+    explicit column_builder(column_type type)
+        : m_type(type)
+    {
+        // only these are stored as typed values
+        if ((m_type != column_type::integer) && (m_type != column_type::real))
+        {
+            m_type = column_type::text;
+        }
+    }
+
+    column_type get_type() const
+    {
+        return m_type;
+    }
+
+    // Whether the field could be stored with the type of the column; a
+    // column that went to text has to go through the earlier rows again.
+    bool add(const field_view* field, size_t row)
+    {
+        if (row % 64 == 0)
+        {
+            m_nulls.push_back(0);
+        }
+
+        column_type kind = column_type::text;
+        const bool is_null = (field == nullptr) || !classify(*field, kind);
+        if (is_null)
+        {
+            m_nulls.back() |= uint64_t(1) << (row % 64);
+        }
+
+        if (m_type == column_type::integer)
+        {
+            int64_t value = 0;
+            if (is_null || ((kind == column_type::integer) && convert<int64_t>::parse(trim(*field), value)))
+            {
+                m_integers.push_back(value);
+                return true;
+            }
+
+            if ((kind != column_type::integer) && (kind != column_type::real))
+            {
+                return demote_to_text();
+            }
+
+            // nulls were 0 as integers, they are NaN as reals
+            m_type = column_type::real;
+            m_reals.assign(m_integers.begin(), m_integers.end());
+            for (size_t earlier = 0; earlier < m_reals.size(); ++earlier)
+            {
+                if ((m_nulls[earlier / 64] >> (earlier % 64)) & 1)
+                {
+                    m_reals[earlier] = std::numeric_limits<double>::quiet_NaN();
+                }
+            }
+            m_integers = std::vector<int64_t>();
+        }
+
+        if (m_type == column_type::real)
+        {
+            double value = std::numeric_limits<double>::quiet_NaN();
+            if (is_null || (((kind == column_type::integer) || (kind == column_type::real)) &&
+                            convert<double>::parse(trim(*field), value)))
+            {
+                m_reals.push_back(value);
+                return true;
+            }
+
+            return demote_to_text();
+        }
+
+        add_text((field == nullptr) ? field_view() : *field);
+        return true;
+    }
+
+    // Only for text columns, with the nulls already added.
+    void add_text(const field_view& field)
+    {
+        m_codes.push_back(m_dictionary.intern(field));
+    }
+
+    void append_to(std::vector<char>& image) const
+    {
+        append_array(image, m_nulls);
+        if (m_type == column_type::integer)
+        {
+            append_array(image, m_integers);
+        }
+        else if (m_type == column_type::real)
+        {
+            append_array(image, m_reals);
+        }
+        else
+        {
+            std::vector<uint64_t> value_ends(1, 0);
+            std::string text;
+            for (uint32_t code = 0; code < m_dictionary.size(); ++code)
+            {
+                const field_view& value = m_dictionary.get_value(code);
+                text.append(value.data(), value.size());
+                value_ends.push_back(text.size());
+            }
+
+            append_array(image, m_codes);
+            append_value(image, static_cast<uint64_t>(m_dictionary.size()));
+            append_array(image, value_ends);
+            append_bytes(image, text.data(), text.size());
+        }
+    }
+
+private:
+    bool demote_to_text()
+    {
+        m_type = column_type::text;
+        m_integers = std::vector<int64_t>();
+        m_reals = std::vector<double>();
+        return false;
+    }
+
+    column_type m_type;
+    std::vector<uint64_t> m_nulls;
+    std::vector<int64_t> m_integers;
+    std::vector<double> m_reals;
+
+    std::vector<uint32_t> m_codes;
+    dictionary m_dictionary;
+};
+
+} // namespace
+
+cache::cache()
+    : m_delimiter(','),
+      m_num_rows(0),
+      m_record_offsets(nullptr)
+{
+}
+
+void cache::clear()
+{
+    m_filename.clear();
+    m_delimiter = ',';
+    m_num_rows = 0;
+    m_column_names.clear();
+    m_column_index.clear();
+    m_columns.clear();
+    m_record_offsets = nullptr;
+    m_image = std::vector<char>();
+    m_mapping.close();
+}
+
+bool cache::build(const char* filename)
+{
+    schema layout;
+    return sniff(filename, layout) && build(filename, layout);
+}
+
+bool cache::build(const char* filename, const schema& layout)
+{
+    clear();
+    if (!build_image(filename, layout) || !parse_image(m_image.data(), m_image.size()))
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool cache::build_image(const char* filename, const schema& layout)
+{
+    const size_t num_columns = layout.column_names.size();
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+    detail::mapped_file mapping;
+    if ((num_columns == 0) || (detect_file_compression(filename) != compression::none) ||
+        !mapping.open(filename) || !detail::get_file_info(filename, file_size, file_mtime) ||
+        (file_size != mapping.size()))
+    {
+        return false;
+    }
+
+    std::vector<column_builder> columns;
+    columns.reserve(num_columns);
+    for (size_t column = 0; column < num_columns; ++column)
+    {
+        columns.emplace_back((column < layout.column_types.size()) ? layout.column_types[column] : column_type::text);
+    }
+
+    const char* begin = mapping.data();
+    const char* end = begin + mapping.size();
+    const char* pos = begin;
+
+    std::vector<std::streamoff> offsets;
+    std::streamoff fields_end = 0;
+    if (layout.has_header && (pos < end))
+    {
+        pos = read_record(pos, end, layout.delimiter, offsets, fields_end);
+    }
+
+    std::vector<uint64_t> record_offsets;
+    std::vector<std::streamoff> earlier_offsets;
+    while (pos < end)
+    {
+        const size_t row = record_offsets.size();
+        record_offsets.push_back(static_cast<uint64_t>(pos - begin));
+
+        const char* record = pos;
+        pos = read_record(record, end, layout.delimiter, offsets, fields_end);
+
+        for (size_t column = 0; column < num_columns; ++column)
+        {
+            field_view field;
+            const bool present = get_field(record, offsets, fields_end, column, field);
+            if (columns[column].add(present ? &field : nullptr, row))
+            {
+                continue;
+            }
+
+            // the column just went to text, the earlier rows are read again
+            // for their fields as they are in the file
+            for (size_t earlier = 0; earlier <= row; ++earlier)
+            {
+                const char* earlier_record = begin + record_offsets[earlier];
+                std::streamoff earlier_end = 0;
+                read_record(earlier_record, end, layout.delimiter, earlier_offsets, earlier_end);
+
+                field_view earlier_field;
+                get_field(earlier_record, earlier_offsets, earlier_end, column, earlier_field);
+                columns[column].add_text(earlier_field);
+            }
+        }
+    }
+
+    m_image.assign(cache_magic, cache_magic + sizeof(cache_magic));
+    const size_t checksum_size = static_cast<size_t>(std::min<uint64_t>(file_size, checksum_block_size));
+    append_value(m_image, file_size);
+    append_value(m_image, file_mtime);
+    append_value(m_image, get_checksum(begin, end - checksum_size, file_size));
+    append_value(m_image, static_cast<uint64_t>(layout.delimiter));
+    append_value(m_image, static_cast<uint64_t>(record_offsets.size()));
+    append_value(m_image, static_cast<uint64_t>(num_columns));
+    append_value(m_image, static_cast<uint64_t>(std::strlen(filename)));
+    append_bytes(m_image, filename, std::strlen(filename));
+
+    for (size_t column = 0; column < num_columns; ++column)
+    {
+        const std::string& name = layout.column_names[column];
+        append_value(m_image, static_cast<uint64_t>(columns[column].get_type()));
+        append_value(m_image, static_cast<uint64_t>(name.size()));
+        append_bytes(m_image, name.data(), name.size());
+        columns[column].append_to(m_image);
+    }
+
+    append_array(m_image, record_offsets);
+    return true;
+}
+
+bool cache::parse_image(const char* data, size_t size)
+{
+    image_cursor cursor(data, size);
+
+    const char* magic = cursor.get_bytes(sizeof(cache_magic));
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+    uint64_t file_checksum = 0;
+    uint64_t delimiter = 0;
+    uint64_t num_rows = 0;
+    uint64_t num_columns = 0;
+    uint64_t filename_size = 0;
+    if ((magic == nullptr) || (std::memcmp(magic, cache_magic, sizeof(cache_magic)) != 0) ||
+        !cursor.get_value(file_size) || !cursor.get_value(file_mtime) || !cursor.get_value(file_checksum) ||
+        !cursor.get_value(delimiter) ||
+        !cursor.get_value(num_rows) || !cursor.get_value(num_columns) || !cursor.get_value(filename_size) ||
+        (num_rows > std::numeric_limits<size_t>::max() - 63))
+    {
+        return false;
+    }
+
+    const char* filename = cursor.get_bytes(static_cast<size_t>(filename_size));
+    if (filename == nullptr)
+    {
+        return false;
+    }
+
+    m_filename.assign(filename, static_cast<size_t>(filename_size));
+    m_delimiter = static_cast<char>(delimiter);
+    m_num_rows = static_cast<size_t>(num_rows);
+
+    for (uint64_t column = 0; column < num_columns; ++column)
+    {
+        uint64_t type = 0;
+        uint64_t name_size = 0;
+        if (!cursor.get_value(type) || !cursor.get_value(name_size))
+        {
+            return false;
+        }
+
+        const char* name = cursor.get_bytes(static_cast<size_t>(name_size));
+        column_data data;
+        data.type = static_cast<column_type>(type);
+        data.nulls = cursor.get_array<uint64_t>((num_rows + 63) / 64);
+        if ((name == nullptr) || (data.nulls == nullptr))
+        {
+            return false;
+        }
+
+        if (data.type == column_type::integer)
+        {
+            data.values = cursor.get_array<int64_t>(num_rows);
+        }
+        else if (data.type == column_type::real)
+        {
+            data.values = cursor.get_array<double>(num_rows);
+        }
+        else if (data.type == column_type::text)
+        {
+            const uint32_t* codes = cursor.get_array<uint32_t>(num_rows);
+            uint64_t dictionary_size = 0;
+            if ((codes == nullptr) || !cursor.get_value(dictionary_size) || (dictionary_size >= uint32_t(-1)))
+            {
+                return false;
+            }
+
+            data.values = codes;
+            data.dictionary_size = static_cast<size_t>(dictionary_size);
+            data.value_ends = cursor.get_array<uint64_t>(dictionary_size + 1);
+            if (data.value_ends == nullptr)
+            {
+                return false;
+            }
+
+            data.text = cursor.get_bytes(static_cast<size_t>(data.value_ends[dictionary_size]));
+            if ((data.text == nullptr) ||
+                std::any_of(codes, codes + m_num_rows,
+                            [&](uint32_t code) { return code >= dictionary_size; }) ||
+                !std::is_sorted(data.value_ends, data.value_ends + dictionary_size + 1))
+            {
+                return false;
+            }
+        }
+
+        if (data.values == nullptr)
+        {
+            return false;
+        }
+
+        m_column_names.emplace_back(name, static_cast<size_t>(name_size));
+        m_columns.push_back(data);
+    }
+
+    m_record_offsets = cursor.get_array<uint64_t>(num_rows);
+    if (m_record_offsets == nullptr)
+    {
+        return false;
+    }
+
+    m_column_index.build(m_column_names);
+
+    // the file changed since the cache was built
+    uint64_t current_size = 0;
+    int64_t current_mtime = 0;
+    uint64_t current_checksum = 0;
+    return detail::get_file_info(m_filename.c_str(), current_size, current_mtime) &&
+           (current_size == file_size) && (current_mtime == file_mtime) &&
+           get_file_checksum(m_filename.c_str(), current_size, current_checksum) &&
+           (current_checksum == file_checksum);
+}
+
+bool cache::save(const char* path) const
+{
+    const char* data = m_image.empty() ? m_mapping.data() : m_image.data();
+    const size_t size = m_image.empty() ? m_mapping.size() : m_image.size();
+    if (empty())
+    {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(data, static_cast<std::streamsize>(size));
+    return file.good();
+}
+
+bool cache::load(const char* path)
+{
+    clear();
+    if (!m_mapping.open(path) || !parse_image(m_mapping.data(), m_mapping.size()))
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool cache::load_or_build(const char* filename)
+{
+    const std::string sidecar = get_sidecar_path(filename);
+    if (load(sidecar.c_str()) && (m_filename == filename))
+    {
+        return true;
+    }
+
+    if (!build(filename))
+    {
+        return false;
+    }
+
+    // a cache that can't be saved still works for this process
+    save(sidecar.c_str());
+    return true;
+}
+
+} // namespace csv
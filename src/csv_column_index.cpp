@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "csv_column_index.h"
+
+#include <cstring>
+
+namespace csv
+{
+namespace detail
+{
+
+void column_name_index::build(const std::vector<std::string>& names)
+{
+    size_t num_slots = 16;
+    while (num_slots < 2 * names.size())
+    {
+        num_slots *= 2;
+    }
+
+    m_slots.assign(num_slots, 0);
+
+    const size_t mask = num_slots - 1;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        size_t slot = hash(names[i].data(), names[i].size()) & mask;
+        while (m_slots[slot] != 0)
+        {
+            if (names[m_slots[slot] - 1] == names[i])
+            {
+                break;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+
+        if (m_slots[slot] == 0)
+        {
+            m_slots[slot] = static_cast<uint32_t>(i + 1);
+        }
+    }
+}
+
+void column_name_index::clear()
+{
+    m_slots.clear();
+}
+
+size_t column_name_index::find(const std::vector<std::string>& names, const char* name, size_t length) const
+{
+    if (m_slots.empty())
+    {
+        return size_t(-1);
+    }
+
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash(name, length) & mask; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const std::string& candidate = names[m_slots[slot] - 1];
+        if ((candidate.size() == length) &&
+            (std::memcmp(candidate.data(), name, length) == 0))
+        {
+            return m_slots[slot] - 1;
+        }
+    }
+
+    return size_t(-1);
+}
+
+uint32_t column_name_index::hash(const char* name, size_t length)
+{
+    // FNV-1a, column names are short
+    uint32_t value = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        value ^= static_cast<unsigned char>(name[i]);
+        value *= 16777619u;
+    }
+
+    return value;
+}
+
+} // namespace detail
+} // namespace csv
@@ -0,0 +1,921 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_compression.h"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(CSV_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(CSV_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(CSV_HAVE_LZ4)
+#include <lz4frame.h>
+#endif
+
+namespace csv
+{
+
+namespace
+{
+
+// compressed input read from the underlying source at a time
+const size_t input_buffer_size = size_t(256) << 10;
+
+#if defined(CSV_HAVE_ZLIB)
+
+class gzip_source : public byte_source
+{
+public:
+    explicit gzip_source(std::unique_ptr<byte_source> source)
+        : m_source(std::move(source)),
+          m_input(input_buffer_size),
+          m_stream(),
+          m_initialized(false),
+          m_failed(false)
+    {
+        // 16 + MAX_WBITS only accepts the gzip wrapper
+        m_initialized = (inflateInit2(&m_stream, 16 + MAX_WBITS) == Z_OK);
+        m_failed = !m_initialized;
+    }
+
+    ~gzip_source()
+    {
+        if (m_initialized)
+        {
+            inflateEnd(&m_stream);
+        }
+    }
+
+    size_t read(char* buffer, size_t size) override
+    {
+        if (m_failed)
+        {
+            return 0;
+        }
+
+        m_stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        m_stream.avail_out = static_cast<uInt>(std::min<size_t>(size, UINT_MAX));
+        const uInt requested = m_stream.avail_out;
+
+        while (m_stream.avail_out > 0)
+        {
+            if (m_stream.avail_in == 0)
+            {
+                const size_t read_size = m_source->read(m_input.data(), m_input.size());
+                if (read_size == 0)
+                {
+                    // the input ended inside a member
+                    m_failed = m_source->failed() || (m_stream.total_in > 0);
+                    break;
+                }
+
+                m_stream.next_in = reinterpret_cast<Bytef*>(m_input.data());
+                m_stream.avail_in = static_cast<uInt>(read_size);
+            }
+
+            const int ret = inflate(&m_stream, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END)
+            {
+                // files can be several gzip members back to back, which is
+                // what parallel compressors write
+                if (inflateReset(&m_stream) != Z_OK)
+                {
+                    m_failed = true;
+                    break;
+                }
+            }
+            else if (ret != Z_OK)
+            {
+                m_failed = true;
+                break;
+            }
+        }
+
+        return requested - m_stream.avail_out;
+    }
+
+    bool failed() const override
+    {
+        return m_failed;
+    }
+
+private:
+    std::unique_ptr<byte_source> m_source;
+    std::vector<char> m_input;
+    z_stream m_stream;
+    bool m_initialized;
+    bool m_failed;
+};
+
+#endif // CSV_HAVE_ZLIB
+
+#if defined(CSV_HAVE_ZSTD)
+
+class zstd_source : public byte_source
+{
+public:
+    explicit zstd_source(std::unique_ptr<byte_source> source)
+        : m_source(std::move(source)),
+          m_input(ZSTD_DStreamInSize()),
+          m_stream(ZSTD_createDStream()),
+          m_in_frame(false),
+          m_failed(m_stream == nullptr)
+    {
+        m_input_buffer.src = m_input.data();
+        m_input_buffer.size = 0;
+        m_input_buffer.pos = 0;
+    }
+
+    ~zstd_source()
+    {
+        ZSTD_freeDStream(m_stream);
+    }
+
+    size_t read(char* buffer, size_t size) override
+    {
+        if (m_failed)
+        {
+            return 0;
+        }
+
+        ZSTD_outBuffer output = { buffer, size, 0 };
+        while (output.pos < output.size)
+        {
+            if (m_input_buffer.pos == m_input_buffer.size)
+            {
+                const size_t read_size = m_source->read(m_input.data(), m_input.size());
+                if (read_size == 0)
+                {
+                    m_failed = m_source->failed() || m_in_frame;
+                    break;
+                }
+
+                m_input_buffer.size = read_size;
+                m_input_buffer.pos = 0;
+            }
+
+            // frames back to back are decoded one after the other, 0 is
+            // returned once one of them is done
+            const size_t ret = ZSTD_decompressStream(m_stream, &output, &m_input_buffer);
+            if (ZSTD_isError(ret))
+            {
+                m_failed = true;
+                break;
+            }
+
+            m_in_frame = (ret != 0);
+        }
+
+        return output.pos;
+    }
+
+    bool failed() const override
+    {
+        return m_failed;
+    }
+
+private:
+    std::unique_ptr<byte_source> m_source;
+    std::vector<char> m_input;
+    ZSTD_inBuffer m_input_buffer;
+    ZSTD_DStream* m_stream;
+    // the input so far ends inside a frame
+    bool m_in_frame;
+    bool m_failed;
+};
+
+#endif // CSV_HAVE_ZSTD
+
+#if defined(CSV_HAVE_LZ4)
+
+class lz4_source : public byte_source
+{
+public:
+    explicit lz4_source(std::unique_ptr<byte_source> source)
+        : m_source(std::move(source)),
+          m_input(input_buffer_size),
+          m_input_pos(0),
+          m_input_size(0),
+          m_context(nullptr),
+          m_in_frame(false),
+          m_failed(false)
+    {
+        m_failed = LZ4F_isError(LZ4F_createDecompressionContext(&m_context, LZ4F_VERSION)) != 0;
+    }
+
+    ~lz4_source()
+    {
+        LZ4F_freeDecompressionContext(m_context);
+    }
+
+    size_t read(char* buffer, size_t size) override
+    {
+        if (m_failed)
+        {
+            return 0;
+        }
+
+        size_t written = 0;
+        while (written < size)
+        {
+            if (m_input_pos == m_input_size)
+            {
+                m_input_size = m_source->read(m_input.data(), m_input.size());
+                m_input_pos = 0;
+                if (m_input_size == 0)
+                {
+                    m_failed = m_source->failed() || m_in_frame;
+                    break;
+                }
+            }
+
+            // the context starts over by itself once a frame is done
+            size_t output_size = size - written;
+            size_t input_size = m_input_size - m_input_pos;
+            const size_t ret = LZ4F_decompress(m_context, buffer + written, &output_size,
+                                               m_input.data() + m_input_pos, &input_size, nullptr);
+            if (LZ4F_isError(ret))
+            {
+                m_failed = true;
+                break;
+            }
+
+            // 0 once a frame is done
+            m_in_frame = (ret != 0);
+            written += output_size;
+            m_input_pos += input_size;
+        }
+
+        return written;
+    }
+
+    bool failed() const override
+    {
+        return m_failed;
+    }
+
+private:
+    std::unique_ptr<byte_source> m_source;
+    std::vector<char> m_input;
+    size_t m_input_pos;
+    size_t m_input_size;
+    LZ4F_dctx* m_context;
+    // the input so far ends inside a frame
+    bool m_in_frame;
+    bool m_failed;
+};
+
+#endif // CSV_HAVE_LZ4
+
+// compressed output buffered before being written to the underlying sink
+const size_t output_buffer_size = size_t(256) << 10;
+
+typedef bool (*compress_frame_fn)(const std::string& input, std::string& output, int level);
+
+#if defined(CSV_HAVE_ZLIB)
+
+int get_zlib_level(int level)
+{
+    return (level == 0) ? Z_DEFAULT_COMPRESSION : level;
+}
+
+class gzip_sink : public byte_sink
+{
+public:
+    gzip_sink(std::unique_ptr<byte_sink> sink, int level)
+        : m_sink(std::move(sink)),
+          m_output(output_buffer_size),
+          m_stream(),
+          m_failed(false)
+    {
+        m_failed = (deflateInit2(&m_stream, get_zlib_level(level), Z_DEFLATED, 16 + MAX_WBITS,
+                                 8, Z_DEFAULT_STRATEGY) != Z_OK);
+    }
+
+    ~gzip_sink()
+    {
+        close();
+    }
+
+    bool write(const char* data, size_t size) override
+    {
+        if (!m_sink)
+        {
+            return false;
+        }
+
+        while (!m_failed && (size > 0))
+        {
+            const size_t chunk_size = std::min<size_t>(size, UINT_MAX);
+            m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            m_stream.avail_in = static_cast<uInt>(chunk_size);
+            deflate_input(Z_NO_FLUSH);
+
+            data += chunk_size;
+            size -= chunk_size;
+        }
+
+        return !m_failed;
+    }
+
+    bool flush() override
+    {
+        if (!m_sink)
+        {
+            return false;
+        }
+
+        deflate_input(Z_SYNC_FLUSH);
+        return !m_failed && m_sink->flush();
+    }
+
+    bool close() override
+    {
+        if (!m_sink)
+        {
+            return !m_failed;
+        }
+
+        const bool initialized = !m_failed;
+        deflate_input(Z_FINISH);
+        if (initialized)
+        {
+            deflateEnd(&m_stream);
+        }
+
+        const bool closed = m_sink->close();
+        m_sink.reset();
+        return !m_failed && closed;
+    }
+
+private:
+    // compresses the pending input, writing the output as it fills up
+    void deflate_input(int flush)
+    {
+        if (m_failed)
+        {
+            return;
+        }
+
+        for (;;)
+        {
+            m_stream.next_out = reinterpret_cast<Bytef*>(m_output.data());
+            m_stream.avail_out = static_cast<uInt>(m_output.size());
+
+            const int ret = deflate(&m_stream, flush);
+            if ((ret == Z_STREAM_ERROR) ||
+                !m_sink->write(m_output.data(), m_output.size() - m_stream.avail_out))
+            {
+                m_failed = true;
+                return;
+            }
+
+            // deflate is done once it leaves room in the output
+            if ((m_stream.avail_out > 0) && (m_stream.avail_in == 0))
+            {
+                return;
+            }
+        }
+    }
+
+    std::unique_ptr<byte_sink> m_sink;
+    std::vector<char> m_output;
+    z_stream m_stream;
+    bool m_failed;
+};
+
+bool compress_gzip_frame(const std::string& input, std::string& output, int level)
+{
+    z_stream stream = {};
+    if (deflateInit2(&stream, get_zlib_level(level), Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    // a single deflate call for most frames; zlib counts bytes in uInt, so
+    // frames of 4 GiB and more go in and come out in pieces
+    output.resize(deflateBound(&stream, static_cast<uLong>(std::min<size_t>(input.size(), ULONG_MAX))));
+
+    const char* pending = input.data();
+    size_t pending_size = input.size();
+    size_t written = 0;
+
+    int ret = Z_OK;
+    while (ret == Z_OK)
+    {
+        if (stream.avail_in == 0)
+        {
+            const size_t chunk_size = std::min<size_t>(pending_size, UINT_MAX);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pending));
+            stream.avail_in = static_cast<uInt>(chunk_size);
+            pending += chunk_size;
+            pending_size -= chunk_size;
+        }
+
+        if (written == output.size())
+        {
+            output.resize(std::max<size_t>(2 * output.size(), 64 << 10));
+        }
+
+        const size_t room = std::min<size_t>(output.size() - written, UINT_MAX);
+        stream.next_out = reinterpret_cast<Bytef*>(&output[written]);
+        stream.avail_out = static_cast<uInt>(room);
+
+        ret = deflate(&stream, (pending_size == 0) ? Z_FINISH : Z_NO_FLUSH);
+        written += room - stream.avail_out;
+    }
+
+    output.resize(written);
+    deflateEnd(&stream);
+
+    return ret == Z_STREAM_END;
+}
+
+#endif // CSV_HAVE_ZLIB
+
+#if defined(CSV_HAVE_ZSTD)
+
+class zstd_sink : public byte_sink
+{
+public:
+    zstd_sink(std::unique_ptr<byte_sink> sink, int level)
+        : m_sink(std::move(sink)),
+          m_output(ZSTD_CStreamOutSize()),
+          m_stream(ZSTD_createCStream()),
+          m_failed(m_stream == nullptr)
+    {
+        // level 0 is zstd's default level
+        m_failed = m_failed || ZSTD_isError(ZSTD_initCStream(m_stream, level));
+    }
+
+    ~zstd_sink()
+    {
+        close();
+        ZSTD_freeCStream(m_stream);
+    }
+
+    bool write(const char* data, size_t size) override
+    {
+        if (!m_sink)
+        {
+            return false;
+        }
+
+        ZSTD_inBuffer input = { data, size, 0 };
+        while (!m_failed && (input.pos < input.size))
+        {
+            ZSTD_outBuffer output = { m_output.data(), m_output.size(), 0 };
+            if (ZSTD_isError(ZSTD_compressStream(m_stream, &output, &input)))
+            {
+                m_failed = true;
+                break;
+            }
+
+            m_failed = !m_sink->write(m_output.data(), output.pos);
+        }
+
+        return !m_failed;
+    }
+
+    bool flush() override
+    {
+        if (!m_sink)
+        {
+            return false;
+        }
+
+        end_stream(&ZSTD_flushStream);
+        return !m_failed && m_sink->flush();
+    }
+
+    bool close() override
+    {
+        if (!m_sink)
+        {
+            return !m_failed;
+        }
+
+        end_stream(&ZSTD_endStream);
+        const bool closed = m_sink->close();
+        m_sink.reset();
+        return !m_failed && closed;
+    }
+
+private:
+    // calls ZSTD_flushStream or ZSTD_endStream until they have nothing left
+    void end_stream(size_t (*end)(ZSTD_CStream*, ZSTD_outBuffer*))
+    {
+        for (size_t remaining = 1; !m_failed && (remaining != 0); )
+        {
+            ZSTD_outBuffer output = { m_output.data(), m_output.size(), 0 };
+            remaining = end(m_stream, &output);
+            m_failed = ZSTD_isError(remaining) || !m_sink->write(m_output.data(), output.pos);
+        }
+    }
+
+    std::unique_ptr<byte_sink> m_sink;
+    std::vector<char> m_output;
+    ZSTD_CStream* m_stream;
+    bool m_failed;
+};
+
+bool compress_zstd_frame(const std::string& input, std::string& output, int level)
+{
+    output.resize(ZSTD_compressBound(input.size()));
+    const size_t size = ZSTD_compress(&output[0], output.size(), input.data(), input.size(), level);
+    if (ZSTD_isError(size))
+    {
+        return false;
+    }
+
+    output.resize(size);
+    return true;
+}
+
+#endif // CSV_HAVE_ZSTD
+
+// Compresses frames of the output independently on worker threads, and
+// writes them in order from the writing thread.
+class parallel_sink : public byte_sink
+{
+public:
+    parallel_sink(std::unique_ptr<byte_sink> sink, compress_frame_fn compress, const compression_options& options)
+        : m_sink(std::move(sink)),
+          m_compress(compress),
+          m_level(options.level),
+          m_frame_size(std::max<size_t>(options.frame_size, 1)),
+          m_next_frame(0),
+          m_stop(false),
+          m_failed(false)
+    {
+        m_frame.reserve(m_frame_size);
+        for (size_t i = 0; i < options.num_threads; ++i)
+        {
+            m_threads.emplace_back(&parallel_sink::run, this);
+        }
+    }
+
+    ~parallel_sink()
+    {
+        close();
+    }
+
+    bool write(const char* data, size_t size) override
+    {
+        if (!m_sink)
+        {
+            return false;
+        }
+
+        while (size > 0)
+        {
+            const size_t chunk_size = std::min(size, m_frame_size - m_frame.size());
+            m_frame.append(data, chunk_size);
+            data += chunk_size;
+            size -= chunk_size;
+
+            if ((m_frame.size() == m_frame_size) && !submit_frame())
+            {
+                return false;
+            }
+        }
+
+        return !m_failed;
+    }
+
+    bool flush() override
+    {
+        return m_sink && submit_frame() && write_frames(0) && m_sink->flush();
+    }
+
+    bool close() override
+    {
+        if (!m_sink)
+        {
+            return !m_failed;
+        }
+
+        const bool flushed = submit_frame() && write_frames(0);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+        m_threads.clear();
+
+        const bool closed = m_sink->close();
+        m_sink.reset();
+        return flushed && closed;
+    }
+
+private:
+    struct frame
+    {
+        std::string input;
+        std::string output;
+        bool done = false;
+        bool compressed = false;
+    };
+
+    // hands the current frame over to the workers, and waits for the oldest
+    // ones when too many are in flight
+    bool submit_frame()
+    {
+        if (!m_frame.empty())
+        {
+            std::unique_ptr<frame> next(new frame());
+            next->input.swap(m_frame);
+            m_frame.reserve(m_frame_size);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_frames.push_back(std::move(next));
+            }
+
+            m_cond.notify_all();
+        }
+
+        return write_frames(2 * m_threads.size());
+    }
+
+    // writes the finished frames in order until at most max_pending are left
+    bool write_frames(size_t max_pending)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_frames.size() > max_pending)
+        {
+            m_done_cond.wait(lock, [this]() { return m_frames.front()->done; });
+
+            std::unique_ptr<frame> done = std::move(m_frames.front());
+            m_frames.pop_front();
+            --m_next_frame;
+            lock.unlock();
+
+            m_failed = m_failed || !done->compressed || !m_sink->write(done->output.data(), done->output.size());
+
+            lock.lock();
+        }
+
+        return !m_failed;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_cond.wait(lock, [this]() { return m_stop || (m_next_frame < m_frames.size()); });
+            if (m_next_frame >= m_frames.size())
+            {
+                return;
+            }
+
+            // frames stay put in the deque until they are written
+            frame& next = *m_frames[m_next_frame++];
+            lock.unlock();
+
+            const bool compressed = m_compress(next.input, next.output, m_level);
+            std::string().swap(next.input);
+
+            lock.lock();
+            next.compressed = compressed;
+            next.done = true;
+            m_done_cond.notify_all();
+        }
+    }
+
+    std::unique_ptr<byte_sink> m_sink;
+    compress_frame_fn m_compress;
+    int m_level;
+    size_t m_frame_size;
+    std::string m_frame;
+
+    // frames handed over but not written yet, oldest first; the workers
+    // take them from m_next_frame on
+    std::deque<std::unique_ptr<frame>> m_frames;
+    size_t m_next_frame;
+    bool m_stop;
+    bool m_failed;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::condition_variable m_done_cond;
+    std::vector<std::thread> m_threads;
+};
+
+bool starts_with(const char* data, size_t size, const unsigned char* magic, size_t magic_size)
+{
+    return (size >= magic_size) && (std::memcmp(data, magic, magic_size) == 0);
+}
+
+} // namespace
+
+compression detect_compression(const char* data, size_t size)
+{
+    static const unsigned char gzip_magic[] = { 0x1f, 0x8b };
+    static const unsigned char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+    static const unsigned char lz4_magic[] = { 0x04, 0x22, 0x4d, 0x18 };
+
+    if (starts_with(data, size, gzip_magic, sizeof(gzip_magic)))
+    {
+        return compression::gzip;
+    }
+
+    if (starts_with(data, size, zstd_magic, sizeof(zstd_magic)))
+    {
+        return compression::zstd;
+    }
+
+    if (starts_with(data, size, lz4_magic, sizeof(lz4_magic)))
+    {
+        return compression::lz4;
+    }
+
+    return compression::none;
+}
+
+compression detect_file_compression(const char* filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    char magic[4] = {};
+    file.read(magic, sizeof(magic));
+    return detect_compression(magic, static_cast<size_t>(file.gcount()));
+}
+
+bool is_supported(compression format)
+{
+    switch (format)
+    {
+    case compression::none:
+        return true;
+#if defined(CSV_HAVE_ZLIB)
+    case compression::gzip:
+        return true;
+#endif
+#if defined(CSV_HAVE_ZSTD)
+    case compression::zstd:
+        return true;
+#endif
+#if defined(CSV_HAVE_LZ4)
+    case compression::lz4:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::unique_ptr<byte_source> make_decompressor(std::unique_ptr<byte_source> source, compression format)
+{
+    switch (format)
+    {
+    case compression::none:
+        return source;
+#if defined(CSV_HAVE_ZLIB)
+    case compression::gzip:
+        return std::unique_ptr<byte_source>(new gzip_source(std::move(source)));
+#endif
+#if defined(CSV_HAVE_ZSTD)
+    case compression::zstd:
+        return std::unique_ptr<byte_source>(new zstd_source(std::move(source)));
+#endif
+#if defined(CSV_HAVE_LZ4)
+    case compression::lz4:
+        return std::unique_ptr<byte_source>(new lz4_source(std::move(source)));
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+bool can_compress(compression format)
+{
+    switch (format)
+    {
+    case compression::none:
+        return true;
+#if defined(CSV_HAVE_ZLIB)
+    case compression::gzip:
+        return true;
+#endif
+#if defined(CSV_HAVE_ZSTD)
+    case compression::zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::unique_ptr<byte_sink> make_compressor(std::unique_ptr<byte_sink> sink, compression format,
+                                           const compression_options& options)
+{
+    const bool parallel = (options.num_threads > 1);
+
+    switch (format)
+    {
+    case compression::none:
+        return sink;
+#if defined(CSV_HAVE_ZLIB)
+    case compression::gzip:
+        if (parallel)
+        {
+            // one gzip member per frame
+            return std::unique_ptr<byte_sink>(new parallel_sink(std::move(sink), &compress_gzip_frame, options));
+        }
+
+        return std::unique_ptr<byte_sink>(new gzip_sink(std::move(sink), options.level));
+#endif
+#if defined(CSV_HAVE_ZSTD)
+    case compression::zstd:
+        if (parallel)
+        {
+            return std::unique_ptr<byte_sink>(new parallel_sink(std::move(sink), &compress_zstd_frame, options));
+        }
+
+        return std::unique_ptr<byte_sink>(new zstd_sink(std::move(sink), options.level));
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+std::unique_ptr<byte_sink> open_file_sink(const char* filename, compression format,
+                                          const compression_options& options)
+{
+    if (!can_compress(format))
+    {
+        return nullptr;
+    }
+
+    // plain files are opened as text, like std::ofstream does by default
+    std::unique_ptr<file_sink> file(new file_sink());
+    const std::ios_base::openmode mode = (format == compression::none)
+        ? std::ios_base::out
+        : std::ios_base::out | std::ios_base::binary;
+    if (!file->open(filename, mode))
+    {
+        return nullptr;
+    }
+
+    return make_compressor(std::move(file), format, options);
+}
+
+std::unique_ptr<byte_source> open_file_source(const char* filename)
+{
+    const compression format = detect_file_compression(filename);
+    if (!is_supported(format))
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<file_source> file(new file_source());
+    if (!file->open(filename))
+    {
+        return nullptr;
+    }
+
+    return make_decompressor(std::move(file), format);
+}
+
+} // namespace csv
@@ -0,0 +1,327 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_convert.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+namespace csv
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// [sign] digits [. digits] [(e|E) [sign] digits], with the first 19
+// significant digits in mantissa and the rest only moving the exponent.
+struct decimal
+{
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool negative = false;
+    // digits were dropped from the mantissa
+    bool truncated = false;
+};
+
+const int max_mantissa_digits = 19;
+
+bool is_digit(char c)
+{
+    return static_cast<unsigned>(c) - '0' <= 9;
+}
+
+char to_lower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Whether [first, last) starts with word, ignoring case, which is skipped.
+bool skip_word(const char*& first, const char* last, const char* word)
+{
+    const char* pos = first;
+    for (; *word != '\0'; ++word, ++pos)
+    {
+        if ((pos == last) || (to_lower(*pos) != *word))
+        {
+            return false;
+        }
+    }
+
+    first = pos;
+    return true;
+}
+
+// Scans the number at the start of [first, last) and returns where it
+// ends, or nullptr when there are no digits.
+const char* scan_decimal(const char* first, const char* last, decimal& number)
+{
+    int num_digits = 0;
+    bool has_digits = false;
+
+    auto add_digit = [&](char c, bool fraction)
+    {
+        has_digits = true;
+        if ((num_digits == 0) && (c == '0'))
+        {
+            // leading zeros aren't significant
+            number.exponent -= fraction ? 1 : 0;
+            return;
+        }
+
+        if (num_digits < max_mantissa_digits)
+        {
+            number.mantissa = number.mantissa * 10 + static_cast<unsigned>(c - '0');
+            number.exponent -= fraction ? 1 : 0;
+            ++num_digits;
+        }
+        else
+        {
+            number.truncated = number.truncated || (c != '0');
+            number.exponent += fraction ? 0 : 1;
+        }
+    };
+
+    for (; (first != last) && is_digit(*first); ++first)
+    {
+        add_digit(*first, false);
+    }
+
+    if ((first != last) && (*first == '.'))
+    {
+        for (++first; (first != last) && is_digit(*first); ++first)
+        {
+            add_digit(*first, true);
+        }
+    }
+
+    if (!has_digits)
+    {
+        return nullptr;
+    }
+
+    // an exponent without digits isn't part of the number
+    if ((first != last) && ((*first == 'e') || (*first == 'E')))
+    {
+        const char* pos = first + 1;
+        const bool negative = (pos != last) && (*pos == '-');
+        if ((pos != last) && ((*pos == '-') || (*pos == '+')))
+        {
+            ++pos;
+        }
+
+        if ((pos != last) && is_digit(*pos))
+        {
+            int exponent = 0;
+            for (; (pos != last) && is_digit(*pos); ++pos)
+            {
+                // far past the range of every type, the value is 0 or
+                // infinite anyway
+                if (exponent < 100000)
+                {
+                    exponent = exponent * 10 + (*pos - '0');
+                }
+            }
+
+            number.exponent += negative ? -exponent : exponent;
+            first = pos;
+        }
+    }
+
+    return first;
+}
+
+// Exact when the mantissa and the power of ten are both exact in T, which
+// leaves a single rounding (Clinger's fast path).
+template <typename T>
+bool fast_path(const decimal& number, T& value)
+{
+    static const T powers[] = { T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7), T(1e8),
+                                T(1e9), T(1e10), T(1e11), T(1e12), T(1e13), T(1e14), T(1e15), T(1e16),
+                                T(1e17), T(1e18), T(1e19), T(1e20), T(1e21), T(1e22) };
+    // the largest power of ten that T holds exactly
+    const int max_exponent = std::numeric_limits<T>::digits > 24 ? 22 : 10;
+
+    if (number.truncated || (number.mantissa > (uint64_t(1) << std::numeric_limits<T>::digits)) ||
+        (number.exponent < -max_exponent) || (number.exponent > max_exponent))
+    {
+        return false;
+    }
+
+    const T mantissa = static_cast<T>(number.mantissa);
+    value = (number.exponent < 0) ? mantissa / powers[-number.exponent] : mantissa * powers[number.exponent];
+    return true;
+}
+
+bool fast_path(const decimal&, long double&)
+{
+    return false;
+}
+
+#ifdef _WIN32
+_locale_t get_c_locale()
+{
+    static const _locale_t locale = _create_locale(LC_NUMERIC, "C");
+    return locale;
+}
+
+void parse_in_c_locale(const char* str, float& value) { value = _strtof_l(str, nullptr, get_c_locale()); }
+void parse_in_c_locale(const char* str, double& value) { value = _strtod_l(str, nullptr, get_c_locale()); }
+void parse_in_c_locale(const char* str, long double& value) { value = _strtold_l(str, nullptr, get_c_locale()); }
+#else
+// The C library parses numbers with the decimal point of the program's
+// locale, the calling thread is switched to "C" for the call.
+class c_locale_scope
+{
+public:
+    c_locale_scope()
+        : m_previous(uselocale(get_c_locale()))
+    {
+    }
+
+    c_locale_scope(const c_locale_scope&) = delete;
+    c_locale_scope& operator=(const c_locale_scope&) = delete;
+
+    ~c_locale_scope()
+    {
+        uselocale(m_previous);
+    }
+
+private:
+    static locale_t get_c_locale()
+    {
+        static const locale_t locale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+        return locale;
+    }
+
+    locale_t m_previous;
+};
+
+void parse_in_c_locale(const char* str, float& value)
+{
+    c_locale_scope scope;
+    value = std::strtof(str, nullptr);
+}
+
+void parse_in_c_locale(const char* str, double& value)
+{
+    c_locale_scope scope;
+    value = std::strtod(str, nullptr);
+}
+
+void parse_in_c_locale(const char* str, long double& value)
+{
+    c_locale_scope scope;
+    value = std::strtold(str, nullptr);
+}
+#endif
+
+template <typename T>
+bool parse_floating_impl(const char* first, const char* last, T& value)
+{
+    decimal number;
+    number.negative = (first != last) && (*first == '-');
+    if ((first != last) && ((*first == '-') || (*first == '+')))
+    {
+        ++first;
+    }
+
+    const char* end = scan_decimal(first, last, number);
+    if (end == nullptr)
+    {
+        if (skip_word(first, last, "inf"))
+        {
+            value = number.negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+            return true;
+        }
+
+        if (skip_word(first, last, "nan"))
+        {
+            value = std::numeric_limits<T>::quiet_NaN();
+            return true;
+        }
+
+        return false;
+    }
+
+    T result;
+    if (number.mantissa == 0)
+    {
+        result = T(0);
+    }
+    else if (!fast_path(number, result))
+    {
+        // the rest are rounded by the C library, which needs a terminated
+        // string; fields are only terminated by a delimiter
+        char buffer[64];
+        const size_t length = static_cast<size_t>(end - first);
+        std::string long_buffer;
+        const char* str = buffer;
+        if (length < sizeof(buffer))
+        {
+            std::copy(first, end, buffer);
+            buffer[length] = '\0';
+        }
+        else
+        {
+            long_buffer.assign(first, end);
+            str = long_buffer.c_str();
+        }
+
+        parse_in_c_locale(str, result);
+    }
+
+    value = number.negative ? -result : result;
+    return true;
+}
+
+} // namespace
+
+bool parse_floating(const char* first, const char* last, float& value)
+{
+    return parse_floating_impl(first, last, value);
+}
+
+bool parse_floating(const char* first, const char* last, double& value)
+{
+    return parse_floating_impl(first, last, value);
+}
+
+bool parse_floating(const char* first, const char* last, long double& value)
+{
+    return parse_floating_impl(first, last, value);
+}
+
+} // namespace detail
+
+} // namespace csv
@@ -0,0 +1,184 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_dictionary.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace csv
+{
+
+namespace
+{
+
+// most values of low cardinality columns are short, so blocks hold many
+const size_t block_size = size_t(64) << 10;
+
+// empty values all point here, so no stored value has a null data pointer
+const char empty_value[1] = {};
+
+uint64_t hash_value(const field_view& value)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : value)
+    {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+} // namespace
+
+const uint32_t dictionary::npos;
+
+dictionary::dictionary()
+    : m_block_pos(nullptr),
+      m_block_left(0)
+{
+}
+
+void dictionary::clear()
+{
+    m_values.clear();
+    m_hashes.clear();
+    m_slots.clear();
+    m_blocks.clear();
+    m_block_pos = nullptr;
+    m_block_left = 0;
+}
+
+field_view dictionary::unescape(const field_view& field, std::string& scratch) const
+{
+    if (!field.quoted() || (std::memchr(field.data(), '"', field.size()) == nullptr))
+    {
+        return field_view(field.data(), field.size());
+    }
+
+    scratch.clear();
+    detail::append_field(scratch, field);
+    return field_view(scratch.data(), scratch.size());
+}
+
+uint32_t dictionary::find(const field_view& value, uint64_t hash, size_t& slot) const
+{
+    const size_t mask = m_slots.size() - 1;
+    for (slot = static_cast<size_t>(hash) & mask; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const uint32_t code = m_slots[slot] - 1;
+        const field_view& candidate = m_values[code];
+        if ((m_hashes[code] == hash) && (candidate.size() == value.size()) &&
+            (value.empty() || (std::memcmp(candidate.data(), value.data(), value.size()) == 0)))
+        {
+            return code;
+        }
+    }
+
+    return npos;
+}
+
+uint32_t dictionary::find(const field_view& field) const
+{
+    if (m_slots.empty())
+    {
+        return npos;
+    }
+
+    std::string scratch;
+    const field_view value = unescape(field, scratch);
+    size_t slot = 0;
+    return find(value, hash_value(value), slot);
+}
+
+uint32_t dictionary::intern(const field_view& field)
+{
+    if (2 * (m_values.size() + 1) > m_slots.size())
+    {
+        grow();
+    }
+
+    const field_view value = unescape(field, m_scratch);
+    const uint64_t hash = hash_value(value);
+    size_t slot = 0;
+    const uint32_t found = find(value, hash, slot);
+    if (found != npos)
+    {
+        return found;
+    }
+
+    const uint32_t code = static_cast<uint32_t>(m_values.size());
+    m_values.emplace_back(store(value), value.size());
+    m_hashes.push_back(hash);
+    m_slots[slot] = code + 1;
+    return code;
+}
+
+const char* dictionary::store(const field_view& value)
+{
+    if (value.empty())
+    {
+        return empty_value;
+    }
+
+    if (value.size() > m_block_left)
+    {
+        // long values get a block of their own, keeping the current one
+        if (value.size() > block_size / 4)
+        {
+            m_blocks.emplace_back(new char[value.size()]);
+            std::memcpy(m_blocks.back().get(), value.data(), value.size());
+            return m_blocks.back().get();
+        }
+
+        m_blocks.emplace_back(new char[block_size]);
+        m_block_pos = m_blocks.back().get();
+        m_block_left = block_size;
+    }
+
+    char* stored = m_block_pos;
+    std::memcpy(stored, value.data(), value.size());
+    m_block_pos += value.size();
+    m_block_left -= value.size();
+    return stored;
+}
+
+void dictionary::grow()
+{
+    m_slots.assign(std::max<size_t>(16, 2 * m_slots.size()), 0);
+
+    const size_t mask = m_slots.size() - 1;
+    for (size_t code = 0; code < m_values.size(); ++code)
+    {
+        size_t slot = static_cast<size_t>(m_hashes[code]) & mask;
+        while (m_slots[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        m_slots[slot] = static_cast<uint32_t>(code + 1);
+    }
+}
+
+} // namespace csv
@@ -0,0 +1,572 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_format.h"
+#include "csv_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include <locale.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+namespace csv
+{
+
+namespace detail
+{
+
+namespace
+{
+
+// Shortest digits with Grisu2 (Florian Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers"): the value and the
+// boundaries of the numbers that round to it are scaled by a cached power
+// of ten so that their digits can be generated with 64 bit integers.
+
+// f * 2^e
+struct diy_fp
+{
+    uint64_t f;
+    int e;
+};
+
+diy_fp subtract(diy_fp x, diy_fp y)
+{
+    return { x.f - y.f, x.e };
+}
+
+// the upper 64 bits of the product, rounded
+diy_fp multiply(diy_fp x, diy_fp y)
+{
+    const uint64_t x_lo = x.f & 0xFFFFFFFFu;
+    const uint64_t x_hi = x.f >> 32;
+    const uint64_t y_lo = y.f & 0xFFFFFFFFu;
+    const uint64_t y_hi = y.f >> 32;
+
+    const uint64_t lo_lo = x_lo * y_lo;
+    const uint64_t lo_hi = x_lo * y_hi;
+    const uint64_t hi_lo = x_hi * y_lo;
+    const uint64_t hi_hi = x_hi * y_hi;
+
+    uint64_t middle = (lo_lo >> 32) + (lo_hi & 0xFFFFFFFFu) + (hi_lo & 0xFFFFFFFFu);
+    middle += uint64_t(1) << 31;
+
+    return { hi_hi + (lo_hi >> 32) + (hi_lo >> 32) + (middle >> 32), x.e + y.e + 64 };
+}
+
+diy_fp normalize(diy_fp x)
+{
+    while ((x.f >> 63) == 0)
+    {
+        x.f <<= 1;
+        --x.e;
+    }
+
+    return x;
+}
+
+// the value and the bounds of the interval of numbers rounding to it,
+// normalized to the same exponent
+struct boundaries
+{
+    diy_fp value;
+    diy_fp lower;
+    diy_fp upper;
+};
+
+template <typename T, typename Bits>
+boundaries get_boundaries(T value)
+{
+    const int precision = std::numeric_limits<T>::digits;
+    const int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+    const uint64_t hidden_bit = uint64_t(1) << (precision - 1);
+
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint64_t exponent = uint64_t(bits) >> (precision - 1);
+    const uint64_t fraction = uint64_t(bits) & (hidden_bit - 1);
+
+    const diy_fp v = (exponent == 0)
+        ? diy_fp{ fraction, 1 - bias }
+        : diy_fp{ fraction + hidden_bit, static_cast<int>(exponent) - bias };
+
+    // at a power of two the number below is closer than the one above
+    const bool lower_is_closer = (fraction == 0) && (exponent > 1);
+    const diy_fp upper = normalize(diy_fp{ 2 * v.f + 1, v.e - 1 });
+    diy_fp lower = lower_is_closer ? diy_fp{ 4 * v.f - 1, v.e - 2 } : diy_fp{ 2 * v.f - 1, v.e - 1 };
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+
+    return { normalize(v), lower, upper };
+}
+
+struct cached_power
+{
+    uint64_t f;
+    int e;
+    int k;
+};
+
+// 10^k for k in [-300, 324] by steps of 8, normalized and rounded
+const cached_power cached_powers[] = {
+        { 0xAB70FE17C79AC6CAULL, -1060, -300 },
+        { 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+        { 0xBE5691EF416BD60CULL, -1007, -284 },
+        { 0x8DD01FAD907FFC3CULL, -980, -276 },
+        { 0xD3515C2831559A83ULL, -954, -268 },
+        { 0x9D71AC8FADA6C9B5ULL, -927, -260 },
+        { 0xEA9C227723EE8BCBULL, -901, -252 },
+        { 0xAECC49914078536DULL, -874, -244 },
+        { 0x823C12795DB6CE57ULL, -847, -236 },
+        { 0xC21094364DFB5637ULL, -821, -228 },
+        { 0x9096EA6F3848984FULL, -794, -220 },
+        { 0xD77485CB25823AC7ULL, -768, -212 },
+        { 0xA086CFCD97BF97F4ULL, -741, -204 },
+        { 0xEF340A98172AACE5ULL, -715, -196 },
+        { 0xB23867FB2A35B28EULL, -688, -188 },
+        { 0x84C8D4DFD2C63F3BULL, -661, -180 },
+        { 0xC5DD44271AD3CDBAULL, -635, -172 },
+        { 0x936B9FCEBB25C996ULL, -608, -164 },
+        { 0xDBAC6C247D62A584ULL, -582, -156 },
+        { 0xA3AB66580D5FDAF6ULL, -555, -148 },
+        { 0xF3E2F893DEC3F126ULL, -529, -140 },
+        { 0xB5B5ADA8AAFF80B8ULL, -502, -132 },
+        { 0x87625F056C7C4A8BULL, -475, -124 },
+        { 0xC9BCFF6034C13053ULL, -449, -116 },
+        { 0x964E858C91BA2655ULL, -422, -108 },
+        { 0xDFF9772470297EBDULL, -396, -100 },
+        { 0xA6DFBD9FB8E5B88FULL, -369, -92 },
+        { 0xF8A95FCF88747D94ULL, -343, -84 },
+        { 0xB94470938FA89BCFULL, -316, -76 },
+        { 0x8A08F0F8BF0F156BULL, -289, -68 },
+        { 0xCDB02555653131B6ULL, -263, -60 },
+        { 0x993FE2C6D07B7FACULL, -236, -52 },
+        { 0xE45C10C42A2B3B06ULL, -210, -44 },
+        { 0xAA242499697392D3ULL, -183, -36 },
+        { 0xFD87B5F28300CA0EULL, -157, -28 },
+        { 0xBCE5086492111AEBULL, -130, -20 },
+        { 0x8CBCCC096F5088CCULL, -103, -12 },
+        { 0xD1B71758E219652CULL, -77, -4 },
+        { 0x9C40000000000000ULL, -50, 4 },
+        { 0xE8D4A51000000000ULL, -24, 12 },
+        { 0xAD78EBC5AC620000ULL, 3, 20 },
+        { 0x813F3978F8940984ULL, 30, 28 },
+        { 0xC097CE7BC90715B3ULL, 56, 36 },
+        { 0x8F7E32CE7BEA5C70ULL, 83, 44 },
+        { 0xD5D238A4ABE98068ULL, 109, 52 },
+        { 0x9F4F2726179A2245ULL, 136, 60 },
+        { 0xED63A231D4C4FB27ULL, 162, 68 },
+        { 0xB0DE65388CC8ADA8ULL, 189, 76 },
+        { 0x83C7088E1AAB65DBULL, 216, 84 },
+        { 0xC45D1DF942711D9AULL, 242, 92 },
+        { 0x924D692CA61BE758ULL, 269, 100 },
+        { 0xDA01EE641A708DEAULL, 295, 108 },
+        { 0xA26DA3999AEF774AULL, 322, 116 },
+        { 0xF209787BB47D6B85ULL, 348, 124 },
+        { 0xB454E4A179DD1877ULL, 375, 132 },
+        { 0x865B86925B9BC5C2ULL, 402, 140 },
+        { 0xC83553C5C8965D3DULL, 428, 148 },
+        { 0x952AB45CFA97A0B3ULL, 455, 156 },
+        { 0xDE469FBD99A05FE3ULL, 481, 164 },
+        { 0xA59BC234DB398C25ULL, 508, 172 },
+        { 0xF6C69A72A3989F5CULL, 534, 180 },
+        { 0xB7DCBF5354E9BECEULL, 561, 188 },
+        { 0x88FCF317F22241E2ULL, 588, 196 },
+        { 0xCC20CE9BD35C78A5ULL, 614, 204 },
+        { 0x98165AF37B2153DFULL, 641, 212 },
+        { 0xE2A0B5DC971F303AULL, 667, 220 },
+        { 0xA8D9D1535CE3B396ULL, 694, 228 },
+        { 0xFB9B7CD9A4A7443CULL, 720, 236 },
+        { 0xBB764C4CA7A44410ULL, 747, 244 },
+        { 0x8BAB8EEFB6409C1AULL, 774, 252 },
+        { 0xD01FEF10A657842CULL, 800, 260 },
+        { 0x9B10A4E5E9913129ULL, 827, 268 },
+        { 0xE7109BFBA19C0C9DULL, 853, 276 },
+        { 0xAC2820D9623BF429ULL, 880, 284 },
+        { 0x80444B5E7AA7CF85ULL, 907, 292 },
+        { 0xBF21E44003ACDD2DULL, 933, 300 },
+        { 0x8E679C2F5E44FF8FULL, 960, 308 },
+        { 0xD433179D9C8CB841ULL, 986, 316 },
+        { 0x9E19DB92B4E31BA9ULL, 1013, 324 },
+};
+
+const int cached_powers_first_k = -300;
+const int cached_powers_step = 8;
+
+// the scaled upper bound gets an exponent in [-60, -32], so that its
+// integral part fits in 32 bits and ten times its fractional part in 64
+const int min_scaled_exponent = -60;
+
+// the cached power c such that -60 <= c.e + e + 64 <= -32
+const cached_power& get_cached_power(int e)
+{
+    // ceil((-60 - e - 1) * log10(2))
+    const int f = min_scaled_exponent - e - 1;
+    const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+    const int index = (k - cached_powers_first_k + cached_powers_step - 1) / cached_powers_step;
+    return cached_powers[index];
+}
+
+// the number of decimal digits of n, and 10 to that number minus one
+int count_digits(uint32_t n, uint32_t& power10)
+{
+    static const uint32_t powers[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+
+    int digits = 10;
+    while ((digits > 1) && (n < powers[digits - 1]))
+    {
+        --digits;
+    }
+
+    power10 = powers[digits - 1];
+    return digits;
+}
+
+// moves the last digit towards the value while that stays in the interval
+void round_last_digit(char* digits, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+    while ((rest < distance) && (delta - rest >= ten_k) &&
+           ((rest + ten_k < distance) || (distance - rest > rest + ten_k - distance)))
+    {
+        --digits[length - 1];
+        rest += ten_k;
+    }
+}
+
+// the digits of a number between lower and upper close to value; the
+// number is digits * 10^exponent
+int generate_digits(char* digits, int& exponent, diy_fp lower, diy_fp value, diy_fp upper)
+{
+    uint64_t delta = subtract(upper, lower).f;
+    uint64_t distance = subtract(upper, value).f;
+
+    const int shift = -upper.e;
+    const uint64_t one = uint64_t(1) << shift;
+
+    uint32_t integral = static_cast<uint32_t>(upper.f >> shift);
+    uint64_t fractional = upper.f & (one - 1);
+
+    int length = 0;
+    uint32_t power10 = 0;
+    for (int n = count_digits(integral, power10); n > 0; --n)
+    {
+        digits[length++] = static_cast<char>('0' + integral / power10);
+        integral %= power10;
+
+        const uint64_t rest = (uint64_t(integral) << shift) + fractional;
+        if (rest <= delta)
+        {
+            exponent += n - 1;
+            round_last_digit(digits, length, distance, delta, rest, uint64_t(power10) << shift);
+            return length;
+        }
+
+        power10 /= 10;
+    }
+
+    for (;;)
+    {
+        fractional *= 10;
+        delta *= 10;
+        distance *= 10;
+
+        digits[length++] = static_cast<char>('0' + (fractional >> shift));
+        fractional &= one - 1;
+        --exponent;
+
+        if (fractional <= delta)
+        {
+            round_last_digit(digits, length, distance, delta, fractional, one);
+            return length;
+        }
+    }
+}
+
+template <typename T, typename Bits>
+int grisu2(char* digits, int& exponent, T value)
+{
+    const boundaries bounds = get_boundaries<T, Bits>(value);
+    const cached_power& power = get_cached_power(bounds.upper.e);
+    const diy_fp scale = { power.f, power.e };
+
+    const diy_fp value_scaled = multiply(bounds.value, scale);
+    diy_fp lower = multiply(bounds.lower, scale);
+    diy_fp upper = multiply(bounds.upper, scale);
+
+    // the products are rounded, keep clear of the bounds
+    ++lower.f;
+    --upper.f;
+
+    exponent = -power.k;
+    return generate_digits(digits, exponent, lower, value_scaled, upper);
+}
+
+char* write_exponent(char* out, int exponent)
+{
+    *out++ = 'e';
+    *out++ = (exponent < 0) ? '-' : '+';
+
+    unsigned magnitude = static_cast<unsigned>((exponent < 0) ? -exponent : exponent);
+    if (magnitude >= 100)
+    {
+        *out++ = static_cast<char>('0' + magnitude / 100);
+        magnitude %= 100;
+    }
+
+    *out++ = static_cast<char>('0' + magnitude / 10);
+    *out++ = static_cast<char>('0' + magnitude % 10);
+    return out;
+}
+
+// Lays out digits * 10^exponent the way %g does at the given precision.
+char* write_digits(char* out, const char* digits, int length, int exponent, int precision)
+{
+    // the decimal point is after the point-th digit
+    const int point = length + exponent;
+
+    if ((point > -4) && (point <= std::max(precision, length)))
+    {
+        if (point <= 0)
+        {
+            // 0.000ddd
+            *out++ = '0';
+            *out++ = '.';
+            std::memset(out, '0', static_cast<size_t>(-point));
+            out += -point;
+            std::memcpy(out, digits, static_cast<size_t>(length));
+            return out + length;
+        }
+
+        if (point >= length)
+        {
+            // ddd000
+            std::memcpy(out, digits, static_cast<size_t>(length));
+            out += length;
+            std::memset(out, '0', static_cast<size_t>(point - length));
+            return out + (point - length);
+        }
+
+        // dd.ddd
+        std::memcpy(out, digits, static_cast<size_t>(point));
+        out += point;
+        *out++ = '.';
+        std::memcpy(out, digits + point, static_cast<size_t>(length - point));
+        return out + (length - point);
+    }
+
+    // d.ddde+xx
+    *out++ = digits[0];
+    if (length > 1)
+    {
+        *out++ = '.';
+        std::memcpy(out, digits + 1, static_cast<size_t>(length - 1));
+        out += length - 1;
+    }
+
+    return write_exponent(out, point - 1);
+}
+
+template <typename T, typename Bits>
+char* format_shortest_impl(char* out, T value)
+{
+    if (std::signbit(value))
+    {
+        *out++ = '-';
+        value = -value;
+    }
+
+    if (value == 0)
+    {
+        *out++ = '0';
+        return out;
+    }
+
+    char digits[std::numeric_limits<T>::max_digits10 + 1];
+    int exponent = 0;
+    const int length = grisu2<T, Bits>(digits, exponent, value);
+    return write_digits(out, digits, length, exponent, std::numeric_limits<T>::digits10);
+}
+
+#ifdef _WIN32
+_locale_t get_c_locale()
+{
+    static const _locale_t locale = _create_locale(LC_NUMERIC, "C");
+    return locale;
+}
+
+template <typename T>
+int print_float(char* buffer, size_t size, const char* format, int precision, T value)
+{
+    const int length = _scprintf_l(format, get_c_locale(), precision, value);
+    if ((length >= 0) && (static_cast<size_t>(length) < size))
+    {
+        _snprintf_l(buffer, size, format, get_c_locale(), precision, value);
+    }
+
+    return length;
+}
+#else
+// Thread's locale while printing, snprintf has no locale argument.
+class c_locale_scope
+{
+public:
+    c_locale_scope()
+        : m_previous(uselocale(get_c_locale()))
+    {
+    }
+
+    c_locale_scope(const c_locale_scope&) = delete;
+    c_locale_scope& operator=(const c_locale_scope&) = delete;
+
+    ~c_locale_scope()
+    {
+        uselocale(m_previous);
+    }
+
+private:
+    static locale_t get_c_locale()
+    {
+        static const locale_t locale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+        return locale;
+    }
+
+    locale_t m_previous;
+};
+
+template <typename T>
+int print_float(char* buffer, size_t size, const char* format, int precision, T value)
+{
+    c_locale_scope scope;
+    return std::snprintf(buffer, size, format, precision, value);
+}
+#endif
+
+const char* get_format(double, bool fixed)
+{
+    return fixed ? "%.*f" : "%.*g";
+}
+
+const char* get_format(long double, bool fixed)
+{
+    return fixed ? "%.*Lf" : "%.*Lg";
+}
+
+template <typename T>
+void format_fixed_impl(std::string& out, T value, int precision)
+{
+    char small_buffer[64];
+    const char* format = get_format(value, true);
+    const int length = print_float(small_buffer, sizeof(small_buffer), format, precision, value);
+    if (length < 0)
+    {
+        return;
+    }
+
+    if (static_cast<size_t>(length) < sizeof(small_buffer))
+    {
+        out.append(small_buffer, static_cast<size_t>(length));
+        return;
+    }
+
+    // large values in fixed notation don't fit the small buffer
+    std::string large_buffer(static_cast<size_t>(length) + 1, '\0');
+    print_float(&large_buffer[0], large_buffer.size(), format, precision, value);
+    out.append(large_buffer.data(), static_cast<size_t>(length));
+}
+
+template <typename T>
+void format_general_impl(std::string& out, T value)
+{
+    typedef typename std::conditional<std::is_same<T, float>::value, double, T>::type print_type;
+
+    // try the shortest precisions first, %g is exact at max_digits10
+    char buffer[64];
+    for (int digits = std::numeric_limits<T>::digits10; ; ++digits)
+    {
+        const int length = print_float(buffer, sizeof(buffer), get_format(print_type(), false), digits,
+                                       static_cast<print_type>(value));
+        if (length < 0)
+        {
+            return;
+        }
+
+        T parsed = T();
+        if ((digits >= std::numeric_limits<T>::max_digits10) || (value != value) ||
+            (parse_floating(buffer, buffer + length, parsed) && (parsed == value)))
+        {
+            out.append(buffer, static_cast<size_t>(length));
+            return;
+        }
+    }
+}
+
+} // namespace
+
+void format_fixed(std::string& out, double value, int precision)
+{
+    format_fixed_impl(out, value, precision);
+}
+
+void format_fixed(std::string& out, long double value, int precision)
+{
+    format_fixed_impl(out, value, precision);
+}
+
+void format_general(std::string& out, float value)
+{
+    format_general_impl(out, value);
+}
+
+void format_general(std::string& out, double value)
+{
+    format_general_impl(out, value);
+}
+
+void format_general(std::string& out, long double value)
+{
+    format_general_impl(out, value);
+}
+
+char* format_shortest(char* out, double value)
+{
+    return format_shortest_impl<double, uint64_t>(out, value);
+}
+
+char* format_shortest(char* out, float value)
+{
+    return format_shortest_impl<float, uint32_t>(out, value);
+}
+
+} // namespace detail
+
+} // namespace csv
@@ -0,0 +1,269 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_mapped_file.h"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace csv
+{
+
+namespace detail
+{
+
+mapped_file::mapped_file()
+    : m_data(nullptr),
+      m_size(0),
+      m_is_open(false),
+      m_borrowed(false)
+#ifdef _WIN32
+      , m_file(nullptr),
+      m_mapping(nullptr)
+#endif
+{
+}
+
+mapped_file::mapped_file(mapped_file&& other)
+    : mapped_file()
+{
+    swap(other);
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other)
+{
+    if (this != &other)
+    {
+        close();
+        swap(other);
+    }
+
+    return *this;
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+void mapped_file::open(const char* data, size_t size)
+{
+    close();
+
+    m_data = data;
+    m_size = size;
+    m_is_open = true;
+    m_borrowed = true;
+}
+
+void mapped_file::swap(mapped_file& other)
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_is_open, other.m_is_open);
+    std::swap(m_borrowed, other.m_borrowed);
+#ifdef _WIN32
+    std::swap(m_file, other.m_file);
+    std::swap(m_mapping, other.m_mapping);
+#endif
+}
+
+#ifdef _WIN32
+
+bool mapped_file::open(const char* filename)
+{
+    close();
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_size = static_cast<size_t>(file_size.QuadPart);
+    m_is_open = true;
+
+    // empty files cannot be mapped, but they are still valid (and empty) inputs
+    if (m_size == 0)
+    {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        close();
+        return false;
+    }
+    m_mapping = mapping;
+
+    m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void mapped_file::close()
+{
+    if ((m_data != nullptr) && !m_borrowed)
+    {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_is_open = false;
+    m_borrowed = false;
+    m_file = nullptr;
+    m_mapping = nullptr;
+}
+
+bool get_file_info(const char* filename, uint64_t& size, int64_t& mtime)
+{
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &info))
+    {
+        return false;
+    }
+
+    size = (uint64_t(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+
+    // FILETIME counts 100ns intervals since 1601
+    const uint64_t time = (uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+    mtime = (static_cast<int64_t>(time) - 116444736000000000LL) * 100;
+    return true;
+}
+
+#else
+
+bool mapped_file::open(const char* filename)
+{
+    close();
+
+    const int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_size = static_cast<size_t>(file_stat.st_size);
+
+    // empty files cannot be mapped, but they are still valid (and empty) inputs
+    if (m_size > 0)
+    {
+        void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+
+        ::madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(data);
+    }
+
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    m_is_open = true;
+    return true;
+}
+
+void mapped_file::close()
+{
+    if ((m_data != nullptr) && !m_borrowed)
+    {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    m_data = nullptr;
+    m_size = 0;
+    m_is_open = false;
+    m_borrowed = false;
+}
+
+bool get_file_info(const char* filename, uint64_t& size, int64_t& mtime)
+{
+    struct stat file_stat;
+    if (::stat(filename, &file_stat) != 0)
+    {
+        return false;
+    }
+
+    // whole seconds would miss a rewrite of the same size within a second
+#if defined(__APPLE__)
+    const struct timespec& time = file_stat.st_mtimespec;
+#else
+    const struct timespec& time = file_stat.st_mtim;
+#endif
+    size = static_cast<uint64_t>(file_stat.st_size);
+    mtime = static_cast<int64_t>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+    return true;
+}
+
+#endif
+
+} // namespace detail
+
+} // namespace csv
@@ -0,0 +1,377 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_parallel_reader.h"
+#include "csv_compression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace csv
+{
+
+namespace
+{
+
+// Runs fn(i) for every i in [0, num_items) on num_threads threads,
+// including the calling one. The first exception thrown by fn stops handing
+// out items and is rethrown once every thread is joined.
+template <typename Fn>
+void parallel_for(size_t num_threads, size_t num_items, Fn fn)
+{
+    std::atomic<size_t> next_item(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto fail = [&]()
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+        {
+            error = std::current_exception();
+        }
+
+        next_item = num_items;
+    };
+
+    auto worker = [&]()
+    {
+        try
+        {
+            for (size_t i = next_item++; i < num_items; i = next_item++)
+            {
+                fn(i);
+            }
+        }
+        catch (...)
+        {
+            fail();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try
+    {
+        for (size_t i = 1; i < num_threads; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+    }
+    catch (...)
+    {
+        fail();
+    }
+
+    worker();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace
+
+parallel_reader::parallel_reader()
+    : m_delimiter(','),
+      m_data_offset(0),
+      m_num_threads(0),
+      m_chunk_size(size_t(8) << 20)
+{
+}
+
+bool parallel_reader::open(const char* filename, char delimiter)
+{
+    m_delimiter = delimiter;
+    return m_mapping.open(filename) && read_header();
+}
+
+bool parallel_reader::open_buffer(const char* data, size_t size, char delimiter)
+{
+    m_delimiter = delimiter;
+    m_mapping.open(data, size);
+    return read_header();
+}
+
+bool parallel_reader::read_header()
+{
+    m_column_names.clear();
+    m_column_index.clear();
+
+    // chunks of a compressed file can't be parsed independently
+    if ((m_mapping.size() == 0) ||
+        (detect_compression(m_mapping.data(), m_mapping.size()) != compression::none))
+    {
+        m_mapping.close();
+        return false;
+    }
+
+    const char* begin = m_mapping.data();
+    const char* end = begin + m_mapping.size();
+
+    bool in_quotes = false;
+    const char* header_end = detail::find_record_end(begin, end, m_delimiter, in_quotes);
+
+    reader::row header;
+    header.parse_line(begin, header_end, m_delimiter);
+
+    m_column_names.resize(header.size());
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+        header.get(i, m_column_names[i]);
+    }
+
+    m_column_index.build(m_column_names);
+
+    m_data_offset = static_cast<size_t>(header_end - begin) + (header_end != end);
+    return true;
+}
+
+size_t parallel_reader::get_column_index(const char* name) const
+{
+    return m_column_index.find(m_column_names, name, std::strlen(name));
+}
+
+size_t parallel_reader::get_num_threads() const
+{
+    if (m_num_threads > 0)
+    {
+        return m_num_threads;
+    }
+
+    const size_t hardware_threads = std::thread::hardware_concurrency();
+    return (hardware_threads > 0) ? hardware_threads : 1;
+}
+
+std::vector<const char*> parallel_reader::find_chunk_starts(size_t num_threads) const
+{
+    const char* begin = m_mapping.data() + m_data_offset;
+    const char* end = m_mapping.data() + m_mapping.size();
+    const size_t data_size = static_cast<size_t>(end - begin);
+    const size_t num_chunks = std::max<size_t>(1, (data_size + m_chunk_size - 1) / m_chunk_size);
+
+    auto nominal_start = [&](size_t i)
+    {
+        return begin + std::min(i * m_chunk_size, data_size);
+    };
+
+    // whether a nominal start is inside a quoted field depends on all the
+    // bytes before it, so map how each chunk changes the field state first
+    std::vector<detail::field_state_map> maps(num_chunks);
+    parallel_for(num_threads, num_chunks, [&](size_t i)
+    {
+        maps[i] = detail::map_field_states(nominal_start(i), nominal_start(i + 1), m_delimiter);
+    });
+
+    std::vector<const char*> starts(num_chunks + 1);
+    starts[0] = begin;
+    starts[num_chunks] = end;
+
+    detail::field_state state = detail::field_state::field_start;
+    for (size_t i = 1; i < num_chunks; ++i)
+    {
+        state = maps[i - 1].states[static_cast<size_t>(state)];
+
+        // a chunk that already starts on a record boundary keeps its
+        // nominal start
+        const char* from = nominal_start(i);
+        const char* record_start = from;
+        if ((state != detail::field_state::field_start) || (from[-1] != '\n'))
+        {
+            detail::field_state from_state = state;
+            const char* record_end = detail::find_record_end(from, end, m_delimiter, from_state);
+            record_start = (record_end == end) ? end : record_end + 1;
+        }
+
+        starts[i] = std::max(starts[i - 1], record_start);
+    }
+
+    return starts;
+}
+
+void parallel_reader::parse_chunk(const char* begin, const char* end, chunk& rows) const
+{
+    const char* pos = begin;
+    while (pos < end)
+    {
+        // finding the end of the record and tokenizing it is a single scan;
+        // sized for the header's width, rows don't grow their offsets
+        rows.m_rows.emplace_back();
+        reader::row& row = rows.m_rows.back();
+        row.m_column_offsets.reserve(m_column_names.size() + 1);
+        const char* record_end = row.parse_record(pos, end, m_delimiter, size_t(-1));
+
+        pos = record_end + 1;
+    }
+}
+
+bool parallel_reader::run(const std::function<void(const chunk&)>& fn, order chunk_order)
+{
+    if (!is_open())
+    {
+        return false;
+    }
+
+    const size_t num_threads = get_num_threads();
+    const std::vector<const char*> starts = find_chunk_starts(num_threads);
+    const size_t num_chunks = starts.size() - 1;
+
+    if (chunk_order == order::unordered)
+    {
+        parallel_for(num_threads, num_chunks, [&](size_t i)
+        {
+            if (starts[i] < starts[i + 1])
+            {
+                chunk rows;
+                rows.m_index = i;
+                parse_chunk(starts[i], starts[i + 1], rows);
+                fn(rows);
+            }
+        });
+
+        return true;
+    }
+
+    // workers parse at most max_ahead chunks past the one being consumed,
+    // which bounds the memory held by parsed but unconsumed rows
+    const size_t max_ahead = 2 * num_threads;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::map<size_t, chunk> ready;
+    size_t next_claim = 0;
+    size_t next_consume = 0;
+
+    // set with the mutex held by whichever thread throws first; every
+    // waiting thread wakes up and stops, so all of them can be joined
+    std::exception_ptr error;
+    auto fail = [&]()
+    {
+        if (!error)
+        {
+            error = std::current_exception();
+        }
+
+        cond.notify_all();
+    };
+
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        try
+        {
+            for (;;)
+            {
+                cond.wait(lock, [&]() { return error || (next_claim >= num_chunks) || (next_claim < next_consume + max_ahead); });
+                if (error || (next_claim >= num_chunks))
+                {
+                    return;
+                }
+
+                const size_t i = next_claim++;
+                lock.unlock();
+
+                chunk rows;
+                rows.m_index = i;
+                parse_chunk(starts[i], starts[i + 1], rows);
+
+                lock.lock();
+                ready.emplace(i, std::move(rows));
+                cond.notify_all();
+            }
+        }
+        catch (...)
+        {
+            if (!lock.owns_lock())
+            {
+                lock.lock();
+            }
+
+            fail();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try
+    {
+        for (size_t i = 0; i < num_threads; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+
+        for (size_t i = 0; i < num_chunks; ++i)
+        {
+            chunk rows;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() { return error || (ready.count(i) != 0); });
+                if (error)
+                {
+                    break;
+                }
+
+                const auto it = ready.find(i);
+                rows = std::move(it->second);
+                ready.erase(it);
+
+                ++next_consume;
+                cond.notify_all();
+            }
+
+            if (rows.size() > 0)
+            {
+                fn(rows);
+            }
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fail();
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return true;
+}
+
+} // namespace csv
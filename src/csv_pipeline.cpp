@@ -0,0 +1,167 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "csv_pipeline.h"
+#include "csv_bounded_queue.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace csv
+{
+
+pipeline::pipeline()
+    : m_num_workers(0),
+      m_batch_size(4096),
+      m_queue_size(0)
+{
+}
+
+bool pipeline::run(reader& file, const std::function<void(const batch&)>& fn)
+{
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const size_t num_workers = get_num_workers();
+    const size_t queue_size = (m_queue_size > 0) ? m_queue_size : 2 * num_workers;
+
+    // every batch is either being filled, queued, processed or free, so
+    // filling one more has to wait for a free one
+    std::vector<batch> batches(queue_size + num_workers + 1);
+    detail::bounded_queue<batch*> free_batches(batches.size());
+    for (batch& rows : batches)
+    {
+        free_batches.push(&rows);
+    }
+
+    // a null batch tells a worker to stop
+    detail::bounded_queue<batch*> full_batches(queue_size + num_workers);
+
+    // the first exception thrown on any thread stops the reading; workers
+    // still return the batches they pop, so nothing waits on a free one
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto fail = [&]()
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+        {
+            error = std::current_exception();
+        }
+
+        failed = true;
+    };
+
+    auto worker = [&]()
+    {
+        for (batch* rows = full_batches.pop(); rows != nullptr; rows = full_batches.pop())
+        {
+            if (!failed)
+            {
+                try
+                {
+                    fn(*rows);
+                }
+                catch (...)
+                {
+                    fail();
+                }
+            }
+
+            free_batches.push(rows);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try
+    {
+        for (size_t i = 0; i < num_workers; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+
+        size_t index = 0;
+        size_t first_row = 0;
+        bool rows_left = true;
+        while (rows_left && !failed)
+        {
+            batch* rows = free_batches.pop();
+            rows->m_rows.clear();
+            while ((rows->m_rows.size() < m_batch_size) && (rows_left = file.next_row()))
+            {
+                rows->m_rows.push_back(file.get_row());
+            }
+
+            if (rows->m_rows.empty())
+            {
+                break;
+            }
+
+            rows->m_index = index++;
+            rows->m_first_row = first_row;
+            first_row += rows->m_rows.size();
+            full_batches.push(rows);
+        }
+    }
+    catch (...)
+    {
+        fail();
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        full_batches.push(nullptr);
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return true;
+}
+
+size_t pipeline::get_num_workers() const
+{
+    if (m_num_workers > 0)
+    {
+        return m_num_workers;
+    }
+
+    const unsigned hardware_threads = std::thread::hardware_concurrency();
+    return (hardware_threads > 0) ? hardware_threads : 1;
+}
+
+} // namespace csv
@@ -0,0 +1,189 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_predicate.h"
+#include "csv_convert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace csv
+{
+
+namespace
+{
+
+// The value of the field, unescaping "" only when there is one.
+field_view get_value(const field_view& field, std::string& scratch)
+{
+    if (!field.quoted() || (std::memchr(field.data(), '"', field.size()) == nullptr))
+    {
+        return field;
+    }
+
+    scratch.clear();
+    detail::append_field(scratch, field);
+    return field_view(scratch.data(), scratch.size());
+}
+
+// Like std::string::compare.
+int compare(const field_view& value, const std::string& text)
+{
+    const size_t size = std::min(value.size(), text.size());
+    const int order = (size > 0) ? std::memcmp(value.data(), text.data(), size) : 0;
+    if (order != 0)
+    {
+        return order;
+    }
+
+    return (value.size() < text.size()) ? -1 : (value.size() > text.size());
+}
+
+} // namespace
+
+predicate predicate::equals(std::string column, std::string value)
+{
+    node equals_node;
+    equals_node.kind = op::equals;
+    equals_node.column_name = std::move(column);
+    equals_node.low = std::move(value);
+    return leaf(std::move(equals_node));
+}
+
+predicate predicate::starts_with(std::string column, std::string prefix)
+{
+    node prefix_node;
+    prefix_node.kind = op::starts_with;
+    prefix_node.column_name = std::move(column);
+    prefix_node.low = std::move(prefix);
+    return leaf(std::move(prefix_node));
+}
+
+predicate predicate::between(std::string column, double low, double high)
+{
+    node range_node;
+    range_node.kind = op::number_range;
+    range_node.column_name = std::move(column);
+    range_node.low_number = low;
+    range_node.high_number = high;
+    return leaf(std::move(range_node));
+}
+
+predicate predicate::between(std::string column, std::string low, std::string high)
+{
+    node range_node;
+    range_node.kind = op::text_range;
+    range_node.column_name = std::move(column);
+    range_node.low = std::move(low);
+    range_node.high = std::move(high);
+    return leaf(std::move(range_node));
+}
+
+predicate operator&&(predicate lhs, predicate rhs)
+{
+    return predicate::combine(predicate::op::all_of, std::move(lhs), std::move(rhs));
+}
+
+predicate operator||(predicate lhs, predicate rhs)
+{
+    return predicate::combine(predicate::op::any_of, std::move(lhs), std::move(rhs));
+}
+
+predicate predicate::leaf(node value)
+{
+    predicate result;
+    result.m_nodes.push_back(std::move(value));
+    return result;
+}
+
+predicate predicate::combine(op kind, predicate lhs, predicate rhs)
+{
+    // an empty predicate matches everything, which decides || and is
+    // dropped by &&
+    if (lhs.empty() || rhs.empty())
+    {
+        if (kind == op::any_of)
+        {
+            return predicate();
+        }
+
+        return lhs.empty() ? rhs : lhs;
+    }
+
+    predicate result = std::move(lhs);
+    const size_t lhs_root = result.m_nodes.size() - 1;
+    const size_t offset = result.m_nodes.size();
+
+    for (node& operand : rhs.m_nodes)
+    {
+        if ((operand.kind == op::all_of) || (operand.kind == op::any_of))
+        {
+            operand.lhs += offset;
+            operand.rhs += offset;
+        }
+
+        result.m_nodes.push_back(std::move(operand));
+    }
+
+    node combined;
+    combined.kind = kind;
+    combined.lhs = lhs_root;
+    combined.rhs = result.m_nodes.size() - 1;
+    result.m_nodes.push_back(std::move(combined));
+
+    return result;
+}
+
+bool predicate::node::test(const field_view& field, std::string& scratch) const
+{
+    switch (kind)
+    {
+    case op::equals:
+        {
+            const field_view value = get_value(field, scratch);
+            return (value.size() == low.size()) &&
+                   (low.empty() || (std::memcmp(value.data(), low.data(), low.size()) == 0));
+        }
+    case op::starts_with:
+        {
+            const field_view value = get_value(field, scratch);
+            return (value.size() >= low.size()) &&
+                   (low.empty() || (std::memcmp(value.data(), low.data(), low.size()) == 0));
+        }
+    case op::number_range:
+        {
+            double number = 0;
+            return convert<double>::parse(field, number) && (number >= low_number) && (number <= high_number);
+        }
+    case op::text_range:
+        {
+            const field_view value = get_value(field, scratch);
+            return (compare(value, low) >= 0) && (compare(value, high) <= 0);
+        }
+    default:
+        return false;
+    }
+}
+
+} // namespace csv
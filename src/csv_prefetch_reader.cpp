@@ -0,0 +1,197 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_prefetch_reader.h"
+
+namespace csv
+{
+
+namespace detail
+{
+
+prefetch_reader::prefetch_reader()
+    : m_is_open(false),
+      m_sizes(),
+      m_filled(),
+      m_current(0),
+      m_holding(false),
+      m_stop(false),
+      m_failed(false)
+{
+}
+
+prefetch_reader::~prefetch_reader()
+{
+    close();
+}
+
+bool prefetch_reader::open(std::unique_ptr<byte_source> source, size_t block_size)
+{
+    close();
+
+    if (!source)
+    {
+        return false;
+    }
+
+    m_source = std::move(source);
+
+    for (size_t i = 0; i < num_buffers; ++i)
+    {
+        m_buffers[i].resize(block_size > 0 ? block_size : 1);
+        m_sizes[i] = 0;
+        m_filled[i] = false;
+    }
+
+    m_current = 0;
+    m_holding = false;
+    m_stop = false;
+    m_failed = false;
+    m_error = nullptr;
+    m_is_open = true;
+
+    m_thread = std::thread(&prefetch_reader::run, this);
+    return true;
+}
+
+void prefetch_reader::close()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_cond.notify_all();
+        m_thread.join();
+    }
+
+    m_source.reset();
+    m_is_open = false;
+}
+
+bool prefetch_reader::next_block(const char*& data, size_t& size)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_holding)
+    {
+        m_filled[m_current] = false;
+        m_current = (m_current + 1) % num_buffers;
+        m_holding = false;
+        m_cond.notify_all();
+    }
+
+    m_cond.wait(lock, [this]() { return m_filled[m_current]; });
+
+    // an empty block marks the end of the file and is never given back
+    if (m_sizes[m_current] == 0)
+    {
+        if (m_error)
+        {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+
+        return false;
+    }
+
+    m_holding = true;
+    data = m_buffers[m_current].data();
+    size = m_sizes[m_current];
+    return true;
+}
+
+bool prefetch_reader::failed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+void prefetch_reader::run()
+{
+    for (size_t i = 0; ; i = (i + 1) % num_buffers)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this, i]() { return m_stop || !m_filled[i]; });
+            if (m_stop)
+            {
+                return;
+            }
+        }
+
+        // the buffer is ours until it is marked as filled; sources like
+        // decoders can return less than asked, so fill it up
+        std::vector<char>& buffer = m_buffers[i];
+        size_t size = 0;
+        bool failed = false;
+        std::exception_ptr error;
+        try
+        {
+            while (size < buffer.size())
+            {
+                const size_t read_size = m_source->read(buffer.data() + size, buffer.size() - size);
+                if (read_size == 0)
+                {
+                    break;
+                }
+
+                size += read_size;
+            }
+
+            // a short block is followed by the empty one, which is enough to
+            // know whether the source failed
+            failed = (size < buffer.size()) && m_source->failed();
+        }
+        catch (...)
+        {
+            // user sources run here; what was read of the block is dropped
+            // and the exception goes to the consumer with the end
+            error = std::current_exception();
+            size = 0;
+            failed = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sizes[i] = size;
+            m_filled[i] = true;
+            m_failed = m_failed || failed;
+            m_error = error;
+        }
+
+        m_cond.notify_all();
+
+        if (size == 0)
+        {
+            return;
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace csv
@@ -22,93 +22,449 @@
  * SOFTWARE.
  */
 #include "csv_reader.h"
+#include "csv_compression.h"
+#include "csv_row_index.h"
+#include <cstring>
 #include <string>
+#include <thread>
 
 namespace csv
 {
 
-namespace detail
+namespace
 {
-    std::vector<std::streamoff> get_offsets(const std::string& line, char delimiter)
-    {
-        const size_t num_shards = std::count(line.begin(), line.end(), delimiter) + 1;
 
-        std::vector<std::streamoff> stream_offsets(num_shards);
-        std::string::size_type begin_idx = -1;
-        for (size_t i = 0; i < num_shards; ++i)
-        {
-            const std::string::size_type end_idx = line.find_first_of(delimiter, begin_idx + 1);
+// bytes asked for at a time in read_mode::follow, appends are usually small
+const size_t follow_read_size = size_t(64) << 10;
 
-            stream_offsets[i] = begin_idx + 1;
+} // namespace
 
-            begin_idx = end_idx;
-        }
+reader::row::row()
+    : m_data(m_line.data()),
+      m_size(0),
+      m_delimiter(','),
+      m_fields_end(0)
+{
+}
+
+reader::row::row(const row& other)
+{
+    assign(other);
+}
+
+reader::row::row(row&& other) noexcept
+{
+    assign(std::move(other));
+}
 
-        return stream_offsets;
+reader::row& reader::row::operator=(const row& other)
+{
+    if (this != &other)
+    {
+        assign(other);
     }
-} // namespace detail
 
-reader::row::row()
+    return *this;
+}
+
+reader::row& reader::row::operator=(row&& other) noexcept
 {
-    m_line_stream.imbue(std::locale{ "en_US.UTF8" });
+    if (this != &other)
+    {
+        assign(std::move(other));
+    }
+
+    return *this;
+}
+
+void reader::row::assign(const row& other)
+{
+    // borrowed bytes stay borrowed, owned bytes have to follow the copy
+    const bool owns_line = (other.m_data == other.m_line.data());
+
+    m_line = other.m_line;
+    m_data = owns_line ? m_line.data() : other.m_data;
+    m_size = other.m_size;
+    m_delimiter = other.m_delimiter;
+    m_fields_end = other.m_fields_end;
+
+    m_column_offsets = other.m_column_offsets;
+    CSV_STATS(m_stats = other.m_stats);
+}
+
+void reader::row::assign(row&& other) noexcept
+{
+    const bool owns_line = (other.m_data == other.m_line.data());
+
+    m_line = std::move(other.m_line);
+    m_data = owns_line ? m_line.data() : other.m_data;
+    m_size = other.m_size;
+    m_delimiter = other.m_delimiter;
+    m_fields_end = other.m_fields_end;
+
+    m_column_offsets = std::move(other.m_column_offsets);
+    CSV_STATS(m_stats = other.m_stats);
+
+    other.m_line.clear();
+    other.m_data = other.m_line.data();
+    other.m_size = 0;
+    other.m_fields_end = 0;
+    other.m_column_offsets.clear();
 }
 
 void reader::row::parse_line(std::string line, char delimiter)
 {
     m_line = std::move(line);
-    parse_line_impl(delimiter);
+    parse_owned_line(delimiter, size_t(-1));
 }
 
 bool reader::row::parse_line(std::ifstream& filestream, char delimiter)
 {
-    if (std::getline(filestream, m_line))
+    return read_record(filestream, delimiter, size_t(-1));
+}
+
+bool reader::row::read_record(std::ifstream& filestream, char delimiter, size_t max_fields)
+{
+    if (!read_line(filestream, m_line))
+    {
+        return false;
+    }
+
+    if (parse_owned_line(delimiter, max_fields))
     {
-        parse_line_impl(delimiter);
         return true;
     }
 
-    return false;
+    // a newline inside a quoted field doesn't end the record, so put it
+    // back along with the next lines; only the new lines are scanned for
+    // the end of the quoted field, the record is tokenized once complete
+    bool in_quotes = true;
+    std::string next_line;
+    while (in_quotes && read_line(filestream, next_line))
+    {
+        detail::find_record_end(next_line.data(), next_line.data() + next_line.size(), delimiter, in_quotes);
+        m_line += '\n';
+        m_line += next_line;
+    }
+
+    parse_owned_line(delimiter, max_fields);
+    return true;
 }
 
-void reader::row::parse_line_impl(char delimiter)
+bool reader::row::read_line(std::ifstream& filestream, std::string& line)
 {
-    m_column_offsets = detail::get_offsets(m_line, delimiter);
+    CSV_STATS(detail::stats_timer io_timer(m_stats.io_time));
+    if (!std::getline(filestream, line))
+    {
+        return false;
+    }
 
-    std::replace(m_line.begin(), m_line.end(), delimiter, '\n');
-    m_line_stream.clear();
-    m_line_stream.str(m_line);
+    CSV_STATS(m_stats.bytes_read += line.size() + 1);
+    return true;
+}
+
+void reader::row::parse_line(const char* begin, const char* end, char delimiter)
+{
+    m_data = begin;
+    m_size = static_cast<size_t>(end - begin);
+    parse_line_impl(delimiter, size_t(-1));
+}
+
+bool reader::row::parse_owned_line(char delimiter, size_t max_fields)
+{
+    m_data = m_line.data();
+    m_size = m_line.size();
+    return parse_line_impl(delimiter, max_fields);
+}
+
+bool reader::row::parse_line_impl(char delimiter, size_t max_fields)
+{
+    CSV_STATS(detail::stats_timer tokenize_timer(m_stats.tokenize_time));
+    m_delimiter = delimiter;
+
+    const detail::scan_result result =
+        detail::scan_fields(m_data, m_data + m_size, delimiter, max_fields, true, m_column_offsets);
+
+    m_fields_end = result.fields_end - m_data;
+    finish_parse();
+    return !result.in_quotes;
+}
+
+const char* reader::row::parse_record(const char* begin, const char* end, char delimiter, size_t max_fields)
+{
+    CSV_STATS(detail::stats_timer tokenize_timer(m_stats.tokenize_time));
+    m_delimiter = delimiter;
+
+    const detail::scan_result result =
+        detail::scan_fields(begin, end, delimiter, max_fields, true, m_column_offsets);
+
+    m_data = begin;
+    m_size = static_cast<size_t>(result.record_end - begin);
+    m_fields_end = result.fields_end - begin;
+    finish_parse();
+
+    return result.record_end;
+}
 
-    m_default_selected_cols.resize(m_column_offsets.size());
-    std::fill(m_default_selected_cols.begin(), m_default_selected_cols.end(), true);
+void reader::row::finish_parse()
+{
+    // fields are converted straight from the bytes, so a CR left over
+    // from a CRLF line ending would otherwise stick to the last field
+    if ((m_size > 0) && (m_data[m_size - 1] == '\r'))
+    {
+        --m_size;
+        m_fields_end = std::min(m_fields_end, static_cast<std::streamoff>(m_size));
+    }
+}
+
+void reader::row::tokenize(size_t num_fields) const
+{
+    // the scan only stops before the end of the row at a field limit
+    if ((m_fields_end >= static_cast<std::streamoff>(m_size)) || (m_column_offsets.size() >= num_fields))
+    {
+        return;
+    }
+
+    CSV_STATS(detail::stats_timer tokenize_timer(m_stats.tokenize_time));
+
+    // fields are usually accessed in order, growing the limit geometrically
+    // keeps rescanning the leading fields cheap
+    const size_t max_fields = std::max(num_fields, 2 * m_column_offsets.size());
+    const detail::scan_result result =
+        detail::scan_fields(m_data, m_data + m_size, m_delimiter, max_fields, false, m_column_offsets);
+
+    m_fields_end = result.fields_end - m_data;
+}
+
+field_view reader::row::get_field(size_t index) const
+{
+    const field_view raw = get_raw_field(index);
+    return detail::make_field(raw.begin(), raw.end());
+}
+
+field_view reader::row::get_raw_field(size_t index) const
+{
+    tokenize(index + 1);
+    assert(index < m_column_offsets.size());
+
+    const std::streamoff begin = m_column_offsets[index];
+    const std::streamoff end = (index + 1 < m_column_offsets.size())
+        ? m_column_offsets[index + 1] - 1
+        : m_fields_end;
+
+    return field_view(m_data + begin, static_cast<size_t>(end - begin));
 }
 
 reader::reader()
-    : m_delimiter(','),
-      m_selected_cols_num(0)
+    : m_mapping_pos(0),
+      m_block_pos(nullptr),
+      m_block_end(nullptr),
+      m_blocks_done(false),
+      m_block_size(size_t(1) << 20),
+      m_follow_pos(0),
+      m_follow_scan(0),
+      m_follow_state(detail::field_state::field_start),
+      m_follow_timeout(0),
+      m_poll_interval(50),
+      m_mode(read_mode::stream),
+      m_delimiter(','),
+      m_lazy(false),
+      m_selected_fields_end(0),
+      m_filter_fields_end(0),
+      m_stats_every(0)
+{
+}
+
+bool reader::open(const char* filename, char delimiter, read_mode mode)
 {
+    // compressed files can only be read front to back
+    if ((mode == read_mode::async) || (detect_file_compression(filename) != compression::none))
+    {
+        return open(open_file_source(filename), delimiter);
+    }
+
+    m_mode = mode;
+    m_delimiter = delimiter;
+
+    switch (m_mode)
+    {
+    case read_mode::mapped:
+        m_mapping.open(filename);
+        m_mapping_pos = 0;
+        break;
+    case read_mode::follow:
+        // the buffer is scanned for records, not split into lines
+        m_filestream.open(filename, std::ios::binary);
+        reset_follow();
+        break;
+    default:
+        m_filestream.open(filename);
+        m_filestream.imbue(std::locale{ "en_US.UTF8" });
+        break;
+    }
+
+    return is_open() && read_header() && select_cols(m_column_names);
 }
 
-bool reader::open(const char* filename, char delimiter)
+bool reader::open(const char* filename, const schema& layout, read_mode mode)
 {
-    m_filestream.open(filename);
-    m_filestream.imbue(std::locale{ "en_US.UTF8" });
+    if (!layout.has_header)
+    {
+        m_headerless_names = layout.column_names;
+    }
+
+    const bool opened = open(filename, layout.delimiter, mode);
+    m_headerless_names.clear();
+    return opened;
+}
 
+bool reader::open(std::unique_ptr<byte_source> source, char delimiter)
+{
+    m_mode = read_mode::async;
     m_delimiter = delimiter;
 
+    m_prefetch.reset(new detail::prefetch_reader());
+    m_prefetch->open(std::move(source), m_block_size);
+    m_block_pos = nullptr;
+    m_block_end = nullptr;
+    m_blocks_done = false;
+
     return is_open() && read_header() && select_cols(m_column_names);
 }
 
+bool reader::open_buffer(const char* data, size_t size, char delimiter)
+{
+    const compression format = detect_compression(data, size);
+    if (format != compression::none)
+    {
+        return open(make_decompressor(std::unique_ptr<byte_source>(new memory_source(data, size)), format), delimiter);
+    }
+
+    m_mode = read_mode::mapped;
+    m_delimiter = delimiter;
+    m_mapping.open(data, size);
+    m_mapping_pos = 0;
+
+    return is_open() && read_header() && select_cols(m_column_names);
+}
+
+bool reader::is_open() const
+{
+    switch (m_mode)
+    {
+    case read_mode::mapped:
+        return m_mapping.is_open();
+    case read_mode::async:
+        return m_prefetch && m_prefetch->is_open();
+    default:
+        return m_filestream.is_open();
+    }
+}
+
+bool reader::failed() const
+{
+    switch (m_mode)
+    {
+    case read_mode::mapped:
+        return false;
+    case read_mode::async:
+        return m_prefetch && m_prefetch->failed();
+    default:
+        return m_filestream.bad();
+    }
+}
+
 bool reader::next_row()
 {
-    return parse_next_line();
+    return parse_matching_row(m_lazy ? 1 : size_t(-1));
+}
+
+bool reader::next_row(size_t max_fields)
+{
+    return is_open() && !at_end() && parse_matching_row(max_fields);
+}
+
+reader_stats reader::get_stats() const
+{
+#if defined(CSV_HAVE_STATS)
+    return m_row.m_stats;
+#else
+    return reader_stats();
+#endif
+}
+
+void reader::set_stats_callback(size_t every_rows, reader_stats_callback callback)
+{
+    m_stats_every = callback ? every_rows : 0;
+    m_stats_callback = (m_stats_every > 0) ? std::move(callback) : reader_stats_callback();
+}
+
+bool reader::seek(const row_index& index, size_t row)
+{
+    if (!is_open() || (row >= index.get_num_rows()) || (index.get_delimiter() != m_delimiter))
+    {
+        return false;
+    }
+
+    const uint64_t offset = index.get_offset(row);
+    switch (m_mode)
+    {
+    case read_mode::mapped:
+        if (offset >= m_mapping.size())
+        {
+            return false;
+        }
+
+        m_mapping_pos = static_cast<size_t>(offset);
+        break;
+    case read_mode::stream:
+    case read_mode::follow:
+        m_filestream.clear();
+        if (!m_filestream.seekg(static_cast<std::streamoff>(offset)))
+        {
+            return false;
+        }
+
+        reset_follow();
+        break;
+    default:
+        // blocks are read ahead and possibly decompressed, there is no
+        // going back
+        return false;
+    }
+
+    return skip_rows(row % index.get_stride());
+}
+
+bool reader::skip_rows(size_t num_rows)
+{
+    if (m_mode == read_mode::mapped)
+    {
+        // only where the records end matters
+        const char* begin = m_mapping.data();
+        size_t skipped = 0;
+        const char* pos = detail::skip_records(begin + m_mapping_pos, begin + m_mapping.size(), m_delimiter, num_rows, skipped);
+
+        CSV_STATS(m_row.m_stats.bytes_read += static_cast<size_t>(pos - begin) - m_mapping_pos);
+        m_mapping_pos = static_cast<size_t>(pos - begin);
+        return true;
+    }
+
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        // only where the record ends matters
+        if (!parse_next_line(1))
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 size_t reader::get_column_index(const char* name) const
 {
-    const auto it = std::find(m_column_names.begin(), m_column_names.end(), name);
-    return (it == m_column_names.end())
-        ? size_t(-1)
-        : std::distance(m_column_names.begin(), it);
+    return m_column_index.find(m_column_names, name, std::strlen(name));
 }
 
 bool reader::select_cols(const std::vector<std::string>& selected_cols)
@@ -118,7 +474,7 @@ bool reader::select_cols(const std::vector<std::string>& selected_cols)
         return false;
     }
 
-    std::fill(m_selected_cols.begin(), m_selected_cols.end(), false);
+    m_selected_cols.reset_all();
 
     const bool cols_selected = std::all_of(
             selected_cols.begin(),
@@ -127,10 +483,10 @@ bool reader::select_cols(const std::vector<std::string>& selected_cols)
 
     if (!cols_selected)
     {
-        std::fill(m_selected_cols.begin(), m_selected_cols.end(), true);
+        m_selected_cols.set_all();
     }
 
-    m_selected_cols_num = std::accumulate(m_selected_cols.begin(), m_selected_cols.end(), size_t(0));
+    update_selection();
     return cols_selected;
 }
 
@@ -148,18 +504,18 @@ bool reader::select_cols(const std::vector<size_t>& selected_cols)
 
     if (indexes_in_range)
     {
-        std::fill(m_selected_cols.begin(), m_selected_cols.end(), false);
+        m_selected_cols.reset_all();
         for (auto idx : selected_cols)
         {
-            m_selected_cols[idx] = true;
+            m_selected_cols.set(idx);
         }
     }
 
-    m_selected_cols_num = std::accumulate(m_selected_cols.begin(), m_selected_cols.end(), size_t(0));
+    update_selection();
     return indexes_in_range;
 }
 
-bool reader::select_cols(std::vector<bool> selected_cols)
+bool reader::select_cols(const std::vector<bool>& selected_cols)
 {
     if (!is_open())
     {
@@ -171,36 +527,439 @@ bool reader::select_cols(std::vector<bool> selected_cols)
         return false;
     }
 
-    m_selected_cols = std::move(selected_cols);
-    m_selected_cols_num = std::accumulate(m_selected_cols.begin(), m_selected_cols.end(), size_t(0));
+    m_selected_cols.reset_all();
+    for (size_t idx = 0; idx < selected_cols.size(); ++idx)
+    {
+        if (selected_cols[idx])
+        {
+            m_selected_cols.set(idx);
+        }
+    }
+
+    update_selection();
     return true;
 }
 
+bool reader::select_cols(const column_set& selected_cols)
+{
+    if (!is_open())
+    {
+        return false;
+    }
+
+    if (selected_cols.size() != m_column_names.size())
+    {
+        return false;
+    }
+
+    m_selected_cols = selected_cols;
+    update_selection();
+    return true;
+}
+
+bool reader::set_filter(predicate filter)
+{
+    size_t fields_end = 0;
+    for (predicate::node& test : filter.m_nodes)
+    {
+        if ((test.kind == predicate::op::all_of) || (test.kind == predicate::op::any_of))
+        {
+            continue;
+        }
+
+        test.column = get_column_index(test.column_name);
+        if (test.column >= m_column_names.size())
+        {
+            return false;
+        }
+
+        fields_end = std::max(fields_end, test.column + 1);
+    }
+
+    m_filter = std::move(filter);
+    m_filter_fields_end = fields_end;
+    return true;
+}
+
+void reader::update_selection()
+{
+    m_selected_indexes.clear();
+    m_selected_cols.for_each([this](size_t idx) { m_selected_indexes.push_back(idx); });
+
+    m_selected_fields_end = m_selected_indexes.empty() ? 0 : m_selected_indexes.back() + 1;
+}
+
+size_t reader::fill_batch(size_t num_rows)
+{
+    m_batch_fields.clear();
+    m_batch_bytes.clear();
+
+    // mapped rows stay valid, streamed lines have to be kept aside
+    const bool mapped = (m_mode == read_mode::mapped);
+
+    size_t rows_read = 0;
+    while ((rows_read < num_rows) && !at_end() && parse_matching_row(m_selected_fields_end))
+    {
+        size_t line_offset = 0;
+        if (mapped)
+        {
+            line_offset = static_cast<size_t>(m_row.m_data - m_mapping.data());
+        }
+        else
+        {
+            line_offset = m_batch_bytes.size();
+            m_batch_bytes.append(m_row.m_data, m_row.m_size);
+        }
+
+        for (size_t col : m_selected_indexes)
+        {
+            // short rows get empty fields
+            if (col < m_row.m_column_offsets.size())
+            {
+                const field_view field = m_row.get_raw_field(col);
+                m_batch_fields.emplace_back(line_offset + (field.data() - m_row.m_data), field.size());
+            }
+            else
+            {
+                m_batch_fields.emplace_back(0, 0);
+            }
+        }
+
+        ++rows_read;
+    }
+
+    return rows_read;
+}
+
+const char* reader::get_batch_base() const
+{
+    return (m_mode == read_mode::mapped)
+        ? m_mapping.data()
+        : m_batch_bytes.data();
+}
+
 bool reader::read_header()
 {
-    std::string header;
-    if (std::getline(m_filestream, header))
+    CSV_STATS(m_row.m_stats = reader_stats());
+    m_filter = predicate();
+    m_filter_fields_end = 0;
+
+    if (!m_headerless_names.empty())
+    {
+        // the first row is data
+        m_column_names = m_headerless_names;
+    }
+    else if (parse_next_line())
     {
-        const auto num_cols = std::count(header.begin(), header.end(), m_delimiter) + 1;
-        m_column_names.resize(num_cols);
+        m_column_names.resize(m_row.size());
+        for (size_t i = 0; i < m_column_names.size(); ++i)
+        {
+            m_row.get(i, m_column_names[i]);
+        }
+    }
+    else
+    {
+        return false;
+    }
 
-        std::replace(header.begin(), header.end(), m_delimiter, '\n');
-        std::istringstream line_stream(header);
+    const size_t num_cols = m_column_names.size();
+    m_column_index.build(m_column_names);
 
-        for (size_t i = 0; line_stream >> m_column_names[i]; ++i) {}
+    m_selected_cols = column_set(num_cols, true);
+    update_selection();
 
-        m_selected_cols.resize(num_cols);
-        std::fill(m_selected_cols.begin(), m_selected_cols.end(), true);
-        m_selected_cols_num = m_selected_cols.size();
-        return true;
+    // size the row's storage for the expected width up front, so that
+    // steady state parsing doesn't allocate
+    m_row.m_column_offsets.reserve(num_cols + 1);
+    return true;
+}
+
+bool reader::parse_row(size_t max_fields)
+{
+    if (!parse_next_line(max_fields))
+    {
+        return false;
+    }
+
+    CSV_STATS(count_row());
+    return true;
+}
+
+bool reader::parse_matching_row(size_t max_fields)
+{
+    if (m_filter.empty())
+    {
+        return parse_row(max_fields);
+    }
+
+    // the rest of the fields are only tokenized once a row matches
+    while (parse_row(m_filter_fields_end))
+    {
+        if (matches(m_filter.m_nodes.size() - 1))
+        {
+            m_row.tokenize(max_fields);
+            return true;
+        }
     }
 
     return false;
 }
 
-bool reader::parse_next_line()
+bool reader::matches(size_t node) const
 {
-    return m_row.parse_line(m_filestream, m_delimiter);
+    const predicate::node& test = m_filter.m_nodes[node];
+    switch (test.kind)
+    {
+    case predicate::op::all_of:
+        return matches(test.lhs) && matches(test.rhs);
+    case predicate::op::any_of:
+        return matches(test.lhs) || matches(test.rhs);
+    default:
+        break;
+    }
+
+    m_row.tokenize(test.column + 1);
+    return (test.column < m_row.m_column_offsets.size()) &&
+           test.test(m_row.get_field(test.column), m_filter_scratch);
+}
+
+#if defined(CSV_HAVE_STATS)
+void reader::count_row()
+{
+    reader_stats& stats = m_row.m_stats;
+    ++stats.rows;
+    stats.fields += m_row.m_column_offsets.size();
+    stats.max_row_size = std::max(stats.max_row_size, m_row.m_size);
+
+    if ((m_stats_every > 0) && (stats.rows % m_stats_every == 0))
+    {
+        m_stats_callback(stats);
+    }
+}
+#endif
+
+bool reader::parse_next_line(size_t max_fields)
+{
+    switch (m_mode)
+    {
+    case read_mode::mapped:
+        return parse_mapped_line(max_fields);
+    case read_mode::async:
+        return parse_prefetched_line(max_fields);
+    case read_mode::follow:
+        return parse_followed_line(max_fields);
+    default:
+        return m_row.read_record(m_filestream, m_delimiter, max_fields);
+    }
+}
+
+bool reader::parse_mapped_line(size_t max_fields)
+{
+    if (m_mapping_pos >= m_mapping.size())
+    {
+        return false;
+    }
+
+    const char* begin = m_mapping.data() + m_mapping_pos;
+    const char* end = m_mapping.data() + m_mapping.size();
+    const char* record_end = m_row.parse_record(begin, end, m_delimiter, max_fields);
+
+    // skip the '\n' too, unless the file ended without one
+    const size_t consumed = static_cast<size_t>(record_end - begin) + (record_end != end);
+    CSV_STATS(m_row.m_stats.bytes_read += consumed);
+
+    m_mapping_pos += consumed;
+    return true;
+}
+
+bool reader::parse_prefetched_line(size_t max_fields)
+{
+    // blocks are recycled by the prefetch thread, so the line is copied
+    // into the row; lines can also span several blocks
+    std::string& line = m_row.m_line;
+
+    // most records are within the current block, tokenize them there so
+    // the record is only scanned once
+    if (m_block_pos != m_block_end)
+    {
+        const char* record_end = m_row.parse_record(m_block_pos, m_block_end, m_delimiter, max_fields);
+        if (record_end != m_block_end)
+        {
+            line.assign(m_row.m_data, m_row.m_size);
+            m_row.m_data = line.data();
+            m_block_pos = record_end + 1;
+            return true;
+        }
+    }
+
+    line.clear();
+
+    // blocks can end anywhere in a field, the state carries over
+    bool found_line = false;
+    detail::field_state state = detail::field_state::field_start;
+    while ((m_block_pos != m_block_end) || next_block())
+    {
+        found_line = true;
+
+        const char* newline = detail::find_record_end(m_block_pos, m_block_end, m_delimiter, state);
+        if (newline != m_block_end)
+        {
+            line.append(m_block_pos, newline);
+            m_block_pos = newline + 1;
+            m_row.parse_owned_line(m_delimiter, max_fields);
+            return true;
+        }
+
+        line.append(m_block_pos, m_block_end);
+        m_block_pos = m_block_end;
+    }
+
+    // the last line of the file has no '\n'
+    if (found_line)
+    {
+        m_row.parse_owned_line(m_delimiter, max_fields);
+    }
+
+    return found_line;
+}
+
+bool reader::parse_followed_line(size_t max_fields)
+{
+    const auto deadline = std::chrono::steady_clock::now() + m_follow_timeout;
+    for (;;)
+    {
+        const char* begin = m_follow_buffer.data() + m_follow_pos;
+        const char* scan = m_follow_buffer.data() + m_follow_scan;
+        const char* end = m_follow_buffer.data() + m_follow_buffer.size();
+
+        // most records are complete in the buffer, tokenize them there so
+        // the record is only scanned once
+        if ((scan == begin) && (begin != end))
+        {
+            const char* record_end = m_row.parse_record(begin, end, m_delimiter, max_fields);
+            if (record_end != end)
+            {
+                // the buffer moves as it is refilled, so the record is
+                // copied into the row as in read_mode::async
+                m_row.m_line.assign(m_row.m_data, m_row.m_size);
+                m_row.m_data = m_row.m_line.data();
+
+                CSV_STATS(m_row.m_stats.bytes_read += static_cast<size_t>(record_end + 1 - begin));
+                m_follow_pos += static_cast<size_t>(record_end + 1 - begin);
+                m_follow_scan = m_follow_pos;
+                return true;
+            }
+        }
+
+        // a partial record is only scanned for its end as it grows, and
+        // tokenized once it is found
+        if (scan != end)
+        {
+            const char* newline = detail::find_record_end(scan, end, m_delimiter, m_follow_state);
+            if (newline != end)
+            {
+                m_row.m_line.assign(begin, newline);
+                m_row.parse_owned_line(m_delimiter, max_fields);
+
+                CSV_STATS(m_row.m_stats.bytes_read += static_cast<size_t>(newline + 1 - begin));
+                m_follow_pos += static_cast<size_t>(newline + 1 - begin);
+                m_follow_scan = m_follow_pos;
+                return true;
+            }
+
+            m_follow_scan = m_follow_buffer.size();
+        }
+
+        if (read_appended())
+        {
+            continue;
+        }
+
+        // a partial record at the end of the file stays in the buffer
+        // until its newline is written
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(m_poll_interval, deadline - now));
+    }
+}
+
+bool reader::read_appended()
+{
+    CSV_STATS(detail::stats_timer io_timer(m_row.m_stats.io_time));
+
+    // the records read are dropped once they take as much room as the
+    // pending one, which keeps moving a long pending record cheap
+    if (m_follow_pos >= m_follow_buffer.size() - m_follow_pos)
+    {
+        m_follow_buffer.erase(0, m_follow_pos);
+        m_follow_scan -= m_follow_pos;
+        m_follow_pos = 0;
+    }
+
+    const size_t filled = m_follow_buffer.size();
+    m_follow_buffer.resize(filled + follow_read_size);
+    m_filestream.read(&m_follow_buffer[filled], static_cast<std::streamsize>(follow_read_size));
+    const size_t read = static_cast<size_t>(m_filestream.gcount());
+    m_follow_buffer.resize(filled + read);
+
+    // reading again at the end of the file gets what was appended since
+    if (m_filestream.eof())
+    {
+        m_filestream.clear();
+    }
+
+    return read > 0;
+}
+
+void reader::reset_follow()
+{
+    m_follow_buffer.clear();
+    m_follow_pos = 0;
+    m_follow_scan = 0;
+    m_follow_state = detail::field_state::field_start;
+}
+
+bool reader::next_block()
+{
+    if (m_blocks_done)
+    {
+        return false;
+    }
+
+    CSV_STATS(detail::stats_timer io_timer(m_row.m_stats.io_time));
+
+    size_t size = 0;
+    if (!m_prefetch->next_block(m_block_pos, size))
+    {
+        m_blocks_done = true;
+        m_block_pos = nullptr;
+        m_block_end = nullptr;
+        return false;
+    }
+
+    m_block_end = m_block_pos + size;
+    CSV_STATS(m_row.m_stats.bytes_read += size);
+    return true;
+}
+
+bool reader::at_end() const
+{
+    switch (m_mode)
+    {
+    case read_mode::mapped:
+        return m_mapping_pos >= m_mapping.size();
+    case read_mode::async:
+        return m_blocks_done;
+    case read_mode::follow:
+        // there can always be more
+        return false;
+    default:
+        return m_filestream.eof();
+    }
 }
 
 } // namespace csv
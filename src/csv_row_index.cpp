@@ -0,0 +1,218 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_row_index.h"
+#include "csv_mapped_file.h"
+#include "csv_scanner.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace csv
+{
+
+namespace
+{
+
+// the version is part of the magic, old sidecars are rebuilt
+const char index_magic[8] = { 'C', 'S', 'V', 'I', 'D', 'X', '0', '3' };
+
+template <typename T>
+void write_value(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool read_value(std::ifstream& file, T& value)
+{
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+// bytes left after the read position, to check the sizes read against
+uint64_t remaining_bytes(std::ifstream& file)
+{
+    const std::streampos pos = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streampos end = file.tellg();
+    file.seekg(pos);
+
+    return ((pos < 0) || (end < pos)) ? 0 : static_cast<uint64_t>(end - pos);
+}
+
+} // namespace
+
+row_index::row_index()
+    : m_file_size(0),
+      m_file_mtime(0),
+      m_stride(1),
+      m_delimiter(','),
+      m_num_rows(0)
+{
+}
+
+void row_index::clear()
+{
+    m_filename.clear();
+    m_file_size = 0;
+    m_file_mtime = 0;
+    m_stride = 1;
+    m_delimiter = ',';
+    m_num_rows = 0;
+    m_offsets.clear();
+}
+
+bool row_index::build(const char* filename, size_t stride, char delimiter)
+{
+    clear();
+
+    detail::mapped_file mapping;
+    if ((stride == 0) || !mapping.open(filename) ||
+        !detail::get_file_info(filename, m_file_size, m_file_mtime))
+    {
+        return false;
+    }
+
+    const char* begin = mapping.data();
+    const char* end = begin + mapping.size();
+
+    // the header isn't a row
+    bool in_quotes = false;
+    const char* header_end = detail::find_record_end(begin, end, delimiter, in_quotes);
+    const char* pos = (header_end == end) ? end : header_end + 1;
+
+    size_t num_rows = 0;
+    while (pos < end)
+    {
+        m_offsets.push_back(static_cast<uint64_t>(pos - begin));
+
+        size_t skipped = 0;
+        pos = detail::skip_records(pos, end, delimiter, stride, skipped);
+        num_rows += skipped;
+    }
+
+    m_filename = filename;
+    m_stride = stride;
+    m_delimiter = delimiter;
+    m_num_rows = num_rows;
+    return true;
+}
+
+bool row_index::save(const char* path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    // native byte order, indexes are a cache for the machine they are built on
+    file.write(index_magic, sizeof(index_magic));
+    write_value(file, m_file_size);
+    write_value(file, m_file_mtime);
+    write_value(file, static_cast<uint64_t>(m_stride));
+    write_value(file, m_delimiter);
+    write_value(file, static_cast<uint64_t>(m_num_rows));
+    write_value(file, static_cast<uint64_t>(m_offsets.size()));
+    file.write(reinterpret_cast<const char*>(m_offsets.data()),
+               static_cast<std::streamsize>(m_offsets.size() * sizeof(uint64_t)));
+    write_value(file, static_cast<uint32_t>(m_filename.size()));
+    file.write(m_filename.data(), static_cast<std::streamsize>(m_filename.size()));
+
+    return file.good();
+}
+
+bool row_index::load(const char* path)
+{
+    clear();
+
+    std::ifstream file(path, std::ios::binary);
+
+    char magic[sizeof(index_magic)];
+    uint64_t stride = 0;
+    char delimiter = 0;
+    uint64_t num_rows = 0;
+    uint64_t num_offsets = 0;
+    if (!file.read(magic, sizeof(magic)) || (std::memcmp(magic, index_magic, sizeof(magic)) != 0) ||
+        !read_value(file, m_file_size) || !read_value(file, m_file_mtime) ||
+        !read_value(file, stride) || !read_value(file, delimiter) || !read_value(file, num_rows) || !read_value(file, num_offsets) ||
+        (stride == 0) || (num_offsets != (num_rows + stride - 1) / stride) ||
+        (num_offsets > remaining_bytes(file) / sizeof(uint64_t)))
+    {
+        clear();
+        return false;
+    }
+
+    m_offsets.resize(static_cast<size_t>(num_offsets));
+    uint32_t filename_size = 0;
+    if (!file.read(reinterpret_cast<char*>(m_offsets.data()),
+                   static_cast<std::streamsize>(m_offsets.size() * sizeof(uint64_t))) ||
+        !read_value(file, filename_size) || (filename_size > remaining_bytes(file)))
+    {
+        clear();
+        return false;
+    }
+
+    m_filename.resize(filename_size);
+    if (!file.read(&m_filename[0], filename_size))
+    {
+        clear();
+        return false;
+    }
+
+    m_stride = static_cast<size_t>(stride);
+    m_delimiter = delimiter;
+    m_num_rows = static_cast<size_t>(num_rows);
+
+    // the file changed since the index was built
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+    if (!detail::get_file_info(m_filename.c_str(), file_size, file_mtime) ||
+        (file_size != m_file_size) || (file_mtime != m_file_mtime))
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool row_index::load_or_build(const char* filename, size_t stride, char delimiter)
+{
+    const std::string sidecar = get_sidecar_path(filename);
+    if (load(sidecar.c_str()) && (m_filename == filename) && (m_stride == stride) && (m_delimiter == delimiter))
+    {
+        return true;
+    }
+
+    if (!build(filename, stride, delimiter))
+    {
+        return false;
+    }
+
+    // an index that can't be saved still works for this process
+    save(sidecar.c_str());
+    return true;
+}
+
+} // namespace csv
@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_row_table.h"
+
+namespace csv
+{
+
+row_table::row_table()
+    : m_row_bytes(1, 0),
+      m_row_fields(1, 0)
+{
+}
+
+void row_table::reserve(size_t num_rows, size_t num_fields, size_t num_bytes)
+{
+    m_bytes.reserve(num_bytes);
+    m_field_offsets.reserve(num_fields + num_rows);
+    m_row_bytes.reserve(num_rows + 1);
+    m_row_fields.reserve(num_rows + 1);
+}
+
+void row_table::push_back(const reader::row& row)
+{
+    push_back_impl(row);
+}
+
+void row_table::push_back(const row_view& row)
+{
+    push_back_impl(row);
+}
+
+void row_table::clear()
+{
+    m_bytes.clear();
+    m_field_offsets.clear();
+    m_row_bytes.assign(1, 0);
+    m_row_fields.assign(1, 0);
+}
+
+size_t row_table::memory_usage() const
+{
+    return m_bytes.size() +
+           m_field_offsets.size() * sizeof(uint32_t) +
+           m_row_bytes.size() * sizeof(size_t) +
+           m_row_fields.size() * sizeof(size_t);
+}
+
+} // namespace csv
@@ -0,0 +1,614 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_scanner.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CSV_SCANNER_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define CSV_SCANNER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(CSV_SCANNER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CSV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CSV_TARGET_AVX2
+#endif
+
+namespace csv
+{
+
+namespace detail
+{
+
+namespace
+{
+
+void scan_block_scalar(const char* block, char delimiter, block_masks& masks)
+{
+    uint64_t delimiters = 0;
+    uint64_t newlines = 0;
+    uint64_t quotes = 0;
+    for (size_t i = 0; i < scan_block_size; ++i)
+    {
+        delimiters |= uint64_t(block[i] == delimiter) << i;
+        newlines |= uint64_t(block[i] == '\n') << i;
+        quotes |= uint64_t(block[i] == '"') << i;
+    }
+
+    masks.delimiters = delimiters;
+    masks.newlines = newlines;
+    masks.quotes = quotes;
+}
+
+#if defined(CSV_SCANNER_X86)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CSV_SCANNER_SSE2 1
+
+void scan_block_sse2(const char* block, char delimiter, block_masks& masks)
+{
+    const __m128i delimiter_vec = _mm_set1_epi8(delimiter);
+    const __m128i newline_vec = _mm_set1_epi8('\n');
+    const __m128i quote_vec = _mm_set1_epi8('"');
+
+    uint64_t delimiters = 0;
+    uint64_t newlines = 0;
+    uint64_t quotes = 0;
+    for (size_t i = 0; i < scan_block_size; i += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        const uint32_t d = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, delimiter_vec)));
+        const uint32_t n = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline_vec)));
+        const uint32_t q = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote_vec)));
+        delimiters |= uint64_t(d) << i;
+        newlines |= uint64_t(n) << i;
+        quotes |= uint64_t(q) << i;
+    }
+
+    masks.delimiters = delimiters;
+    masks.newlines = newlines;
+    masks.quotes = quotes;
+}
+#endif
+
+CSV_TARGET_AVX2
+void scan_block_avx2(const char* block, char delimiter, block_masks& masks)
+{
+    const __m256i delimiter_vec = _mm256_set1_epi8(delimiter);
+    const __m256i newline_vec = _mm256_set1_epi8('\n');
+    const __m256i quote_vec = _mm256_set1_epi8('"');
+
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+    const uint32_t d_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, delimiter_vec)));
+    const uint32_t d_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, delimiter_vec)));
+    const uint32_t n_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline_vec)));
+    const uint32_t n_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline_vec)));
+    const uint32_t q_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote_vec)));
+    const uint32_t q_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote_vec)));
+
+    masks.delimiters = uint64_t(d_lo) | (uint64_t(d_hi) << 32);
+    masks.newlines = uint64_t(n_lo) | (uint64_t(n_hi) << 32);
+    masks.quotes = uint64_t(q_lo) | (uint64_t(q_hi) << 32);
+}
+
+bool cpu_has_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    const bool os_saves_ymm = ((info[2] & (1 << 27)) != 0) && ((_xgetbv(0) & 0x6) == 0x6);
+
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && ((info[1] & (1 << 5)) != 0);
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+#endif // CSV_SCANNER_X86
+
+#if defined(CSV_SCANNER_NEON)
+
+// Packs the per byte comparison results of 64 bytes into a bit mask.
+uint64_t neon_movemask(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3)
+{
+    static const uint8_t bit_values[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t bits = vld1q_u8(bit_values);
+
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, bits), vandq_u8(m1, bits));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, bits), vandq_u8(m3, bits));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+void scan_block_neon(const char* block, char delimiter, block_masks& masks)
+{
+    const uint8x16_t delimiter_vec = vdupq_n_u8(static_cast<uint8_t>(delimiter));
+    const uint8x16_t newline_vec = vdupq_n_u8('\n');
+    const uint8x16_t quote_vec = vdupq_n_u8('"');
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(block);
+    const uint8x16_t b0 = vld1q_u8(bytes);
+    const uint8x16_t b1 = vld1q_u8(bytes + 16);
+    const uint8x16_t b2 = vld1q_u8(bytes + 32);
+    const uint8x16_t b3 = vld1q_u8(bytes + 48);
+
+    masks.delimiters = neon_movemask(vceqq_u8(b0, delimiter_vec), vceqq_u8(b1, delimiter_vec),
+                                     vceqq_u8(b2, delimiter_vec), vceqq_u8(b3, delimiter_vec));
+    masks.newlines = neon_movemask(vceqq_u8(b0, newline_vec), vceqq_u8(b1, newline_vec),
+                                   vceqq_u8(b2, newline_vec), vceqq_u8(b3, newline_vec));
+    masks.quotes = neon_movemask(vceqq_u8(b0, quote_vec), vceqq_u8(b1, quote_vec),
+                                 vceqq_u8(b2, quote_vec), vceqq_u8(b3, quote_vec));
+}
+
+#endif // CSV_SCANNER_NEON
+
+scan_block_fn get_implementation(simd_level level)
+{
+    switch (level)
+    {
+    case simd_level::scalar:
+        return &scan_block_scalar;
+#if defined(CSV_SCANNER_SSE2)
+    case simd_level::sse2:
+        return &scan_block_sse2;
+#endif
+#if defined(CSV_SCANNER_X86)
+    case simd_level::avx2:
+        return cpu_has_avx2() ? &scan_block_avx2 : nullptr;
+#endif
+#if defined(CSV_SCANNER_NEON)
+    case simd_level::neon:
+        return &scan_block_neon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+simd_level detect_simd_level()
+{
+    const simd_level candidates[] = { simd_level::avx2, simd_level::neon, simd_level::sse2 };
+    for (simd_level level : candidates)
+    {
+        if (get_implementation(level) != nullptr)
+        {
+            return level;
+        }
+    }
+
+    return simd_level::scalar;
+}
+
+struct scanner_state
+{
+    scanner_state()
+        : level(detect_simd_level()),
+          scan(get_implementation(level))
+    {
+    }
+
+    simd_level level;
+    scan_block_fn scan;
+};
+
+scanner_state& get_state()
+{
+    static scanner_state state;
+    return state;
+}
+
+// Tells which bytes of each block are inside quoted fields. A quote only
+// opens one as the first byte of a field, or right after the quote closing
+// one, which makes an escaped quote; other quotes are part of an unquoted
+// field. Blocks are given in order, the filter carries what the next block
+// needs to know about the end of the previous one.
+class quote_filter
+{
+public:
+    quote_filter()
+        : m_field_start(1),
+          m_reopen(0)
+    {
+    }
+
+    // The bits of the bytes inside quoted fields, opening quotes included.
+    // quote_state is all ones when the block starts inside a quoted field,
+    // separators the bits of the delimiters and newlines of the block.
+    uint64_t get_inside(uint64_t quotes, uint64_t separators, uint64_t quote_state)
+    {
+        const uint64_t field_starts = (separators << 1) | m_field_start;
+        m_field_start = separators >> 63;
+
+        // usually every quote opens or closes a quoted field, so counting
+        // all of them is right when every opening one may open a field
+        uint64_t inside = prefix_xor(quotes) ^ quote_state;
+        uint64_t closing = quotes & ~inside;
+        if ((quotes & inside & ~(field_starts | (closing << 1) | m_reopen)) != 0)
+        {
+            const uint64_t kept = keep_structural(quotes, field_starts, quote_state != 0);
+            inside = prefix_xor(kept) ^ quote_state;
+            closing = kept & ~inside;
+        }
+
+        m_reopen = closing >> 63;
+        return inside;
+    }
+
+    void skip(uint64_t separators)
+    {
+        m_field_start = separators >> 63;
+        m_reopen = 0;
+    }
+
+private:
+    // goes through the quotes in order, for blocks with quotes inside
+    // unquoted fields
+    uint64_t keep_structural(uint64_t quotes, uint64_t field_starts, bool inside) const
+    {
+        uint64_t reopen = m_reopen;
+        uint64_t kept = 0;
+        for (; quotes != 0; quotes &= quotes - 1)
+        {
+            const uint64_t quote = quotes & (uint64_t(0) - quotes);
+            if (inside)
+            {
+                kept |= quote;
+                reopen = quote << 1;
+                inside = false;
+            }
+            else if (((field_starts | reopen) & quote) != 0)
+            {
+                kept |= quote;
+                inside = true;
+            }
+        }
+
+        return kept;
+    }
+
+    // bit 0 set when the next block starts a field, or follows a closing
+    // quote
+    uint64_t m_field_start;
+    uint64_t m_reopen;
+};
+
+// The state after a quote.
+field_state after_quote(field_state state)
+{
+    switch (state)
+    {
+    case field_state::field_start:
+    case field_state::quote_closed:
+        return field_state::quoted;
+    case field_state::quoted:
+        return field_state::quote_closed;
+    default:
+        return field_state::unquoted;
+    }
+}
+
+// The state after a non empty run of bytes without quotes, of which only
+// the last one tells whether a field starts next.
+field_state after_run(field_state state, char last, char delimiter)
+{
+    if (state == field_state::quoted)
+    {
+        return state;
+    }
+
+    return ((last == delimiter) || (last == '\n')) ? field_state::field_start : field_state::unquoted;
+}
+
+} // namespace
+
+simd_level get_simd_level()
+{
+    return get_state().level;
+}
+
+bool set_simd_level(simd_level level)
+{
+    const scan_block_fn scan = get_implementation(level);
+    if (scan == nullptr)
+    {
+        return false;
+    }
+
+    scanner_state& state = get_state();
+    state.level = level;
+    state.scan = scan;
+    return true;
+}
+
+const char* get_simd_level_name(simd_level level)
+{
+    switch (level)
+    {
+    case simd_level::scalar:
+        return "scalar";
+    case simd_level::sse2:
+        return "sse2";
+    case simd_level::avx2:
+        return "avx2";
+    case simd_level::neon:
+        return "neon";
+    default:
+        return "unknown";
+    }
+}
+
+scan_block_fn get_scan_block()
+{
+    return get_state().scan;
+}
+
+scan_result scan_fields(const char* begin, const char* end, char delimiter,
+                        size_t max_fields, bool find_record_end,
+                        std::vector<std::streamoff>& offsets)
+{
+    const scan_block_fn scan = get_scan_block();
+
+    offsets.clear();
+    offsets.push_back(0);
+
+    // all ones while inside a quoted field at the start of the block
+    uint64_t quote_state = 0;
+    // set once max_fields fields are found
+    const char* fields_end = nullptr;
+    quote_filter quotes;
+
+    block_masks masks;
+    for (const char* block = begin; block < end; block += scan_block_size)
+    {
+        scan_block(scan, block, end, delimiter, masks);
+
+        uint64_t delimiters = masks.delimiters;
+        uint64_t newlines = masks.newlines;
+
+        // delimiters and newlines inside quotes are part of the field; most
+        // blocks of most files don't have any quotes
+        if ((masks.quotes | quote_state) != 0)
+        {
+            const uint64_t inside = quotes.get_inside(masks.quotes, masks.delimiters, quote_state);
+            delimiters &= ~inside;
+            newlines &= ~inside;
+            quote_state = uint64_t(0) - (inside >> 63);
+        }
+        else
+        {
+            quotes.skip(masks.delimiters);
+        }
+
+        // only delimiters before the end of the record count
+        if (newlines != 0)
+        {
+            const unsigned newline = trailing_zeros(newlines);
+            delimiters &= (uint64_t(1) << newline) - 1;
+        }
+
+        const std::streamoff block_offset = block - begin;
+        while ((delimiters != 0) && (fields_end == nullptr))
+        {
+            const std::streamoff delimiter_offset = block_offset + trailing_zeros(delimiters);
+            if (offsets.size() == max_fields)
+            {
+                // the remaining fields are not wanted, at most where the
+                // record ends, which the masks keep telling
+                fields_end = begin + delimiter_offset;
+                if (!find_record_end)
+                {
+                    return { end, fields_end, false };
+                }
+
+                break;
+            }
+
+            offsets.push_back(delimiter_offset + 1);
+            delimiters &= delimiters - 1;
+        }
+
+        if (newlines != 0)
+        {
+            const char* record_end = block + trailing_zeros(newlines);
+            return { record_end, (fields_end != nullptr) ? fields_end : record_end, false };
+        }
+    }
+
+    return { end, (fields_end != nullptr) ? fields_end : end, quote_state != 0 };
+}
+
+const char* find_record_end(const char* begin, const char* end, char delimiter, field_state& state)
+{
+    const char* pos = begin;
+    while (pos < end)
+    {
+        if (state != field_state::quoted)
+        {
+            const size_t remaining = static_cast<size_t>(end - pos);
+            const char* newline = static_cast<const char*>(std::memchr(pos, '\n', remaining));
+            const char* record_end = (newline != nullptr) ? newline : end;
+
+            // the common case: nothing is quoted before the newline
+            const char* quote = static_cast<const char*>(std::memchr(pos, '"', record_end - pos));
+            if (quote == nullptr)
+            {
+                if (newline != nullptr)
+                {
+                    state = field_state::field_start;
+                }
+                else if (pos < end)
+                {
+                    state = after_run(state, end[-1], delimiter);
+                }
+
+                return record_end;
+            }
+
+            if (pos < quote)
+            {
+                state = after_run(state, quote[-1], delimiter);
+            }
+
+            state = after_quote(state);
+            pos = quote + 1;
+        }
+        else
+        {
+            const char* quote = static_cast<const char*>(std::memchr(pos, '"', end - pos));
+            if (quote == nullptr)
+            {
+                return end;
+            }
+
+            // an escaped quote ("") closes and reopens the field
+            state = field_state::quote_closed;
+            pos = quote + 1;
+        }
+    }
+
+    return end;
+}
+
+field_state_map map_field_states(const char* begin, const char* end, char delimiter)
+{
+    field_state_map map;
+    for (size_t i = 0; i < num_field_states; ++i)
+    {
+        map.states[i] = static_cast<field_state>(i);
+    }
+
+    // between quotes, only the byte before the next one matters
+    const char* pos = begin;
+    while (pos < end)
+    {
+        const char* quote = static_cast<const char*>(std::memchr(pos, '"', end - pos));
+        const char* run_end = (quote != nullptr) ? quote : end;
+        for (field_state& state : map.states)
+        {
+            if (pos < run_end)
+            {
+                state = after_run(state, run_end[-1], delimiter);
+            }
+
+            if (quote != nullptr)
+            {
+                state = after_quote(state);
+            }
+        }
+
+        if (quote == nullptr)
+        {
+            break;
+        }
+
+        pos = quote + 1;
+    }
+
+    return map;
+}
+
+const char* skip_records(const char* begin, const char* end, char delimiter,
+                         size_t num_records, size_t& skipped)
+{
+    const scan_block_fn scan = get_scan_block();
+
+    skipped = 0;
+    if (num_records == 0)
+    {
+        return begin;
+    }
+
+    uint64_t quote_state = 0;
+    quote_filter quotes;
+    const char* last_record = begin;
+
+    block_masks masks;
+    for (const char* block = begin; block < end; block += scan_block_size)
+    {
+        // only newlines outside quotes end records, the delimiters tell
+        // where quotes can open a quoted field
+        scan_block(scan, block, end, delimiter, masks);
+
+        uint64_t newlines = masks.newlines;
+        const uint64_t separators = masks.delimiters | masks.newlines;
+        if ((masks.quotes | quote_state) != 0)
+        {
+            const uint64_t inside = quotes.get_inside(masks.quotes, separators, quote_state);
+            newlines &= ~inside;
+            quote_state = uint64_t(0) - (inside >> 63);
+        }
+        else
+        {
+            quotes.skip(separators);
+        }
+
+        if (newlines == 0)
+        {
+            continue;
+        }
+
+        const size_t count = popcount(newlines);
+        if (skipped + count >= num_records)
+        {
+            // the last record to skip ends in this block
+            for (size_t i = skipped + 1; i < num_records; ++i)
+            {
+                newlines &= newlines - 1;
+            }
+
+            skipped = num_records;
+            return block + trailing_zeros(newlines) + 1;
+        }
+
+        skipped += count;
+        last_record = block + (63 - leading_zeros(newlines)) + 1;
+    }
+
+    if (last_record < end)
+    {
+        ++skipped;
+    }
+
+    return end;
+}
+
+} // namespace detail
+
+} // namespace csv
@@ -0,0 +1,538 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "csv_schema.h"
+#include "csv_compression.h"
+#include "csv_convert.h"
+#include "csv_field_view.h"
+#include "csv_row_index.h"
+#include "csv_scanner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+
+namespace csv
+{
+
+namespace
+{
+
+struct record
+{
+    const char* begin;
+    const char* end;
+};
+
+// Sampled bytes starting at a record boundary. Unless complete, the last
+// record was cut by the sample.
+struct sample_block
+{
+    const char* begin;
+    const char* end;
+    bool complete;
+};
+
+// Reads up to size bytes; complete tells whether that is all there is.
+std::string read_sample(byte_source& source, size_t size, bool& complete)
+{
+    std::string sample(size, '\0');
+    size_t filled = 0;
+    while (filled < size)
+    {
+        const size_t read = source.read(&sample[filled], size - filled);
+        if (read == 0)
+        {
+            break;
+        }
+
+        filled += read;
+    }
+
+    sample.resize(filled);
+
+    char extra = 0;
+    complete = (filled < size) || (source.read(&extra, 1) == 0);
+    return sample;
+}
+
+// The non empty records of the blocks, whose cut last records are left
+// out. The delimiter tells where quoted fields can start.
+void split_records(const std::vector<sample_block>& blocks, char delimiter, std::vector<record>& records)
+{
+    records.clear();
+    for (const sample_block& block : blocks)
+    {
+        const char* pos = block.begin;
+        while (pos < block.end)
+        {
+            bool in_quotes = false;
+            const char* record_end = detail::find_record_end(pos, block.end, delimiter, in_quotes);
+            if ((record_end == block.end) && !block.complete)
+            {
+                break;
+            }
+
+            const char* last = record_end;
+            if ((last > pos) && (last[-1] == '\r'))
+            {
+                --last;
+            }
+
+            if (last > pos)
+            {
+                records.push_back({ pos, last });
+            }
+
+            pos = (record_end == block.end) ? block.end : record_end + 1;
+        }
+    }
+}
+
+field_view get_field(const record& row, const std::vector<std::streamoff>& offsets, size_t index)
+{
+    const char* begin = row.begin + offsets[index];
+    const char* end = (index + 1 < offsets.size()) ? row.begin + offsets[index + 1] - 1 : row.end;
+    return detail::make_field(begin, end);
+}
+
+// the most consistent number of fields wins, then the largest
+char find_delimiter(const std::vector<sample_block>& blocks, const std::string& candidates)
+{
+    char best = ',';
+    size_t best_matching = 0;
+    size_t best_fields = 1;
+
+    std::vector<record> records;
+    std::vector<std::streamoff> offsets;
+    for (char candidate : candidates)
+    {
+        split_records(blocks, candidate, records);
+
+        std::map<size_t, size_t> counts;
+        for (const record& row : records)
+        {
+            detail::scan_fields(row.begin, row.end, candidate, size_t(-1), false, offsets);
+            ++counts[offsets.size()];
+        }
+
+        size_t fields = 0;
+        size_t matching = 0;
+        for (const auto& count : counts)
+        {
+            if (count.second >= matching)
+            {
+                fields = count.first;
+                matching = count.second;
+            }
+        }
+
+        if ((fields > 1) && ((matching > best_matching) || ((matching == best_matching) && (fields > best_fields))))
+        {
+            best = candidate;
+            best_matching = matching;
+            best_fields = fields;
+        }
+    }
+
+    return best;
+}
+
+bool is_digit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+const char* skip_digits(const char* first, const char* last)
+{
+    while ((first != last) && is_digit(*first))
+    {
+        ++first;
+    }
+
+    return first;
+}
+
+// Reads a two digit number in [min_value, max_value] at first.
+bool parse_two_digits(const char*& first, const char* last, int min_value, int max_value)
+{
+    if ((last - first < 2) || !is_digit(first[0]) || !is_digit(first[1]))
+    {
+        return false;
+    }
+
+    const int value = (first[0] - '0') * 10 + (first[1] - '0');
+    first += 2;
+    return (value >= min_value) && (value <= max_value);
+}
+
+bool is_integer(const char* first, const char* last)
+{
+    const char* digits = ((first != last) && ((*first == '-') || (*first == '+'))) ? first + 1 : first;
+    if ((digits == last) || (skip_digits(digits, last) != last))
+    {
+        return false;
+    }
+
+    // too large for a long long is still a number
+    long long value = 0;
+    return detail::parse_integer(field_view(first, static_cast<size_t>(last - first)), value, std::true_type());
+}
+
+bool is_real(const char* first, const char* last)
+{
+    if ((first != last) && ((*first == '-') || (*first == '+')))
+    {
+        ++first;
+    }
+
+    const char* integer_end = skip_digits(first, last);
+    bool has_digits = (integer_end != first);
+    first = integer_end;
+
+    if ((first != last) && (*first == '.'))
+    {
+        const char* fraction_end = skip_digits(first + 1, last);
+        has_digits = has_digits || (fraction_end != first + 1);
+        first = fraction_end;
+    }
+
+    if (!has_digits)
+    {
+        return false;
+    }
+
+    if ((first != last) && ((*first == 'e') || (*first == 'E')))
+    {
+        ++first;
+        if ((first != last) && ((*first == '-') || (*first == '+')))
+        {
+            ++first;
+        }
+
+        const char* exponent_end = skip_digits(first, last);
+        if (exponent_end == first)
+        {
+            return false;
+        }
+
+        first = exponent_end;
+    }
+
+    return first == last;
+}
+
+// YYYY-MM-DD, then optionally [T ]HH:MM[:SS[.fraction]] and a Z or +HH:MM
+// time zone
+bool is_date(const char* first, const char* last)
+{
+    if ((last - first < 10) || (skip_digits(first, first + 4) != first + 4) || (first[4] != '-') || (first[7] != '-'))
+    {
+        return false;
+    }
+
+    const char* pos = first + 5;
+    if (!parse_two_digits(pos, last, 1, 12) || !parse_two_digits(++pos, last, 1, 31))
+    {
+        return false;
+    }
+
+    if (pos == last)
+    {
+        return true;
+    }
+
+    if (((*pos != 'T') && (*pos != ' ')) || !parse_two_digits(++pos, last, 0, 23) ||
+        (pos == last) || (*pos != ':') || !parse_two_digits(++pos, last, 0, 59))
+    {
+        return false;
+    }
+
+    if ((pos != last) && (*pos == ':'))
+    {
+        if (!parse_two_digits(++pos, last, 0, 60))
+        {
+            return false;
+        }
+
+        if ((pos != last) && (*pos == '.'))
+        {
+            const char* fraction_end = skip_digits(pos + 1, last);
+            if (fraction_end == pos + 1)
+            {
+                return false;
+            }
+
+            pos = fraction_end;
+        }
+    }
+
+    if ((pos != last) && (*pos == 'Z'))
+    {
+        ++pos;
+    }
+    else if ((pos != last) && ((*pos == '+') || (*pos == '-')))
+    {
+        if (!parse_two_digits(++pos, last, 0, 23))
+        {
+            return false;
+        }
+
+        if ((pos != last) && (*pos == ':'))
+        {
+            ++pos;
+        }
+
+        if (!parse_two_digits(pos, last, 0, 59))
+        {
+            return false;
+        }
+    }
+
+    return pos == last;
+}
+
+column_type merge(column_type lhs, column_type rhs)
+{
+    if (lhs == rhs)
+    {
+        return lhs;
+    }
+
+    const bool numbers = ((lhs == column_type::integer) || (lhs == column_type::real)) &&
+                         ((rhs == column_type::integer) || (rhs == column_type::real));
+    return numbers ? column_type::real : column_type::text;
+}
+
+bool infer_schema(const std::vector<sample_block>& blocks, const sniff_options& options, schema& result)
+{
+    const char delimiter = find_delimiter(blocks, options.delimiters);
+
+    std::vector<record> records;
+    split_records(blocks, delimiter, records);
+    if (records.empty())
+    {
+        return false;
+    }
+
+    result = schema();
+    result.delimiter = delimiter;
+
+    // the first row tells how many columns there are
+    std::vector<std::streamoff> offsets;
+    detail::scan_fields(records[0].begin, records[0].end, result.delimiter, size_t(-1), false, offsets);
+    const size_t num_columns = offsets.size();
+
+    std::vector<field_view> first_row(num_columns);
+    std::vector<column_type> first_types(num_columns, column_type::text);
+    std::vector<bool> first_typed(num_columns, false);
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        first_row[i] = get_field(records[0], offsets, i);
+        first_typed[i] = classify(first_row[i], first_types[i]);
+    }
+
+    std::vector<column_type> types(num_columns, column_type::text);
+    std::vector<bool> typed(num_columns, false);
+    for (size_t r = 1; r < records.size(); ++r)
+    {
+        detail::scan_fields(records[r].begin, records[r].end, result.delimiter, num_columns, false, offsets);
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            column_type type;
+            if (classify(get_field(records[r], offsets, i), type))
+            {
+                types[i] = typed[i] ? merge(types[i], type) : type;
+                typed[i] = true;
+            }
+        }
+    }
+
+    // text columns say nothing, a typed column whose first field doesn't
+    // have its type is a header; with nothing to go on (only text, or a
+    // single row) there is one, as reader::open() assumes
+    size_t header_votes = 0;
+    size_t data_votes = 0;
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        if (typed[i] && (types[i] != column_type::text) && first_typed[i])
+        {
+            if (merge(types[i], first_types[i]) == types[i])
+            {
+                ++data_votes;
+            }
+            else
+            {
+                ++header_votes;
+            }
+        }
+    }
+
+    result.has_header = (header_votes >= data_votes);
+
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        if (!result.has_header && first_typed[i])
+        {
+            types[i] = typed[i] ? merge(types[i], first_types[i]) : first_types[i];
+            typed[i] = true;
+        }
+
+        result.column_types.push_back(typed[i] ? types[i] : column_type::text);
+        result.column_names.push_back(result.has_header ? first_row[i].str() : "c" + std::to_string(i));
+    }
+
+    result.num_rows_sampled = records.size() - (result.has_header ? 1 : 0);
+    return true;
+}
+
+bool sniff_source(byte_source& source, schema& result, const sniff_options& options)
+{
+    bool complete = false;
+    const std::string sample = read_sample(source, options.sample_size, complete);
+
+    const std::vector<sample_block> blocks(1, { sample.data(), sample.data() + sample.size(), complete });
+    return infer_schema(blocks, options, result);
+}
+
+} // namespace
+
+const char* get_type_name(column_type type)
+{
+    switch (type)
+    {
+    case column_type::boolean:
+        return "boolean";
+    case column_type::integer:
+        return "integer";
+    case column_type::real:
+        return "real";
+    case column_type::date:
+        return "date";
+    default:
+        return "text";
+    }
+}
+
+bool classify(const field_view& field, column_type& type)
+{
+    const char* first = detail::skip_spaces(field.begin(), field.end());
+    const char* last = field.end();
+    while ((last != first) && ((last[-1] == ' ') || (last[-1] == '\t')))
+    {
+        --last;
+    }
+
+    if (first == last)
+    {
+        return false;
+    }
+
+    const field_view text(first, static_cast<size_t>(last - first));
+    if ((text == field_view("true", 4)) || (text == field_view("false", 5)))
+    {
+        type = column_type::boolean;
+    }
+    else if (is_integer(first, last))
+    {
+        type = column_type::integer;
+    }
+    else if (is_real(first, last))
+    {
+        type = column_type::real;
+    }
+    else if (is_date(first, last))
+    {
+        type = column_type::date;
+    }
+    else
+    {
+        type = column_type::text;
+    }
+
+    return true;
+}
+
+bool sniff(const char* filename, schema& result, const sniff_options& options)
+{
+    const std::unique_ptr<byte_source> source = open_file_source(filename);
+    return source && sniff_source(*source, result, options);
+}
+
+bool sniff(const char* filename, const row_index& index, schema& result, const sniff_options& options)
+{
+    // blocks can only be picked out of plain files
+    if ((options.num_blocks < 2) || (index.get_num_rows() == 0) ||
+        (detect_file_compression(filename) != compression::none))
+    {
+        return sniff(filename, result, options);
+    }
+
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const size_t block_size = options.sample_size / options.num_blocks;
+    std::vector<std::string> samples(options.num_blocks);
+    std::vector<sample_block> blocks;
+    for (size_t i = 0; i < options.num_blocks; ++i)
+    {
+        // the first block starts with the header, the others at the row
+        // the index has closest to their share of the file
+        const uint64_t offset = (i == 0) ? 0 : index.get_offset(i * index.get_num_rows() / options.num_blocks);
+
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+
+        std::string& sample = samples[i];
+        sample.resize(block_size);
+        file.read(&sample[0], static_cast<std::streamsize>(block_size));
+        sample.resize(static_cast<size_t>(file.gcount()));
+
+        blocks.push_back({ sample.data(), sample.data() + sample.size(), sample.size() < block_size });
+    }
+
+    return infer_schema(blocks, options, result);
+}
+
+bool sniff_buffer(const char* data, size_t size, schema& result, const sniff_options& options)
+{
+    const compression format = detect_compression(data, size);
+    if (format != compression::none)
+    {
+        const std::unique_ptr<byte_source> source =
+            make_decompressor(std::unique_ptr<byte_source>(new memory_source(data, size)), format);
+        return source && sniff_source(*source, result, options);
+    }
+
+    const size_t sample_size = std::min(size, options.sample_size);
+
+    const std::vector<sample_block> blocks(1, { data, data + sample_size, sample_size == size });
+    return infer_schema(blocks, options, result);
+}
+
+} // namespace csv
@@ -22,60 +22,534 @@
  * SOFTWARE.
  */
 #include "csv_writer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace csv
 {
 
-writer::row::row(std::ofstream& filestream)
-    : m_filestream(filestream)
+namespace detail
+{
+
+// Writes the buffers handed over by the writer and its shards to the sink
+// on its own thread. Every shard, and every buffer of the writer itself,
+// is a slot numbered in the order they were opened; with in_order a slot's
+// buffers are only written once all the slots before it are closed and
+// written.
+class shard_merger
 {
+public:
+    shard_merger(byte_sink& sink, bool in_order)
+        : m_sink(&sink),
+          m_in_order(in_order),
+          m_failed(false),
+          m_stopping(false),
+          m_writing(false),
+          m_next_slot(0),
+          m_head(0)
+    {
+        m_thread = std::thread([this]() { run(); });
+    }
+
+    ~shard_merger()
+    {
+        finish();
+    }
+
+    size_t open_slot()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_slots[m_next_slot];
+        return m_next_slot++;
+    }
+
+    // Hands rows over, closing the slot when last is set. Ignored once
+    // finished.
+    void submit(size_t slot, std::string rows, bool last)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_slots.find(slot);
+        if (m_stopping || (it == m_slots.end()))
+        {
+            return;
+        }
+
+        if (!rows.empty())
+        {
+            it->second.buffers.push_back(std::move(rows));
+        }
+
+        it->second.closed = last;
+        m_work.notify_one();
+    }
+
+    // Waits until everything that can be written is, then flushes the
+    // sink; the flusher can't start another write meanwhile.
+    bool flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this]() { return m_stopping || (!m_writing && !next_buffer(false)); });
+
+        return (m_sink != nullptr) && m_sink->flush();
+    }
+
+    // Writes what can be written and stops; rows of slots that weren't
+    // closed, and of the slots after them with in_order, are dropped.
+    // Returns false if anything was dropped or failed to be written.
+    bool finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_thread.joinable())
+            {
+                return !m_failed;
+            }
+
+            m_stopping = true;
+            m_work.notify_one();
+        }
+
+        m_thread.join();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failed = m_failed || !m_slots.empty();
+        m_slots.clear();
+        m_sink = nullptr;
+        m_idle.notify_all();
+        return !m_failed;
+    }
+
+private:
+    struct slot
+    {
+        std::deque<std::string> buffers;
+        bool closed = false;
+    };
+
+    // The next buffer to write, taken out of its slot when take is set;
+    // forgets the slots that are done on the way. Called with the mutex
+    // held.
+    std::string* next_buffer(bool take)
+    {
+        auto it = m_in_order ? m_slots.find(m_head) : m_slots.begin();
+        while (it != m_slots.end())
+        {
+            if (!it->second.buffers.empty())
+            {
+                if (take)
+                {
+                    m_buffer = std::move(it->second.buffers.front());
+                    it->second.buffers.pop_front();
+                }
+
+                return &m_buffer;
+            }
+
+            if (it->second.closed)
+            {
+                it = m_slots.erase(it);
+                if (m_in_order)
+                {
+                    it = m_slots.find(++m_head);
+                }
+            }
+            else if (m_in_order)
+            {
+                break;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            if (next_buffer(true) == nullptr)
+            {
+                m_idle.notify_all();
+                if (m_stopping)
+                {
+                    return;
+                }
+
+                m_work.wait(lock);
+                continue;
+            }
+
+            m_writing = true;
+            lock.unlock();
+
+            const bool written = m_sink->write(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+
+            lock.lock();
+            m_writing = false;
+            m_failed = m_failed || !written;
+        }
+    }
+
+    byte_sink* m_sink;
+    bool m_in_order;
+    bool m_failed;
+    bool m_stopping;
+    bool m_writing;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work;
+    std::condition_variable m_idle;
+    std::map<size_t, slot> m_slots;
+    size_t m_next_slot;
+    size_t m_head;
+    // the buffer being written, only touched by the flusher thread
+    std::string m_buffer;
+
+    std::thread m_thread;
+};
+
+} // namespace detail
+
+writer::row::row(writer& owner)
+    : m_writer(&owner)
+{
+    CSV_STATS(m_line_begin = owner.m_buffer.size());
+}
+
+writer::row::row(row&& other)
+    : m_writer(other.m_writer),
+      m_actual_columns(other.m_actual_columns),
+      m_line_open(other.m_line_open)
+{
+    CSV_STATS(m_line_begin = other.m_line_begin);
+    other.m_writer = nullptr;
+}
+
+writer::row& writer::row::operator=(row&& other)
+{
+    if (this != &other)
+    {
+        if (m_writer != nullptr)
+        {
+            flush();
+        }
+
+        m_writer = other.m_writer;
+        m_actual_columns = other.m_actual_columns;
+        m_line_open = other.m_line_open;
+        CSV_STATS(m_line_begin = other.m_line_begin);
+        other.m_writer = nullptr;
+    }
+
+    return *this;
 }
 
 writer::row::~row()
 {
-    flush();
+    if (m_writer != nullptr)
+    {
+        flush();
+    }
 }
 
 void writer::row::flush()
 {
-    const std::streamoff offset = (m_actual_columns > 0);
-    m_filestream.get().seekp(m_filestream.get().tellp() - offset);
+    if (m_line_open)
+    {
+        CSV_STATS(m_writer->count_row(m_actual_columns, m_writer->m_buffer.size() - m_line_begin + 1));
+        m_writer->end_line();
+        m_line_open = false;
+    }
 
-    m_filestream.get() << '\n';
     m_actual_columns = 0;
 }
 
+writer::shard::shard()
+    : m_slot(0),
+      m_delimiter(','),
+      m_num_columns(0),
+      m_buffer_size(0)
+{
+}
+
+writer::shard::shard(std::shared_ptr<detail::shard_merger> merger, size_t slot, const writer& owner)
+    : m_merger(std::move(merger)),
+      m_slot(slot),
+      m_delimiter(owner.m_delimiter),
+      m_num_columns(owner.m_column_names.size()),
+      m_buffer_size(owner.m_buffer_size),
+      m_precisions(owner.m_precisions)
+{
+    m_buffer.reserve(m_buffer_size);
+}
+
+writer::shard::shard(shard&& other)
+    : m_merger(std::move(other.m_merger)),
+      m_slot(other.m_slot),
+      m_delimiter(other.m_delimiter),
+      m_num_columns(other.m_num_columns),
+      m_buffer_size(other.m_buffer_size),
+      m_precisions(std::move(other.m_precisions)),
+      m_buffer(std::move(other.m_buffer))
+{
+    CSV_STATS(m_stats = other.m_stats);
+    other.m_merger.reset();
+}
+
+writer::shard& writer::shard::operator=(shard&& other)
+{
+    if (this != &other)
+    {
+        close();
+
+        m_merger = std::move(other.m_merger);
+        m_slot = other.m_slot;
+        m_delimiter = other.m_delimiter;
+        m_num_columns = other.m_num_columns;
+        m_buffer_size = other.m_buffer_size;
+        m_precisions = std::move(other.m_precisions);
+        m_buffer = std::move(other.m_buffer);
+        CSV_STATS(m_stats = other.m_stats);
+        other.m_merger.reset();
+    }
+
+    return *this;
+}
+
+writer::shard::~shard()
+{
+    close();
+}
+
+void writer::shard::close()
+{
+    if (m_merger)
+    {
+        CSV_STATS(m_stats.bytes_written += m_buffer.size());
+        m_merger->submit(m_slot, std::move(m_buffer), true);
+        m_merger.reset();
+    }
+
+    m_buffer.clear();
+}
+
+writer_stats writer::shard::get_stats() const
+{
+#if defined(CSV_HAVE_STATS)
+    return m_stats;
+#else
+    return writer_stats();
+#endif
+}
+
+void writer::shard::end_line()
+{
+    m_buffer.push_back('\n');
+    if (m_buffer.size() >= m_buffer_size)
+    {
+        CSV_STATS(m_stats.bytes_written += m_buffer.size());
+        m_merger->submit(m_slot, std::move(m_buffer), false);
+        m_buffer = std::string();
+        m_buffer.reserve(m_buffer_size);
+    }
+}
+
 writer::writer()
-    : m_delimiter(','),
-      m_header_written(false)
+    : m_failed(false),
+      m_delimiter(','),
+      m_buffer_size(size_t(1) << 20),
+      m_header_written(false),
+      m_shard_order(order::in_order),
+      m_stats_every(0)
 {
 }
 
+writer& writer::operator=(writer&& other)
+{
+    if (this != &other)
+    {
+        close();
+
+        m_sink = std::move(other.m_sink);
+        m_failed = other.m_failed;
+        m_delimiter = other.m_delimiter;
+        m_buffer = std::move(other.m_buffer);
+        m_buffer_size = other.m_buffer_size;
+        m_precisions = std::move(other.m_precisions);
+        m_header_written = other.m_header_written;
+        m_column_names = std::move(other.m_column_names);
+        m_merger = std::move(other.m_merger);
+        m_shard_order = other.m_shard_order;
+        CSV_STATS(m_stats = other.m_stats);
+        m_stats_every = other.m_stats_every;
+        m_stats_callback = std::move(other.m_stats_callback);
+    }
+
+    return *this;
+}
+
 writer::~writer()
 {
-    m_filestream.flush();
+    close();
+}
+
+bool writer::open(const char* filename, char delimiter, compression format, const compression_options& options)
+{
+    return open(open_file_sink(filename, format, options), delimiter);
 }
 
-bool writer::open(const char* filename, char delimiter)
+bool writer::open(std::unique_ptr<byte_sink> sink, char delimiter)
 {
+    close();
+    m_sink = std::move(sink);
+    m_failed = false;
     m_header_written = false;
     m_delimiter = delimiter;
-
-    m_filestream.open(filename);
-    m_filestream.imbue(std::locale{ "en_US.UTF8" });
+    m_buffer.reserve(m_buffer_size);
+    CSV_STATS(m_stats = writer_stats());
 
     return is_open();
 }
 
+bool writer::close()
+{
+    if (!m_sink)
+    {
+        m_buffer.clear();
+        return true;
+    }
+
+    write_buffer();
+    // the flusher thread writes to the sink until it's finished
+    if (m_merger)
+    {
+        m_failed = !m_merger->finish() || m_failed;
+        m_merger.reset();
+    }
+
+    const bool closed = m_sink->close();
+    m_sink.reset();
+
+    return closed && !m_failed;
+}
+
+void writer::set_precision(size_t column, int precision)
+{
+    if (column >= m_precisions.size())
+    {
+        m_precisions.resize(column + 1, -1);
+    }
+
+    m_precisions[column] = precision;
+}
+
+void writer::flush()
+{
+    write_buffer();
+    if (m_merger)
+    {
+        m_failed = !m_merger->flush() || m_failed;
+    }
+    else if (is_open() && !m_sink->flush())
+    {
+        m_failed = true;
+    }
+}
+
+writer_stats writer::get_stats() const
+{
+#if defined(CSV_HAVE_STATS)
+    return m_stats;
+#else
+    return writer_stats();
+#endif
+}
+
+void writer::set_stats_callback(size_t every_rows, writer_stats_callback callback)
+{
+    m_stats_every = callback ? every_rows : 0;
+    m_stats_callback = (m_stats_every > 0) ? std::move(callback) : writer_stats_callback();
+}
+
+void writer::write_buffer()
+{
+    if (m_merger && !m_buffer.empty())
+    {
+        CSV_STATS(m_stats.bytes_written += m_buffer.size());
+        // a slot of its own, for the buffer to stay between the shards
+        // around it
+        m_merger->submit(m_merger->open_slot(), std::move(m_buffer), true);
+        m_buffer = std::string();
+        m_buffer.reserve(m_buffer_size);
+        return;
+    }
+
+    if (!m_buffer.empty() && is_open())
+    {
+        CSV_STATS(detail::stats_timer io_timer(m_stats.io_time));
+        CSV_STATS(m_stats.bytes_written += m_buffer.size());
+
+        if (!m_sink->write(m_buffer.data(), m_buffer.size()))
+        {
+            m_failed = true;
+        }
+    }
+
+    m_buffer.clear();
+}
+
+void writer::end_line()
+{
+    m_buffer.push_back('\n');
+    if (m_buffer.size() >= m_buffer_size)
+    {
+        write_buffer();
+    }
+}
+
+#if defined(CSV_HAVE_STATS)
+void writer::count_row(size_t num_fields, size_t row_size)
+{
+    ++m_stats.rows;
+    m_stats.fields += num_fields;
+    m_stats.max_row_size = std::max(m_stats.max_row_size, row_size);
+
+    if ((m_stats_every > 0) && (m_stats.rows % m_stats_every == 0))
+    {
+        m_stats_callback(m_stats);
+    }
+}
+
+void writer::shard::count_row(size_t num_fields, size_t row_size)
+{
+    ++m_stats.rows;
+    m_stats.fields += num_fields;
+    m_stats.max_row_size = std::max(m_stats.max_row_size, row_size);
+}
+#endif
+
 void writer::write_header()
 {
-    m_filestream << m_column_names[0];
-    for (size_t i = 1; i < m_column_names.size(); ++i)
+    for (size_t i = 0; i < m_column_names.size(); ++i)
     {
-        m_filestream << ',' << m_column_names[i];
+        if (i > 0)
+        {
+            m_buffer.push_back(m_delimiter);
+        }
+        format<std::string>::write(m_buffer, m_column_names[i], m_delimiter);
     }
-    m_filestream << std::endl;
+    end_line();
     m_header_written = true;
 }
 
@@ -86,7 +560,30 @@ writer::row writer::new_row()
         write_header();
     }
 
-    return row(m_filestream);
+    return row(*this);
+}
+
+writer::shard writer::new_shard()
+{
+    if (!is_open() || m_column_names.empty())
+    {
+        return shard();
+    }
+
+    if (!m_header_written)
+    {
+        write_header();
+    }
+
+    if (!m_merger)
+    {
+        m_merger = std::make_shared<detail::shard_merger>(*m_sink, m_shard_order == order::in_order);
+    }
+
+    // what was written so far comes first
+    write_buffer();
+
+    return shard(m_merger, m_merger->open_slot(), *this);
 }
 
 } // namespace csv
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_cache.h"
+
+#include "test_util.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+namespace
+{
+
+using namespace test;
+
+const char* const table =
+    "id,price,city,note\n"
+    "1,2.5,paris,\"a, b\"\n"
+    "2,,london,x\n"
+    "3,4,paris,\n"
+    "4,1e3,\"rome\",y\n";
+
+bool equals(const csv::field_view& value, const char* expected)
+{
+    return std::string(value.data(), value.size()) == expected;
+}
+
+// every column gets the type of its fields, empty ones are null
+void check_values(const csv::cache& values, const char* what)
+{
+    check((values.get_num_rows() == 4) && (values.get_column_names().size() == 4), what);
+    check((values.get_delimiter() == ',') && (values.get_column_index("city") == 2), "cache layout");
+
+    check(values.get_type(0) == csv::column_type::integer, "integer column");
+    const int64_t* ids = values.get_integers(0);
+    check((ids != nullptr) && (ids[0] == 1) && (ids[3] == 4), "integer values");
+    check(values.get_reals(0) == nullptr, "no reals of an integer column");
+
+    check(values.get_type(1) == csv::column_type::real, "real column");
+    const double* prices = values.get_reals(1);
+    check((prices != nullptr) && (prices[0] == 2.5) && std::isnan(prices[1]) && (prices[2] == 4) && (prices[3] == 1000),
+          "real values");
+    check(values.is_null(1, 1) && !values.is_null(1, 0), "empty field is null");
+
+    check(values.get_type(2) == csv::column_type::text, "text column");
+    check(values.get_dictionary_size(2) == 3, "distinct values of a text column");
+    check(values.get_codes(2)[0] == values.get_codes(2)[2], "equal values share a code");
+    check(equals(values.get_text(2, 1), "london") && equals(values.get_text(2, 3), "rome"), "text values");
+    check(equals(values.get_text(3, 0), "a, b") && values.is_null(3, 2), "quoted and null text");
+
+    check((values.get_record_offset(0) == 19) && (values.get_record_offset(1) == 38), "record offsets");
+}
+
+void test_build_and_load()
+{
+    write_file("cached.csv", table);
+    std::remove(csv::cache::get_sidecar_path("cached.csv").c_str());
+
+    csv::cache built;
+    check(built.build("cached.csv"), "build the cache");
+    check_values(built, "built cache");
+    check(built.save(csv::cache::get_sidecar_path("cached.csv").c_str()), "save the cache");
+
+    csv::cache loaded;
+    check(loaded.load(csv::cache::get_sidecar_path("cached.csv").c_str()), "load the cache");
+    check(loaded.get_filename() == "cached.csv", "filename of the cache");
+    check_values(loaded, "loaded cache");
+
+    csv::cache reused;
+    check(reused.load_or_build("cached.csv"), "load_or_build an up to date cache");
+    check_values(reused, "reused cache");
+}
+
+// a cache whose file changed since is rejected, even at the same size
+void test_stale_cache()
+{
+    csv::cache values;
+    check(values.load_or_build("cached.csv"), "save the cache before the change");
+
+    std::string changed = table;
+    changed.replace(changed.find("london"), 6, "berlin");
+    write_file("cached.csv", changed);
+
+    check(!values.load(csv::cache::get_sidecar_path("cached.csv").c_str()), "stale cache is rejected");
+    check(values.load_or_build("cached.csv") && equals(values.get_text(2, 1), "berlin"), "stale cache is rebuilt");
+}
+
+} // namespace
+
+int main()
+{
+    test_build_and_load();
+    test_stale_cache();
+
+    return test::result();
+}
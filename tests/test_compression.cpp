@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_byte_source.h"
+#include "csv_compression.h"
+#include "csv_reader.h"
+#include "csv_writer.h"
+
+#include "test_util.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+using namespace test;
+
+const size_t num_rows = 100000;
+
+// rows read from the file, and whether the reader failed
+size_t count_rows(const char* path, bool& failed)
+{
+    csv::reader reader;
+    size_t rows = 0;
+    if (reader.open(path))
+    {
+        while (reader.next_row())
+        {
+            ++rows;
+        }
+    }
+
+    failed = reader.failed();
+    return rows;
+}
+
+// damaged files are told apart from complete ones
+void test_damaged(csv::compression format, const char* path)
+{
+    {
+        csv::writer writer;
+        check(writer.open(path, ',', format), "open the compressed output");
+        writer.set_column_names("id", "name");
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            writer.write_row(i, "name");
+        }
+    }
+
+    bool failed = true;
+    check(count_rows(path, failed) == num_rows, "every row of the complete file");
+    check(!failed, "the complete file doesn't fail");
+
+    const std::string content = read_file(path);
+    write_file(path, content.substr(0, content.size() / 2));
+    check(count_rows(path, failed) < num_rows, "fewer rows in the truncated file");
+    check(failed, "the truncated file fails");
+
+    std::string corrupt = content;
+    for (size_t i = corrupt.size() / 2; i < corrupt.size() / 2 + 64; ++i)
+    {
+        corrupt[i] = static_cast<char>(~corrupt[i]);
+    }
+    write_file(path, corrupt);
+    count_rows(path, failed);
+    check(failed, "the corrupt file fails");
+}
+
+// an exception thrown by a source on the prefetch thread comes out of the
+// reader instead of ending the process
+void test_throwing_source()
+{
+    const std::string content = "id,name\n1,a\n2,b\n";
+    size_t pos = 0;
+    auto read = [&](char* buffer, size_t size) -> size_t
+    {
+        if (pos == content.size())
+        {
+            throw std::runtime_error("net down");
+        }
+
+        const size_t read_size = std::min(size, content.size() - pos);
+        std::memcpy(buffer, content.data() + pos, read_size);
+        pos += read_size;
+        return read_size;
+    };
+
+    csv::reader reader;
+    reader.set_block_size(8);
+
+    size_t rows = 0;
+    bool thrown = false;
+    try
+    {
+        if (reader.open(std::unique_ptr<csv::byte_source>(new csv::callback_source(read))))
+        {
+            while (reader.next_row())
+            {
+                ++rows;
+            }
+        }
+    }
+    catch (const std::runtime_error& error)
+    {
+        thrown = (std::string(error.what()) == "net down");
+    }
+
+    check(thrown, "the source's exception is rethrown");
+    check(rows == 2, "rows before the exception are read");
+    check(!reader.next_row() && reader.failed(), "the reader fails after the exception");
+}
+
+} // namespace
+
+int main()
+{
+    test_throwing_source();
+
+    if (csv::can_compress(csv::compression::gzip) && csv::is_supported(csv::compression::gzip))
+    {
+        test_damaged(csv::compression::gzip, "damaged.csv.gz");
+    }
+
+    if (csv::can_compress(csv::compression::zstd) && csv::is_supported(csv::compression::zstd))
+    {
+        test_damaged(csv::compression::zstd, "damaged.csv.zst");
+    }
+
+    return test::result();
+}
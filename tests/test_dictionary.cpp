@@ -0,0 +1,132 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_dictionary.h"
+#include "csv_reader.h"
+
+#include "test_util.h"
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+using namespace test;
+
+bool equals(const csv::field_view& value, const char* expected)
+{
+    return (value.size() == std::strlen(expected)) &&
+        (std::string(value.data(), value.size()) == expected);
+}
+
+// codes are given in order of first sight, equal values share one
+void test_codes()
+{
+    csv::dictionary values;
+    check(values.intern(csv::field_view("red", 3)) == 0, "first value gets code 0");
+    check(values.intern(csv::field_view("green", 5)) == 1, "new value gets the next code");
+    check(values.intern(csv::field_view("red", 3)) == 0, "known value keeps its code");
+    check(values.find(csv::field_view("green", 5)) == 1, "find a known value");
+    check(values.find(csv::field_view("blue", 4)) == csv::dictionary::npos, "find an unknown value");
+    check(values.size() == 2, "two distinct values");
+    check(equals(values.get_value(1), "green"), "value of a code");
+
+    values.clear();
+    check(values.empty() && (values.find(csv::field_view("red", 3)) == csv::dictionary::npos), "clear");
+}
+
+// the empty value is a value like any other, with a non-null view
+void test_empty_value()
+{
+    csv::dictionary values;
+    const uint32_t code = values.intern(csv::field_view());
+    check(values.intern(csv::field_view("", 0)) == code, "intern the empty value twice");
+    check(values.find(csv::field_view()) == code, "find the empty value");
+    check((values.get_value(code).size() == 0) && (values.get_value(code).data() != nullptr), "empty value view");
+}
+
+// quoted fields are unescaped, and views stay valid as the dictionary grows
+void test_unescape_and_growth()
+{
+    csv::dictionary values;
+    const char* const field = "\"a\"\"b\"";
+    const uint32_t quoted = values.intern(csv::detail::make_field(field, field + 6));
+    check(values.intern(csv::field_view("a\"b", 3)) == quoted, "quoted and plain values are the same");
+    check(equals(values.get_value(quoted), "a\"b"), "stored value is unescaped");
+
+    const csv::field_view first = values.get_value(quoted);
+    std::string long_value(100000, 'x');
+    values.intern(csv::field_view(long_value.data(), long_value.size()));
+    for (int i = 0; i < 20000; ++i)
+    {
+        const std::string value = "value " + std::to_string(i);
+        values.intern(csv::field_view(value.data(), value.size()));
+    }
+
+    check(values.size() == 20002, "every distinct value is kept");
+    check((values.get_value(quoted).data() == first.data()) && equals(first, "a\"b"), "views survive growth");
+    check(values.find(csv::field_view("value 12345", 11)) == 12347, "find after growth");
+    check(equals(values.get_value(1), long_value.c_str()), "long value");
+}
+
+// read_row interns columns read as csv::interned
+void test_interned_column()
+{
+    const char* const text =
+        "id,color\n"
+        "1,red\n"
+        "2,\"blue\"\n"
+        "3,\n"
+        "4,red\n";
+
+    csv::reader reader;
+    check(reader.open_buffer(text, std::strlen(text)), "open interned input");
+
+    csv::dictionary colors;
+    csv::interned color(colors);
+    int id = 0;
+    uint32_t codes[4] = {};
+    size_t rows = 0;
+    while ((rows < 4) && reader.read_row(id, color))
+    {
+        codes[rows++] = color.get_code();
+    }
+
+    check((rows == 4) && (colors.size() == 3), "three distinct colors");
+    check((codes[0] == codes[3]) && (codes[0] != codes[1]) && (codes[2] != codes[0]), "codes of interned values");
+    check(equals(color.get_value(), "red"), "value of an interned field");
+    check(color == csv::interned(color), "interned values compare by code");
+}
+
+} // namespace
+
+int main()
+{
+    test_codes();
+    test_empty_value();
+    test_unescape_and_growth();
+    test_interned_column();
+
+    return test::result();
+}
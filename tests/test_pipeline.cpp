@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_pipeline.h"
+#include "csv_reader.h"
+
+#include "test_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace test;
+
+const size_t num_rows = 10000;
+
+std::string make_rows()
+{
+    std::string content = "id,name\n";
+    for (size_t i = 0; i < num_rows; ++i)
+    {
+        content += std::to_string(i) + ",row" + std::to_string(i) + "\n";
+    }
+
+    return content;
+}
+
+// batches are numbered in file order, and each one holds the rows that
+// follow the previous one
+void test_batch_order()
+{
+    const std::string content = make_rows();
+
+    csv::reader reader;
+    check(reader.open_buffer(content.data(), content.size()), "open the buffer");
+
+    struct batch_info
+    {
+        size_t index;
+        size_t first_row;
+        size_t size;
+        bool rows_match;
+    };
+
+    std::mutex mutex;
+    std::vector<batch_info> seen;
+
+    csv::pipeline pipeline;
+    pipeline.set_num_workers(4);
+    pipeline.set_batch_size(64);
+    check(pipeline.process_batches(reader, [&](const csv::pipeline::batch& rows)
+    {
+        bool rows_match = true;
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            rows_match &= (rows[i].get<size_t>(0) == rows.get_first_row() + i);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        seen.push_back({ rows.get_index(), rows.get_first_row(), rows.size(), rows_match });
+    }), "process the batches");
+
+    std::sort(seen.begin(), seen.end(), [](const batch_info& a, const batch_info& b)
+    {
+        return a.index < b.index;
+    });
+
+    size_t first_row = 0;
+    bool in_order = true;
+    for (size_t i = 0; i < seen.size(); ++i)
+    {
+        in_order &= (seen[i].index == i) && (seen[i].first_row == first_row) && seen[i].rows_match;
+        first_row += seen[i].size;
+    }
+
+    check(seen.size() == (num_rows + 63) / 64, "every batch is processed once");
+    check(in_order, "batches are numbered in file order");
+    check(first_row == num_rows, "every row is processed");
+}
+
+// an exception thrown by fn stops the run and comes out of it
+void test_throwing_callback()
+{
+    const std::string content = make_rows();
+
+    csv::reader reader;
+    check(reader.open_buffer(content.data(), content.size()), "open the buffer");
+
+    csv::pipeline pipeline;
+    pipeline.set_num_workers(4);
+    pipeline.set_batch_size(16);
+    pipeline.set_queue_size(2);
+
+    std::atomic<size_t> calls(0);
+    bool thrown = false;
+    try
+    {
+        pipeline.process_batches(reader, [&](const csv::pipeline::batch&)
+        {
+            if (calls++ == 3)
+            {
+                throw std::runtime_error("callback failed");
+            }
+        });
+    }
+    catch (const std::runtime_error& error)
+    {
+        thrown = (std::string(error.what()) == "callback failed");
+    }
+
+    check(thrown, "the callback's exception is rethrown");
+    check(calls < num_rows / 16, "no more batches are read after the exception");
+}
+
+} // namespace
+
+int main()
+{
+    test_batch_order();
+    test_throwing_callback();
+
+    return test::result();
+}
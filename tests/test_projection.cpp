@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_reader.h"
+
+#include "test_util.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace test;
+
+const char* const table =
+    "a,b,c,d\n"
+    "1,x,2.5,\"tail, one\"\n"
+    "2,y,3.5,\"tail, two\"\n"
+    "3,z,4.5,\"tail, three\"\n";
+
+// read_row reads the selected columns in column order, whatever order
+// they were selected in
+void test_select_by_name(csv::read_mode mode)
+{
+    csv::reader reader;
+    check(reader.open("projection.csv", ',', mode), "open projection input");
+    check(reader.select_cols("c", "a"), "select columns by name");
+    check(reader.get_selected_indexes() == std::vector<size_t>({ 0, 2 }), "selected indexes are sorted");
+    check(!reader.select_cols("a", "e"), "unknown column fails select_cols");
+
+    check(reader.select_cols(std::vector<std::string>({ "c", "a" })), "select columns by names");
+
+    int a = 0;
+    double c = 0;
+    int rows = 0;
+    bool all_match = true;
+    while (reader.read_row(a, c))
+    {
+        ++rows;
+        all_match &= (a == rows) && (c == rows + 1.5);
+    }
+
+    check((rows == 3) && all_match, "read selected columns");
+}
+
+// selections by index, by flags and by column set are the same
+void test_select_forms()
+{
+    csv::reader reader;
+    check(reader.open("projection.csv"), "open projection input");
+
+    check(reader.select_cols(std::vector<size_t>({ 1, 3 })), "select columns by index");
+    const std::vector<size_t> by_index = reader.get_selected_indexes();
+    check(by_index == std::vector<size_t>({ 1, 3 }), "indexes select those columns");
+
+    check(reader.select_cols(std::vector<bool>({ false, true, false, true })), "select columns by flags");
+    check(reader.get_selected_indexes() == by_index, "flags select the same columns");
+
+    csv::column_set cols(4);
+    cols.set(1);
+    cols.set(3);
+    check(reader.select_cols(cols), "select columns by set");
+    check(reader.get_selected_indexes() == by_index, "set selects the same columns");
+
+    check(!reader.select_cols(std::vector<size_t>({ 4 })), "column past the end fails select_cols");
+
+    std::string b;
+    std::string d;
+    check(reader.read_row(b, d) && (b == "x") && (d == "tail, one"), "read the last column");
+}
+
+// fields past the last selected column are still there when asked for
+void test_untokenized_tail()
+{
+    csv::reader reader;
+    check(reader.open("projection.csv"), "open projection input");
+    check(reader.select_cols("a"), "select the first column");
+
+    int a = 0;
+    check(reader.read_row(a) && (a == 1), "read the first column");
+
+    std::string d;
+    check((reader.get_row().size() == 4) && reader.get_row().get(3, d) && (d == "tail, one"),
+          "fields past the selection");
+}
+
+// read_batch fills one vector per selected column
+void test_batch()
+{
+    csv::reader reader;
+    check(reader.open("projection.csv"), "open projection input");
+    check(reader.select_cols("b", "c"), "select columns for a batch");
+
+    std::vector<std::string> b;
+    std::vector<double> c;
+    check(reader.read_batch(2, b, c) == 2, "first batch");
+    check((b == std::vector<std::string>({ "x", "y" })) && (c == std::vector<double>({ 2.5, 3.5 })), "first batch values");
+    check((reader.read_batch(2, b, c) == 1) && (b[0] == "z") && (c[0] == 4.5), "last batch");
+    check(reader.read_batch(2, b, c) == 0, "no more batches");
+}
+
+} // namespace
+
+int main()
+{
+    write_file("projection.csv", table);
+
+    test_select_by_name(csv::read_mode::stream);
+    test_select_by_name(csv::read_mode::mapped);
+    test_select_by_name(csv::read_mode::async);
+    test_select_forms();
+    test_untokenized_tail();
+    test_batch();
+
+    return test::result();
+}
@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_parallel_reader.h"
+#include "csv_reader.h"
+
+#include "test_util.h"
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace test;
+
+// a quote inside an unquoted field is part of it, the next line is still
+// a record of its own
+const char* const stray_quotes =
+    "id,height,note\n"
+    "1,5\"10,tall\n"
+    "2,6\",\"quoted, with a \"\"quote\"\"\"\n"
+    "3,\"two\nlines\",x\n"
+    "4,a\"\"b,end\n";
+
+const char* const expected_fields[][3] = {
+    { "1", "5\"10", "tall" },
+    { "2", "6\"", "quoted, with a \"quote\"" },
+    { "3", "two\nlines", "x" },
+    { "4", "a\"\"b", "end" },
+};
+
+const size_t num_expected = sizeof(expected_fields) / sizeof(expected_fields[0]);
+
+bool matches(const csv::reader::row& row, size_t index)
+{
+    if ((index >= num_expected) || (row.size() != 3))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        std::string value;
+        if (!row.get(i, value) || (value != expected_fields[index][i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void test_read_mode(csv::read_mode mode, const char* what)
+{
+    csv::reader reader;
+    check(reader.open("stray_quotes.csv", ',', mode), what);
+
+    size_t rows = 0;
+    bool all_match = true;
+    while (reader.next_row())
+    {
+        all_match &= matches(reader.get_row(), rows);
+        ++rows;
+    }
+
+    check((rows == num_expected) && all_match, what);
+}
+
+void append_file(const char* path, const std::string& content)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << content;
+}
+
+// records appended a few bytes at a time, ending anywhere in a quoted
+// field, are read once they are complete
+void test_follow()
+{
+    const std::string content = stray_quotes;
+    const size_t header_end = content.find('\n') + 1;
+    write_file("followed.csv", content.substr(0, header_end));
+
+    csv::reader reader;
+    reader.set_follow_timeout(std::chrono::milliseconds(0));
+    check(reader.open("followed.csv", ',', csv::read_mode::follow), "open in read_mode::follow");
+
+    size_t rows = 0;
+    bool all_match = true;
+    for (size_t pos = header_end, step = 1; pos < content.size(); pos += step, step = step % 7 + 1)
+    {
+        append_file("followed.csv", content.substr(pos, step));
+        while (reader.next_row())
+        {
+            all_match &= matches(reader.get_row(), rows);
+            ++rows;
+        }
+    }
+
+    check((rows == num_expected) && all_match, "stray quotes in read_mode::follow");
+
+    // a record much longer than a read, growing in pieces
+    const std::string long_field(300000, 'x');
+    for (size_t pos = 0; pos < long_field.size(); pos += 50000)
+    {
+        append_file("followed.csv", ((pos == 0) ? "5,\"" : "") + long_field.substr(pos, 50000));
+        check(!reader.next_row(), "partial long record isn't read");
+    }
+
+    append_file("followed.csv", "\",end\n");
+    std::string value;
+    check(reader.next_row() && reader.get_row().get(1, value) && (value == long_field), "long record in read_mode::follow");
+}
+
+void test_parallel()
+{
+    csv::parallel_reader reader;
+    check(reader.open("stray_quotes.csv"), "open with parallel_reader");
+
+    // chunks are cut after stray quotes too
+    for (size_t chunk_size = 1; chunk_size < 40; ++chunk_size)
+    {
+        reader.set_num_threads(2);
+        reader.set_chunk_size(chunk_size);
+
+        size_t rows = 0;
+        bool all_match = true;
+        reader.read_rows([&](const csv::reader::row& row)
+        {
+            all_match &= matches(row, rows);
+            ++rows;
+        });
+
+        check((rows == num_expected) && all_match, "parallel_reader splits records as the reader does");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    write_file("stray_quotes.csv", stray_quotes);
+
+    test_read_mode(csv::read_mode::stream, "stray quotes in read_mode::stream");
+    test_read_mode(csv::read_mode::mapped, "stray quotes in read_mode::mapped");
+    test_read_mode(csv::read_mode::async, "stray quotes in read_mode::async");
+    test_follow();
+    test_parallel();
+
+    return test::result();
+}
@@ -0,0 +1,337 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_reader.h"
+#include "csv_writer.h"
+
+#include "test_util.h"
+
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using namespace test;
+
+// rows read as fields and written back are the same bytes
+void test_field_round_trip()
+{
+    const std::string content =
+        "name,quote,plain\n"
+        "\"x,y\",\"he said \"\"hi\"\"\",z\n"
+        "\"two\nlines\",\"\",\n";
+    write_file("round_trip_in.csv", content);
+
+    csv::reader reader;
+    csv::writer writer;
+    check(reader.open("round_trip_in.csv", ',', csv::read_mode::mapped), "open the input");
+    check(writer.open("round_trip_out.csv"), "open the output");
+    writer.set_column_names(reader.get_column_names());
+
+    while (reader.next_row())
+    {
+        const csv::reader::row& row = reader.get_row();
+        writer.write_row(row.get_field(0), row.get_field(1), row.get_field(2));
+    }
+    writer.close();
+
+    check(read_file("round_trip_out.csv") == content, "fields written back as they were read");
+}
+
+// text values that need quoting read back as they were written
+void test_text_round_trip()
+{
+    const std::string values[] = { "a;b", "say \"so\"", "line\nbreak", "cr\r", "plain" };
+
+    csv::writer writer;
+    check(writer.open("round_trip_text.csv", ';'), "open the text output");
+    writer.set_column_names("a;b", "b");
+    for (const std::string& value : values)
+    {
+        writer.write_row(value, value.c_str());
+    }
+    writer.close();
+
+    csv::reader reader;
+    check(reader.open("round_trip_text.csv", ';', csv::read_mode::mapped), "open the text input");
+    check((reader.get_column_names().size() == 2) && (reader.get_column_names()[0] == "a;b"),
+          "quoted column names");
+
+    size_t row = 0;
+    std::string first;
+    std::string second;
+    while (reader.read_row(first, second))
+    {
+        check((row < 5) && (first == values[row]) && (second == values[row]), "text read back");
+        ++row;
+    }
+    check(row == 5, "every text row read back");
+}
+
+// doubles and floats are written with digits that read back to the same
+// value, usually the fewest
+void test_floating_round_trip()
+{
+    std::mt19937_64 rng(7);
+    std::vector<double> doubles;
+    std::vector<float> floats;
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        // any finite value, and amounts with a few decimals
+        const uint64_t exponent_mask = uint64_t(0x7FF) << 52;
+        const uint64_t bits = (rng() & ~exponent_mask) | ((rng() % 0x7FF) << 52);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        doubles.push_back(value);
+        doubles.push_back(static_cast<double>(rng() % 100000000) / 1000.0);
+
+        const uint32_t float_bits = (static_cast<uint32_t>(rng()) & ~(uint32_t(0xFF) << 23)) |
+                                    (static_cast<uint32_t>(rng() % 0xFF) << 23);
+        float float_value;
+        std::memcpy(&float_value, &float_bits, sizeof(float_value));
+        floats.push_back(float_value);
+        floats.push_back(float_value);
+    }
+
+    csv::writer writer;
+    check(writer.open("round_trip_floating.csv"), "open the floating output");
+    writer.set_column_names("double", "float");
+    for (size_t i = 0; i < doubles.size(); ++i)
+    {
+        writer.write_row(doubles[i], floats[i]);
+    }
+    writer.close();
+
+    csv::reader reader;
+    check(reader.open("round_trip_floating.csv", ',', csv::read_mode::mapped), "open the floating input");
+
+    size_t row = 0;
+    bool same = true;
+    double double_value = 0;
+    float float_value = 0;
+    while (reader.read_row(double_value, float_value))
+    {
+        same &= (row < doubles.size()) && (double_value == doubles[row]) && (float_value == floats[row]);
+        ++row;
+    }
+
+    check(same && (row == doubles.size()), "floating values read back");
+
+    const double values[] = { 0.1, 0.3, 1e-5, 0.0001, 100, 1e15, 1e16, -0.0, 5e-324, 1.7976931348623157e308 };
+    const char* const texts[] = { "0.1", "0.3", "1e-05", "0.0001", "100", "1e+15", "1e+16", "-0", "5e-324",
+                                  "1.7976931348623157e+308" };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        std::string text;
+        csv::format<double>::write(text, values[i]);
+        check(text == texts[i], "doubles laid out as %g does");
+    }
+}
+
+bool parse_double(const std::string& text, double& value)
+{
+    return csv::convert<double>::parse(csv::field_view(text.data(), text.size()), value);
+}
+
+bool parse_float(const std::string& text, float& value)
+{
+    return csv::convert<float>::parse(csv::field_view(text.data(), text.size()), value);
+}
+
+// decimal text reads as the C library reads it in the "C" locale
+void test_parse_floating()
+{
+    std::mt19937_64 rng(11);
+    bool same = true;
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        std::string text = (rng() % 2) ? "-" : "";
+        const size_t num_digits = 1 + rng() % 25;
+        const size_t point = rng() % (num_digits + 1);
+        for (size_t d = 0; d < num_digits; ++d)
+        {
+            text += (d == point) ? "." : "";
+            text += static_cast<char>('0' + rng() % 10);
+        }
+
+        if (rng() % 2)
+        {
+            text += "e" + std::to_string(static_cast<int>(rng() % 700) - 350);
+        }
+
+        double value = 0;
+        float float_value = 0;
+        same &= parse_double(text, value) && (value == std::strtod(text.c_str(), nullptr));
+        same &= parse_float(text, float_value) && (float_value == std::strtof(text.c_str(), nullptr));
+    }
+    check(same, "decimal text reads as strtod reads it");
+
+    double value = 0;
+    check(parse_double(" +1.5", value) && (value == 1.5), "plus sign and spaces");
+    check(parse_double(".5", value) && (value == 0.5), "no integer digits");
+    check(parse_double("5.", value) && (value == 5), "no fraction digits");
+    check(parse_double("2e", value) && (value == 2), "exponent without digits");
+    check(parse_double("3e+", value) && (value == 3), "exponent sign without digits");
+    check(parse_double("-0", value) && (value == 0) && std::signbit(value), "negative zero");
+    check(parse_double("-Infinity", value) && std::isinf(value) && (value < 0), "negative infinity");
+    check(parse_double("nan", value) && (value != value), "not a number");
+    check(!parse_double("abc", value) && !parse_double(".", value) && !parse_double("-", value), "no digits fail");
+
+    // the program's locale doesn't change how fields read, whichever
+    // comma decimal locale there is
+    const char* const locales[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "German" };
+    for (const char* locale : locales)
+    {
+        if (std::setlocale(LC_ALL, locale) != nullptr)
+        {
+            check(parse_double("1.5", value) && (value == 1.5), "short number in a comma decimal locale");
+            check(parse_double("1.0000000000000000000000000001e-400", value) && (value == 0),
+                  "long number in a comma decimal locale");
+            check(parse_double("1.25000000000000000000001", value) && (value == 1.25),
+                  "rounded number in a comma decimal locale");
+            std::setlocale(LC_ALL, "C");
+            break;
+        }
+    }
+}
+
+// fixed decimals and the printf fallbacks write a '.' whatever the
+// program's locale is
+void test_format_floating()
+{
+    std::string text;
+    csv::format<double>::write_fixed(text, 1.5, 2);
+    text += ' ';
+    csv::format<float>::write_fixed(text, 0.75f, 1);
+    text += ' ';
+    csv::format<long double>::write(text, 0.1L);
+    text += ' ';
+    csv::format<double>::write_fixed(text, 1e20, 1);
+    check(text == "1.50 0.8 0.1 100000000000000000000.0", "fixed and general digits");
+
+    const char* const locales[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "German" };
+    for (const char* locale : locales)
+    {
+        if (std::setlocale(LC_ALL, locale) != nullptr)
+        {
+            std::string localized;
+            csv::format<double>::write_fixed(localized, 1.5, 2);
+            localized += ' ';
+            csv::format<float>::write_fixed(localized, 0.75f, 1);
+            localized += ' ';
+            csv::format<long double>::write(localized, 0.1L);
+            localized += ' ';
+            csv::format<double>::write_fixed(localized, 1e20, 1);
+            check(localized == text, "fixed and general digits in a comma decimal locale");
+
+            csv::writer writer;
+            check(writer.open("round_trip_locale.csv"), "open the output in a comma decimal locale");
+            writer.set_column_names("a", "b");
+            writer.set_precision(0, 2);
+            writer.write_row(1.5, 2.25);
+            writer.close();
+            check(read_file("round_trip_locale.csv") == "a,b\n1.50,2.25\n", "rows in a comma decimal locale");
+
+            std::setlocale(LC_ALL, "C");
+            break;
+        }
+    }
+}
+
+// assigning over an open writer writes out its buffered rows first
+void test_move_assign()
+{
+    csv::writer writer;
+    check(writer.open("round_trip_moved.csv"), "open the output to move over");
+    writer.set_column_names("id", "name");
+    writer.write_row(1, "a");
+    writer.write_row(2, "b");
+
+    writer = csv::writer();
+    check(!writer.is_open(), "moved over writer is closed");
+    check(read_file("round_trip_moved.csv") == "id,name\n1,a\n2,b\n", "rows written before the move");
+
+    csv::writer other;
+    check(other.open("round_trip_moved.csv"), "open the output to move from");
+    other.set_column_names("id");
+    other.write_row(3);
+
+    writer = std::move(other);
+    check(writer.is_open() && writer.write_row(4), "moved writer keeps writing");
+    writer.close();
+    check(read_file("round_trip_moved.csv") == "id\n3\n4\n", "rows of the moved writer");
+}
+
+// assigning over a writer with open shards stops its flusher before the
+// output goes away; the shards' rows that weren't handed over are dropped
+void test_move_assign_shards()
+{
+    csv::writer writer;
+    writer.set_buffer_size(16);
+    check(writer.open("round_trip_shards.csv"), "open the output with shards");
+    writer.set_column_names("id");
+    writer.write_row(0);
+
+    csv::writer::shard closed = writer.new_shard();
+    csv::writer::shard open = writer.new_shard();
+    std::thread worker([&open]() {
+        for (int i = 0; i < 10000; ++i)
+        {
+            open.write_row(i);
+        }
+    });
+
+    for (int i = 1; i < 4; ++i)
+    {
+        closed.write_row(i);
+    }
+    closed.close();
+
+    writer = csv::writer();
+    worker.join();
+
+    check(open.write_row(1), "open shard outlives its writer");
+    open.close();
+    check(read_file("round_trip_shards.csv") == "id\n0\n1\n2\n3\n", "rows before the open shard are written");
+}
+
+} // namespace
+
+int main()
+{
+    test_field_round_trip();
+    test_text_round_trip();
+    test_floating_round_trip();
+    test_parse_floating();
+    test_format_floating();
+    test_move_assign();
+    test_move_assign_shards();
+    return test::result();
+}
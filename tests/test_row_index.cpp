@@ -0,0 +1,172 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_reader.h"
+#include "csv_row_index.h"
+
+#include "test_util.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+using namespace test;
+
+const size_t num_rows = 1000;
+
+// every tenth row has a quoted field spanning two lines
+std::string make_table(size_t rows, char delimiter)
+{
+    std::string table = std::string("id") + delimiter + "note\n";
+    for (size_t i = 0; i < rows; ++i)
+    {
+        table += std::to_string(i) + delimiter;
+        table += (i % 10 == 0) ? "\"two\nlines\"\n" : "one line\n";
+    }
+
+    return table;
+}
+
+bool read_id(csv::reader& reader, size_t& id)
+{
+    std::string note;
+    return reader.read_row(id, note);
+}
+
+// seeking to any row reads it next, stride or not
+void test_seek(csv::read_mode mode, const char* what)
+{
+    csv::row_index index;
+    check(index.build("indexed.csv", 16), "build the index");
+    check((index.get_num_rows() == num_rows) && (index.get_stride() == 16), "rows of the index");
+
+    csv::reader reader;
+    check(reader.open("indexed.csv", ',', mode), what);
+
+    bool all_match = true;
+    for (size_t row : { size_t(0), size_t(15), size_t(16), size_t(17), size_t(500), size_t(999), size_t(3) })
+    {
+        size_t id = 0;
+        all_match &= reader.seek(index, row) && read_id(reader, id) && (id == row);
+    }
+
+    check(all_match, what);
+    check(!reader.seek(index, num_rows), "seek past the last row fails");
+
+    // an index of another delimiter doesn't describe the file as read
+    csv::row_index other;
+    check(other.build("indexed.csv", 16, ';') && !reader.seek(other, 5), "seek with another delimiter fails");
+}
+
+// sidecars load back while the file is unchanged
+void test_sidecar()
+{
+    std::remove(csv::row_index::get_sidecar_path("indexed.csv").c_str());
+
+    csv::row_index built;
+    check(built.load_or_build("indexed.csv", 32), "build and save the index");
+
+    csv::row_index loaded;
+    check(loaded.load(csv::row_index::get_sidecar_path("indexed.csv").c_str()), "load the sidecar");
+    check((loaded.get_num_rows() == num_rows) && (loaded.get_stride() == 32) &&
+          (loaded.get_filename() == "indexed.csv") && (loaded.get_offset(999) == built.get_offset(999)),
+          "loaded index matches the built one");
+
+    check(!loaded.load("indexed.csv"), "a CSV file isn't an index");
+}
+
+// an index whose file changed since is rebuilt
+void test_stale_sidecar()
+{
+    csv::row_index index;
+    check(index.load_or_build("indexed.csv", 32), "save the index before the change");
+
+    write_file("indexed.csv", make_table(num_rows + 5, ','));
+    check(!index.load(csv::row_index::get_sidecar_path("indexed.csv").c_str()), "stale sidecar is rejected");
+    check(index.load_or_build("indexed.csv", 32) && (index.get_num_rows() == num_rows + 5), "stale sidecar is rebuilt");
+
+    csv::reader reader;
+    size_t id = 0;
+    check(reader.open("indexed.csv") && reader.seek(index, num_rows + 4) && read_id(reader, id) &&
+          (id == num_rows + 4), "seek with the rebuilt index");
+
+    write_file("indexed.csv", make_table(num_rows, ','));
+}
+
+// sizes in a damaged sidecar are checked against the file before they are
+// used, and the index is rebuilt
+void test_damaged_sidecar()
+{
+    const std::string sidecar = csv::row_index::get_sidecar_path("indexed.csv");
+
+    csv::row_index built;
+    check(built.load_or_build("indexed.csv", 32), "save the index before the damage");
+    const std::string content = read_file(sidecar.c_str());
+
+    // magic, file size, mtime, stride, delimiter, rows, offsets
+    const size_t stride_pos = 24;
+    const size_t num_rows_pos = 33;
+    const size_t num_offsets_pos = 41;
+    const size_t filename_size_pos = num_offsets_pos + 8 + (built.get_num_rows() + 31) / 32 * 8;
+
+    std::string damaged = content;
+    const uint64_t stride = 1;
+    const uint64_t huge = uint64_t(1) << 60;
+    std::memcpy(&damaged[stride_pos], &stride, sizeof(stride));
+    std::memcpy(&damaged[num_rows_pos], &huge, sizeof(huge));
+    std::memcpy(&damaged[num_offsets_pos], &huge, sizeof(huge));
+    write_file(sidecar.c_str(), damaged);
+
+    csv::row_index index;
+    check(!index.load(sidecar.c_str()), "too many offsets are rejected");
+    check(index.load_or_build("indexed.csv", 32) && (index.get_num_rows() == num_rows),
+          "too many offsets are rebuilt");
+
+    damaged = content;
+    const uint32_t filename_size = 0xFFFFFFFF;
+    std::memcpy(&damaged[filename_size_pos], &filename_size, sizeof(filename_size));
+    write_file(sidecar.c_str(), damaged);
+
+    check(!index.load(sidecar.c_str()), "too long a filename is rejected");
+    check(index.load_or_build("indexed.csv", 32) && (index.get_num_rows() == num_rows),
+          "too long a filename is rebuilt");
+}
+
+} // namespace
+
+int main()
+{
+    write_file("indexed.csv", make_table(num_rows, ','));
+
+    test_seek(csv::read_mode::stream, "seek in read_mode::stream");
+    test_seek(csv::read_mode::mapped, "seek in read_mode::mapped");
+    test_sidecar();
+    test_stale_sidecar();
+    test_damaged_sidecar();
+
+    return test::result();
+}
@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_reader.h"
+#include "csv_row_index.h"
+#include "csv_schema.h"
+
+#include "test_util.h"
+
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+using namespace test;
+
+bool classified_as(const char* text, csv::column_type expected)
+{
+    csv::column_type type = csv::column_type::text;
+    return csv::classify(csv::field_view(text, std::strlen(text)), type) && (type == expected);
+}
+
+// the most specific type of single fields
+void test_classify()
+{
+    check(classified_as("true", csv::column_type::boolean), "classify a boolean");
+    check(classified_as(" -42 ", csv::column_type::integer), "classify an integer with spaces");
+    check(classified_as("2.5e3", csv::column_type::real), "classify a real");
+    check(classified_as("2024-01-31", csv::column_type::date), "classify a date");
+    check(classified_as("2024-01-31T12:30:00", csv::column_type::date), "classify a date with a time");
+    check(classified_as("12 apples", csv::column_type::text), "classify text");
+
+    csv::column_type type = csv::column_type::text;
+    check(!csv::classify(csv::field_view("  ", 2), type), "blank fields fit every type");
+}
+
+bool sniffed(const char* text, csv::schema& layout)
+{
+    return csv::sniff_buffer(text, std::strlen(text), layout);
+}
+
+// delimiter, header and column types of a sample
+void test_sniff()
+{
+    csv::schema layout;
+    check(sniffed("id;price;when;name\n"
+                  "1;2.5;2024-01-01;\"a; b\"\n"
+                  "2;;2024-01-02;c\n"
+                  "3;4;2024-01-03;d\n", layout), "sniff a sample");
+    check(layout.delimiter == ';', "sniffed delimiter");
+    check(layout.has_header && (layout.column_names.size() == 4) && (layout.column_names[3] == "name"),
+          "sniffed header");
+    check((layout.column_types.size() == 4) &&
+          (layout.column_types[0] == csv::column_type::integer) &&
+          (layout.column_types[1] == csv::column_type::real) &&
+          (layout.column_types[2] == csv::column_type::date) &&
+          (layout.column_types[3] == csv::column_type::text), "sniffed types");
+    check(layout.num_rows_sampled == 3, "sniffed rows");
+
+    // a first row typed like the others is data
+    check(sniffed("1\t2.5\n"
+                  "2\t3.5\n", layout), "sniff a headerless sample");
+    check((layout.delimiter == '\t') && !layout.has_header, "headerless sample");
+    check((layout.column_names.size() == 2) && (layout.column_names[1] == "c1"), "made up column names");
+    check(layout.num_rows_sampled == 2, "headerless rows");
+
+    check(!sniffed("", layout), "empty sample fails");
+}
+
+// the reader opens a file with a sniffed layout, headerless or not
+void test_open_with_layout()
+{
+    write_file("sniffed.csv",
+               "1|x\n"
+               "2|y\n");
+
+    csv::schema layout;
+    check(csv::sniff("sniffed.csv", layout) && (layout.delimiter == '|') && !layout.has_header, "sniff a file");
+
+    csv::reader reader;
+    check(reader.open("sniffed.csv", layout), "open with a sniffed layout");
+    check(reader.get_column_names() == layout.column_names, "column names of the layout");
+
+    int id = 0;
+    std::string name;
+    check(reader.read_row(id, name) && (id == 1) && (name == "x"), "first row of a headerless file");
+}
+
+// with a row index, blocks from all over the file are sampled
+void test_sniff_with_index()
+{
+    std::string table = "id,value\n";
+    // only the second half of the file has reals
+    for (int i = 0; i < 20000; ++i)
+    {
+        table += std::to_string(i) + ',' + std::to_string(i) + ((i < 10000) ? "\n" : ".5\n");
+    }
+
+    write_file("sniffed_index.csv", table);
+
+    csv::sniff_options options;
+    options.sample_size = 4096;
+
+    csv::schema layout;
+    check(csv::sniff("sniffed_index.csv", layout, options) && (layout.column_types[1] == csv::column_type::integer),
+          "sample from the start only");
+
+    csv::row_index index;
+    check(index.build("sniffed_index.csv", 64), "index for sniffing");
+    check(csv::sniff("sniffed_index.csv", index, layout, options) && (layout.column_types[1] == csv::column_type::real),
+          "sample blocks spread over the file");
+}
+
+} // namespace
+
+int main()
+{
+    test_classify();
+    test_sniff();
+    test_open_with_layout();
+    test_sniff_with_index();
+
+    return test::result();
+}
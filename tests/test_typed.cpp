@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "csv_typed.h"
+
+#include "test_util.h"
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+using namespace test;
+
+// rows written by typed_writer read back field for field
+void test_write_and_read()
+{
+    {
+        csv::typed_writer<int, std::string, double> writer;
+        check(writer.open("typed.csv", { "id", "name", "score" }), "open typed_writer");
+        writer.write_row(1, std::string("ann"), 2.5);
+        writer.write_row(std::make_tuple(2, std::string("bob, jr"), -0.25));
+        check(writer.close(), "close typed_writer");
+    }
+
+    csv::typed_reader<int, std::string, double> reader;
+    check(reader.open("typed.csv"), "open typed_reader");
+    check(reader.get_column_names().size() == 3, "column names of typed_reader");
+
+    int id = 0;
+    std::string name;
+    double score = 0;
+    check(reader.read_row(id, name, score) && (id == 1) && (name == "ann") && (score == 2.5), "first typed row");
+
+    std::tuple<int, std::string, double> row;
+    check(reader.read_row(row) && (std::get<0>(row) == 2) && (std::get<1>(row) == "bob, jr") &&
+          (std::get<2>(row) == -0.25), "second typed row as a tuple");
+    check(!reader.read_row(row), "no third typed row");
+}
+
+// columns bound by name, in any order, and a missing one fails open()
+void test_bind_by_name()
+{
+    write_file("typed_names.csv",
+               "a,b,c\n"
+               "1,x,3.5\n");
+
+    csv::typed_reader<double, int> reader;
+    check(reader.open("typed_names.csv", { "c", "a" }), "open typed_reader by name");
+
+    double c = 0;
+    int a = 0;
+    check(reader.read_row(c, a) && (c == 3.5) && (a == 1), "typed row bound by name");
+
+    csv::typed_reader<int> missing;
+    check(!missing.open("typed_names.csv", { "d" }), "unknown column fails open");
+    check(!missing.is_open(), "unknown column leaves typed_reader closed");
+
+    csv::typed_reader<int, int, int, int> too_wide;
+    check(!too_wide.open("typed_names.csv"), "more types than columns fails open");
+    check(!too_wide.is_open(), "more types than columns leaves typed_reader closed");
+
+    check(reader.is_open() && !reader.open("typed_names.csv", { "c", "d" }) && !reader.is_open(),
+          "failed open closes an open typed_reader");
+}
+
+// rows with fewer fields than the bound columns end reading
+void test_short_row()
+{
+    write_file("typed_short.csv",
+               "a,b\n"
+               "1,2\n"
+               "3\n");
+
+    csv::typed_reader<int, int> reader;
+    check(reader.open("typed_short.csv"), "open typed_reader on short rows");
+
+    int a = 0;
+    int b = 0;
+    check(reader.read_row(a, b) && (a == 1) && (b == 2), "full typed row");
+    check(!reader.read_row(a, b), "short typed row is rejected");
+}
+
+// fields that don't convert keep their values and are counted
+void test_conversion_failures()
+{
+    write_file("typed_failures.csv",
+               "a,b\n"
+               "1,x\n"
+               "y,z\n");
+
+    csv::typed_reader<int, int> reader;
+    check(reader.open("typed_failures.csv"), "open typed_reader on bad fields");
+
+    int a = 0;
+    int b = 7;
+    check(reader.read_row(a, b) && (a == 1) && (b == 7), "bad typed field keeps its value");
+    check(reader.read_row(a, b), "row of bad typed fields is read");
+
+#if defined(CSV_HAVE_STATS)
+    check(reader.get_stats().conversion_failures == 3, "typed conversion failures are counted");
+#else
+    check(reader.get_stats().conversion_failures == 0, "no typed stats without LIBCSV_WITH_STATS");
+#endif
+}
+
+} // namespace
+
+int main()
+{
+    test_write_and_read();
+    test_bind_by_name();
+    test_short_row();
+    test_conversion_failures();
+
+    return test::result();
+}
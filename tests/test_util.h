@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Zaha Mihai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef CSV_TEST_UTIL_H
+#define CSV_TEST_UTIL_H
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace test
+{
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        std::printf("FAILED: %s\n", what);
+        ++failures();
+    }
+}
+
+// exit code of a test, once every check has run
+inline int result()
+{
+    return (failures() == 0) ? 0 : 1;
+}
+
+inline std::string read_file(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+inline void write_file(const char* path, const std::string& content)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+}
+
+} // namespace test
+
+#endif // CSV_TEST_UTIL_H